@@ -42,8 +42,16 @@ namespace EnginePlus
 		SMemBlock* _pCacheBlock = nullptr;
 		size_t _uBlockSize;
 
+		// Usage counters, guarded by the cache lock.
+		unsigned _uPageBlocks = 0;
+		unsigned _uFreeBlocks = 0;
+		unsigned _uPeakUsedBlocks = 0;
+
 #ifdef _MULTITHREADED_
 		std::atomic_flag _lockFlag = ATOMIC_FLAG_INIT;
+
+		// Blocks of this size held by thread caches.
+		std::atomic<unsigned> _uThreadBlocks{ 0 };
 #endif
 	public:
 		// INITIALISATION =====================================================
@@ -59,6 +67,25 @@ namespace EnginePlus
 		// Gets the block size of this cache.
 		size_t BlockSize() const { return _uBlockSize; }
 
+		// Gets the number of blocks ever carved from memory pages for this cache.
+		unsigned PageBlockCount() const { return _uPageBlocks; }
+
+		// Gets the number of blocks held by the shared cache.
+		unsigned FreeBlockCount() const { return _uFreeBlocks; }
+
+		// Gets the highest number of blocks that were out of the shared cache at once.
+		unsigned PeakUsedBlockCount() const { return _uPeakUsedBlocks; }
+
+		// Gets the number of blocks held by thread caches.
+		unsigned ThreadBlockCount() const
+		{
+#ifdef _MULTITHREADED_
+			return _uThreadBlocks.load(std::memory_order_relaxed);
+#else
+			return 0;
+#endif
+		}
+
 		// MUTATORS ===========================================================
 
 		// Returns a block from the cache or null if the cache is empty.
@@ -72,6 +99,8 @@ namespace EnginePlus
 			{
 				pBlock = _pCacheBlock;
 				_pCacheBlock = _pCacheBlock->pNext;
+				_uFreeBlocks--;
+				UpdatePeakUsed();
 			}
 
 #ifdef _MULTITHREADED_
@@ -88,11 +117,69 @@ namespace EnginePlus
 #endif
 			pBlock->pNext = _pCacheBlock;
 			_pCacheBlock = pBlock;
+			_uFreeBlocks++;
+#ifdef _MULTITHREADED_
+			_lockFlag.clear();
+#endif
+		}
+
+		// Returns up to the given number of blocks from the cache as a linked list,
+		// or null if the cache is empty.
+		SMemBlock* AllocateBatch(unsigned uMaxCount, SMemBlock*& pTail, unsigned& uCount)
+		{
+			uCount = 0;
+			pTail = nullptr;
+#ifdef _MULTITHREADED_
+			while (_lockFlag.test_and_set()) {}
+#endif
+			SMemBlock* pHead = _pCacheBlock;
+			while (_pCacheBlock && uCount < uMaxCount)
+			{
+				pTail = _pCacheBlock;
+				_pCacheBlock = _pCacheBlock->pNext;
+				uCount++;
+			}
+			_uFreeBlocks -= uCount;
+			UpdatePeakUsed();
+
 #ifdef _MULTITHREADED_
 			_lockFlag.clear();
 #endif
+			return uCount ? pHead : nullptr;
 		}
 
+		// Returns a linked list of data blocks to the cache for recycling.
+		void FreeBatch(SMemBlock* pHead, SMemBlock* pTail, unsigned uCount)
+		{
+#ifdef _MULTITHREADED_
+			while (_lockFlag.test_and_set()) {}
+#endif
+			pTail->pNext = _pCacheBlock;
+			_pCacheBlock = pHead;
+			_uFreeBlocks += uCount;
+#ifdef _MULTITHREADED_
+			_lockFlag.clear();
+#endif
+		}
+
+		// Records the given number of blocks newly carved from a memory page.
+		void AddPageBlocks(unsigned uCount)
+		{
+#ifdef _MULTITHREADED_
+			while (_lockFlag.test_and_set()) {}
+#endif
+			_uPageBlocks += uCount;
+			UpdatePeakUsed();
+#ifdef _MULTITHREADED_
+			_lockFlag.clear();
+#endif
+		}
+
+#ifdef _MULTITHREADED_
+		// Records blocks moved into (positive) or out of (negative) thread caches.
+		void AddThreadBlocks(int iCount) { _uThreadBlocks.fetch_add((unsigned)iCount, std::memory_order_relaxed); }
+#endif
+
 		// ACCESSORS ==========================================================
 
 		// CLEAN UP ===========================================================
@@ -100,5 +187,13 @@ namespace EnginePlus
 	private:
 		// IMPLEMENTATION =====================================================
 
+		// Updates the high-water mark of blocks out of the shared cache.
+		// Must be called with the cache lock held.
+		void UpdatePeakUsed()
+		{
+			unsigned uUsedBlocks = _uPageBlocks - _uFreeBlocks;
+			if (_uPeakUsedBlocks < uUsedBlocks)
+				_uPeakUsedBlocks = uUsedBlocks;
+		}
 	};
 }
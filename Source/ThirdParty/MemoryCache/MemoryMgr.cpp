@@ -20,29 +20,62 @@
 
 #include "MemoryMgr.h"
 #include <malloc.h>
-#ifdef _STATISTICS_
-#include "Platform\Common\Logger.h"
-#endif
+#include <cstdio>
 
 namespace EnginePlus
 {
+	// Set once the memory manager is destroyed. Static objects destroyed after it
+	// fall back to the system heap, as the pages are gone.
+	static bool s_bShutdown = false;
+
+	// Writes a leak report message to the standard error output.
+	static void ReportToStdErr(const char* szMessage)
+	{
+		fputs(szMessage, stderr);
+	}
+
+#ifdef _MULTITHREADED_
+	// Owns the thread cache of a thread, returning its blocks to the shared caches on thread exit.
+	struct SThreadCacheOwner
+	{
+		CMemThreadCache threadCache;
+
+		~SThreadCacheOwner();
+	};
+
+	// The calling thread's cache. Trivially destructible, so that it stays
+	// accessible while other thread local objects are being destroyed.
+	static thread_local CMemThreadCache* t_pThreadCache = nullptr;
+	static thread_local bool t_bThreadCacheReleased = false;
+
+	SThreadCacheOwner::~SThreadCacheOwner()
+	{
+		// Blocks freed after this point go directly to the shared caches
+		t_pThreadCache = nullptr;
+		t_bThreadCacheReleased = true;
+
+		CMemoryMgr::Instance().ReleaseThreadCache(threadCache);
+	}
+
+	// Number of allocations made by the calling thread.
+	static thread_local size_t t_uAllocationCount = 0;
+#else
+	// Number of allocations made so far.
+	static size_t t_uAllocationCount = 0;
+#endif
+
 	// ----------------------------------------------------------------------------
 	// Instantiates with default values.
 	// ----------------------------------------------------------------------------
 	CMemoryMgr::CMemoryMgr()
-		: _pFilledPages(nullptr)
+		: _pFilledPages(nullptr), _uPageCount(2),
+		_uLargeBlockCount(0), _uLiveLargeBlocks(0), _uLiveLargeBytes(0), _uPeakLargeBytes(0),
+		_uLargeBlocksMin((size_t)-1), _uLargeBlocksMax(0),
+		_pReportFunction(ReportToStdErr)
 	{
 		InitialiseCache();
 		_pPageA = ::new CMemoryPage();
 		_pPageB = ::new CMemoryPage();
-
-#ifdef _STATISTICS_
-		_uLargeBlockCount = 0;
-		_uLargeBlocksSize = 0;
-
-		_uLargeBlocksMin = (unsigned)-1;
-		_uLargeBlocksMax = 0;
-#endif
 	}
 
 	// ----------------------------------------------------------------------------
@@ -53,25 +86,37 @@ namespace EnginePlus
 	// ----------------------------------------------------------------------------
 	void* CMemoryMgr::Allocate(size_t uBlockSize)
 	{
+		t_uAllocationCount++;
+
+		if (s_bShutdown)
+			return malloc(uBlockSize);
+
 		if (uBlockSize > MAX_BLOCK_SIZE)
 		{
-#ifdef _STATISTICS_
-			_uLargeBlockCount++;
-			_uLargeBlocksSize += uBlockSize;
-
-			if (_uLargeBlocksMin > uBlockSize)
-				_uLargeBlocksMin = uBlockSize;
-			if (_uLargeBlocksMax < uBlockSize)
-				_uLargeBlocksMax = uBlockSize;
-#endif
+			AddLargeBlock(uBlockSize);
 			return malloc(uBlockSize);
 		}
 
 		unsigned uCacheIndex = CalcCacheIndex(uBlockSize);
 
+#ifdef _MULTITHREADED_
+		CMemThreadCache* pThreadCache = GetThreadCache();
+		if (pThreadCache)
+		{
+			SMemBlock* pBlock = pThreadCache->Allocate(uCacheIndex);
+			if (!pBlock)
+				pBlock = RefillThreadCache(*pThreadCache, uCacheIndex);
+
+			return pBlock;
+		}
+#endif
+
 		SMemBlock* pBlock = _blockCaches[uCacheIndex].Allocate();
 		if (!pBlock)
+		{
+			_blockCaches[uCacheIndex].AddPageBlocks(1);
 			return AllocateFromPage(_blockCaches[uCacheIndex].BlockSize());
+		}
 		
 		return pBlock;
 	}
@@ -81,8 +126,16 @@ namespace EnginePlus
 	// ----------------------------------------------------------------------------
 	void CMemoryMgr::Free(void* pMem, size_t uBlockSize)
 	{
+		// Blocks freed after shutdown are either leaked page blocks or system heap blocks
+		// that cannot be told apart, so leave them to the process exit
+		if (s_bShutdown)
+			return;
+
 		if (uBlockSize > MAX_BLOCK_SIZE)
 		{
+			_uLiveLargeBlocks--;
+			_uLiveLargeBytes -= uBlockSize;
+
 			free(pMem);
 			return;
 		}
@@ -90,50 +143,210 @@ namespace EnginePlus
 		unsigned uCacheIndex = CalcCacheIndex(uBlockSize);
 		SMemBlock* pBlock = (SMemBlock*)pMem;
 
+#ifdef _MULTITHREADED_
+		CMemThreadCache* pThreadCache = GetThreadCache();
+		if (pThreadCache)
+		{
+			// Keep up to two batches per thread, then hand one batch back for other threads to use
+			unsigned uBatchSize = CalcBatchSize(uCacheIndex);
+			if (pThreadCache->Free(uCacheIndex, pBlock) > uBatchSize * 2)
+				FlushThreadCache(*pThreadCache, uCacheIndex, uBatchSize);
+
+			return;
+		}
+#endif
+
 		_blockCaches[uCacheIndex].Free(pBlock);
 	}
 
-#ifdef _STATISTICS_
+#ifdef _MULTITHREADED_
 	// ----------------------------------------------------------------------------
-	// Logs usage statistics of all allocators.
+	// Returns all blocks held by a thread cache to the shared caches.
+	// Called when the owning thread exits.
 	// ----------------------------------------------------------------------------
-	void CMemoryMgr::LogStatistics() const
+	void CMemoryMgr::ReleaseThreadCache(CMemThreadCache& threadCache)
 	{
-		Logger << "Memory Manager\n";
+		for (unsigned uCacheIndex = 0; uCacheIndex < MEM_CACHE_COUNT; uCacheIndex++)
+			FlushThreadCache(threadCache, uCacheIndex, (unsigned)-1);
+	}
 
-		unsigned uAllocatedPages = 3;
-		unsigned uUnusedMemory = 0;
+	// ----------------------------------------------------------------------------
+	// Gets the calling thread's cache, creating it on first use.
+	// Returns null once the thread has released its cache on exit.
+	// ----------------------------------------------------------------------------
+	CMemThreadCache* CMemoryMgr::GetThreadCache()
+	{
+		if (t_pThreadCache)
+			return t_pThreadCache;
+		if (t_bThreadCacheReleased)
+			return nullptr;
 
-		uUnusedMemory += _pPageA->FreeSize();
-		uUnusedMemory += _pPageB->FreeSize();
+		static thread_local SThreadCacheOwner threadCacheOwner;
+		t_pThreadCache = &threadCacheOwner.threadCache;
 
-		CMemoryPage* pPage = _pFilledPages;
+		return t_pThreadCache;
+	}
 
-		while (pPage)
+	// ----------------------------------------------------------------------------
+	// Refills a thread cache with a batch of blocks from the shared cache,
+	// or from memory pages if the shared cache is empty, and returns one of them.
+	// ----------------------------------------------------------------------------
+	SMemBlock* CMemoryMgr::RefillThreadCache(CMemThreadCache& threadCache, unsigned uCacheIndex)
+	{
+		CBlockCache& blockCache = _blockCaches[uCacheIndex];
+		unsigned uBatchSize = CalcBatchSize(uCacheIndex);
+
+		SMemBlock* pTail;
+		unsigned uCount;
+		SMemBlock* pHead = blockCache.AllocateBatch(uBatchSize, pTail, uCount);
+
+		if (!pHead)
 		{
-			uAllocatedPages++;
-			uUnusedMemory += pPage->FreeSize();
+			// Carve a new batch from the pages
+			size_t uSize = blockCache.BlockSize();
+			for (uCount = 0; uCount < uBatchSize; uCount++)
+			{
+				SMemBlock* pBlock = (SMemBlock*)AllocateFromPage(uSize);
+				if (!pHead)
+					pTail = pBlock;
+				pBlock->pNext = pHead;
+				pHead = pBlock;
+			}
+			blockCache.AddPageBlocks(uCount);
+		}
 
-			pPage = pPage->pNext;
+		// Keep all but the first block, which is returned to the caller
+		SMemBlock* pBlock = pHead;
+		if (uCount > 1)
+		{
+			threadCache.Refill(uCacheIndex, pHead->pNext, pTail, uCount - 1);
+			blockCache.AddThreadBlocks(threadCache.TakeCountChange(uCacheIndex));
 		}
 
-		unsigned uAllocatedSize = uAllocatedPages * MEMORY_PAGE_SIZE;
-		unsigned uUnusedPercent = (uUnusedMemory * 100) / uAllocatedSize;
+		return pBlock;
+	}
 
-		Logger << "Allocated: " << uAllocatedPages << " x 16 KB\t" << uAllocatedSize << NL;
-		Logger << "Unused: " << uUnusedMemory << " (" << uUnusedPercent << "%)\n";
-		Logger << "Large Blocks: " << _uLargeBlockCount << "\tAllocated: " << (_uLargeBlocksSize / 1024) << "kB\n";
-		if (_uLargeBlockCount)
-			Logger << "Large Blocks range: " << _uLargeBlocksMin << " - " << _uLargeBlocksMax << NL;
+	// ----------------------------------------------------------------------------
+	// Returns a batch of blocks from a thread cache to the shared cache.
+	// ----------------------------------------------------------------------------
+	void CMemoryMgr::FlushThreadCache(CMemThreadCache& threadCache, unsigned uCacheIndex, unsigned uMaxCount)
+	{
+		SMemBlock* pTail;
+		unsigned uCount;
+		SMemBlock* pHead = threadCache.Detach(uCacheIndex, uMaxCount, pTail, uCount);
+
+		_blockCaches[uCacheIndex].AddThreadBlocks(threadCache.TakeCountChange(uCacheIndex));
+		if (pHead)
+			_blockCaches[uCacheIndex].FreeBatch(pHead, pTail, uCount);
 	}
 #endif
 
+	// ----------------------------------------------------------------------------
+	// Gets the current usage statistics of all allocators.
+	// Counts involving thread caches are approximate while other threads allocate.
+	// ----------------------------------------------------------------------------
+	void CMemoryMgr::GetStatistics(SMemoryStatistics& statistics) const
+	{
+		statistics.uFreeBlockBytes = 0;
+		statistics.uLiveBlockBytes = 0;
+
+		for (unsigned uCacheIndex = 0; uCacheIndex < MEM_CACHE_COUNT; uCacheIndex++)
+		{
+			const CBlockCache& blockCache = _blockCaches[uCacheIndex];
+			SMemCacheStatistics& cacheStatistics = statistics.caches[uCacheIndex];
+
+			cacheStatistics.uBlockSize = blockCache.BlockSize();
+			cacheStatistics.uPageBlocks = blockCache.PageBlockCount();
+			cacheStatistics.uFreeBlocks = blockCache.FreeBlockCount();
+			cacheStatistics.uThreadBlocks = blockCache.ThreadBlockCount();
+			cacheStatistics.uPeakBlocks = blockCache.PeakUsedBlockCount();
+
+			// The counters are read separately, so guard against transient underflow
+			unsigned uIdleBlocks = cacheStatistics.uFreeBlocks + cacheStatistics.uThreadBlocks;
+			cacheStatistics.uLiveBlocks = cacheStatistics.uPageBlocks > uIdleBlocks ?
+				cacheStatistics.uPageBlocks - uIdleBlocks : 0;
+
+			statistics.uFreeBlockBytes += (cacheStatistics.uPageBlocks - cacheStatistics.uLiveBlocks) * cacheStatistics.uBlockSize;
+			statistics.uLiveBlockBytes += cacheStatistics.uLiveBlocks * cacheStatistics.uBlockSize;
+		}
+
+		{
+#ifdef _MULTITHREADED_
+			std::lock_guard<std::mutex> hndLock(_hndMutex);
+#endif
+			statistics.uPageCount = _uPageCount;
+			statistics.uUnusedPageBytes = _pPageA->FreeSize() + _pPageB->FreeSize();
+
+			for (CMemoryPage* pPage = _pFilledPages; pPage; pPage = pPage->pNext)
+				statistics.uUnusedPageBytes += pPage->FreeSize();
+		}
+
+		statistics.uLargeBlockCount = _uLargeBlockCount;
+		statistics.uLiveLargeBlocks = _uLiveLargeBlocks;
+		statistics.uLiveLargeBytes = _uLiveLargeBytes;
+		statistics.uPeakLargeBytes = _uPeakLargeBytes;
+		statistics.uLargeBlocksMin = statistics.uLargeBlockCount ? (size_t)_uLargeBlocksMin : 0;
+		statistics.uLargeBlocksMax = _uLargeBlocksMax;
+	}
+
+	// ----------------------------------------------------------------------------
+	// Gets the number of allocations made by the calling thread so far.
+	// ----------------------------------------------------------------------------
+	size_t CMemoryMgr::ThreadAllocationCount()
+	{
+		return t_uAllocationCount;
+	}
+
 	// ------------------------------------------------------------------------
-	// Destructor.
+	// Destructor. Reports blocks still in use by size class, then releases all pages.
 	// ------------------------------------------------------------------------
 	CMemoryMgr::~CMemoryMgr()
 	{
-		// TODO: Delete allocated pages, if neccessary
+		SMemoryStatistics statistics;
+		GetStatistics(statistics);
+
+		char szMessage[256];
+		bool bLeaked = false;
+
+		for (unsigned uCacheIndex = 0; uCacheIndex < MEM_CACHE_COUNT; uCacheIndex++)
+		{
+			const SMemCacheStatistics& cacheStatistics = statistics.caches[uCacheIndex];
+			if (!cacheStatistics.uLiveBlocks)
+				continue;
+
+			if (!bLeaked)
+			{
+				Report("Memory Manager: blocks still in use at shutdown\n");
+				bLeaked = true;
+			}
+
+			snprintf(szMessage, sizeof(szMessage), "  %4u bytes: %u blocks\n",
+				(unsigned)cacheStatistics.uBlockSize, cacheStatistics.uLiveBlocks);
+			Report(szMessage);
+		}
+
+		if (statistics.uLiveLargeBlocks)
+		{
+			snprintf(szMessage, sizeof(szMessage), "Memory Manager: %u large blocks (%u bytes) still in use at shutdown\n",
+				(unsigned)statistics.uLiveLargeBlocks, (unsigned)statistics.uLiveLargeBytes);
+			Report(szMessage);
+		}
+
+		s_bShutdown = true;
+
+		// Blocks still in use point into the pages, so only release them when nothing leaked
+		if (bLeaked)
+			return;
+
+		::delete _pPageA;
+		::delete _pPageB;
+
+		while (_pFilledPages)
+		{
+			CMemoryPage* pPage = _pFilledPages;
+			_pFilledPages = pPage->pNext;
+			::delete pPage;
+		}
 	}
 
 	// ----------------------------------------------------------------------------
@@ -225,6 +438,45 @@ namespace EnginePlus
 
 		// Create a new page and allocate from it
 		pPageToArchive = ::new CMemoryPage();
+		_uPageCount++;
+
 		return pPageToArchive->Allocate(uBlockSize);
 	}
+
+	// ----------------------------------------------------------------------------
+	// Records the allocation of a block too large for the caches.
+	// ----------------------------------------------------------------------------
+	void CMemoryMgr::AddLargeBlock(size_t uBlockSize)
+	{
+		_uLargeBlockCount++;
+		_uLiveLargeBlocks++;
+		size_t uLiveBytes = (_uLiveLargeBytes += uBlockSize);
+
+#ifdef _MULTITHREADED_
+		size_t uPrevious = _uPeakLargeBytes.load(std::memory_order_relaxed);
+		while (uPrevious < uLiveBytes && !_uPeakLargeBytes.compare_exchange_weak(uPrevious, uLiveBytes)) {}
+
+		uPrevious = _uLargeBlocksMin.load(std::memory_order_relaxed);
+		while (uPrevious > uBlockSize && !_uLargeBlocksMin.compare_exchange_weak(uPrevious, uBlockSize)) {}
+
+		uPrevious = _uLargeBlocksMax.load(std::memory_order_relaxed);
+		while (uPrevious < uBlockSize && !_uLargeBlocksMax.compare_exchange_weak(uPrevious, uBlockSize)) {}
+#else
+		if (_uPeakLargeBytes < uLiveBytes)
+			_uPeakLargeBytes = uLiveBytes;
+		if (_uLargeBlocksMin > uBlockSize)
+			_uLargeBlocksMin = uBlockSize;
+		if (_uLargeBlocksMax < uBlockSize)
+			_uLargeBlocksMax = uBlockSize;
+#endif
+	}
+
+	// ----------------------------------------------------------------------------
+	// Writes a message of the leak report.
+	// ----------------------------------------------------------------------------
+	void CMemoryMgr::Report(const char* szMessage) const
+	{
+		if (_pReportFunction)
+			_pReportFunction(szMessage);
+	}
 }
\ No newline at end of file
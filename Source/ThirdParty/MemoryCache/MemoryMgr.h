@@ -23,6 +23,8 @@
 #include "BlockCache.h"
 #include "MemoryPage.h"
 #ifdef _MULTITHREADED_
+#include "ThreadCache.h"
+#include <atomic>
 #include <mutex>
 #endif
 
@@ -33,6 +35,61 @@
 
 namespace EnginePlus
 {
+#ifdef _MULTITHREADED_
+	typedef CThreadCache<MEM_CACHE_COUNT> CMemThreadCache;
+	typedef std::atomic<size_t> MemCounter;
+#else
+	typedef size_t MemCounter;
+#endif
+
+	// Receives the messages of the leak report written on shutdown.
+	typedef void (*MemReportFunction)(const char* szMessage);
+
+	// Usage statistics of a single block size class.
+	struct SMemCacheStatistics
+	{
+		// Size of the blocks in this class.
+		size_t uBlockSize;
+		// Blocks carved from memory pages.
+		unsigned uPageBlocks;
+		// Blocks waiting for reuse in the shared cache.
+		unsigned uFreeBlocks;
+		// Blocks waiting for reuse in thread caches, as of their last exchange with the shared cache.
+		unsigned uThreadBlocks;
+		// Blocks currently in use.
+		unsigned uLiveBlocks;
+		// Highest number of blocks out of the shared cache, including those held by thread caches.
+		unsigned uPeakBlocks;
+	};
+
+	// Usage statistics of the memory manager.
+	struct SMemoryStatistics
+	{
+		// Per size class statistics, ordered by block size.
+		SMemCacheStatistics caches[MEM_CACHE_COUNT];
+
+		// Number of allocated memory pages.
+		unsigned uPageCount;
+		// Bytes of memory pages not yet carved into blocks.
+		size_t uUnusedPageBytes;
+		// Bytes of blocks carved from pages but currently not in use.
+		size_t uFreeBlockBytes;
+		// Bytes of blocks currently in use.
+		size_t uLiveBlockBytes;
+
+		// Total number of allocations too large for the caches.
+		size_t uLargeBlockCount;
+		// Number of large blocks currently in use.
+		size_t uLiveLargeBlocks;
+		// Bytes of large blocks currently in use.
+		size_t uLiveLargeBytes;
+		// Highest number of bytes of large blocks in use at once.
+		size_t uPeakLargeBytes;
+		// Smallest and largest large block allocated, or zero if none.
+		size_t uLargeBlocksMin;
+		size_t uLargeBlocksMax;
+	};
+
 	// ------------------------------------------------------------------------
 	// Handles efficient allocation and recycling of small data blocks
 	// ------------------------------------------------------------------------
@@ -47,17 +104,22 @@ namespace EnginePlus
 		CMemoryPage* _pPageB;
 		CMemoryPage* _pFilledPages;
 
+		unsigned _uPageCount;
+
 #ifdef _MULTITHREADED_
-		std::mutex _hndMutex;
+		mutable std::mutex _hndMutex;
 #endif
 
-#ifdef _STATISTICS_
-		unsigned _uLargeBlockCount;
-		unsigned _uLargeBlocksSize;
+		MemCounter _uLargeBlockCount;
+		MemCounter _uLiveLargeBlocks;
+		MemCounter _uLiveLargeBytes;
+		MemCounter _uPeakLargeBytes;
+
+		MemCounter _uLargeBlocksMin;
+		MemCounter _uLargeBlocksMax;
+
+		MemReportFunction _pReportFunction;
 
-		unsigned _uLargeBlocksMin;
-		unsigned _uLargeBlocksMax;
-#endif
 		// INITIALISATION =====================================================
 
 		// Default constructor private to enforce the singleton pattern.
@@ -77,29 +139,44 @@ namespace EnginePlus
 			return instance;
 		}
 
+		// Sets the function receiving the leak report written on shutdown.
+		// By default the report is written to the standard error output.
+		void SetReportFunction(MemReportFunction pReportFunction) { _pReportFunction = pReportFunction; }
+
 		// MUTATORS ===========================================================
 
 		// Allocates a block of memory of the specified size.
 		// 
-		// First it trys to allocate from a cache of the appropriate size,
-		// otherwise it allocates from a page, creating new pages as needed.
+		// First it trys to allocate from the calling thread's cache, then from
+		// a shared cache of the appropriate size, otherwise it allocates from
+		// a page, creating new pages as needed.
 		void* Allocate(size_t uBlockSize);
 
 		// Deallocates the given block of memory of the specified size.
 		void Free(void* pMem, size_t uBlockSize);
 
+#ifdef _MULTITHREADED_
+		// Returns all blocks held by a thread cache to the shared caches.
+		// Called when the owning thread exits.
+		void ReleaseThreadCache(CMemThreadCache& threadCache);
+#endif
+
 		// ACCESSORS ==========================================================
 
-#ifdef _STATISTICS_
-		// Logs usage statistics of all allocators.
-		void LogStatistics() const;
-#endif
+		// Gets the current usage statistics of all allocators.
+		// Counts involving thread caches are approximate while other threads allocate.
+		void GetStatistics(SMemoryStatistics& statistics) const;
+
+		// Gets the number of allocations made by the calling thread so far.
+		// The difference of two readings gives the allocations of the code in between.
+		static size_t ThreadAllocationCount();
+
 		// CLEAN UP ===========================================================
 
 		// TODO: Releases all unused pages.
 		// void Compact();
 
-		// Destructor.
+		// Destructor. Reports blocks still in use by size class, then releases all pages.
 		~CMemoryMgr();
 
 	private:
@@ -121,5 +198,31 @@ namespace EnginePlus
 		// Allocates the required block from a memory page,
 		// allocating new pages as needed.
 		void* AllocateFromPage(size_t uBlockSize);
+
+		// Records the allocation of a block too large for the caches.
+		void AddLargeBlock(size_t uBlockSize);
+
+		// Writes a message of the leak report.
+		void Report(const char* szMessage) const;
+
+#ifdef _MULTITHREADED_
+		// Gets the number of blocks moved between a thread cache and the shared cache at once.
+		unsigned CalcBatchSize(unsigned uCacheIndex) const
+		{
+			unsigned uBatchSize = THREAD_CACHE_BATCH_BYTES / (unsigned)_blockCaches[uCacheIndex].BlockSize();
+			return uBatchSize < 2 ? 2 : (uBatchSize > THREAD_CACHE_MAX_BATCH ? THREAD_CACHE_MAX_BATCH : uBatchSize);
+		}
+
+		// Gets the calling thread's cache, creating it on first use.
+		// Returns null once the thread has released its cache on exit.
+		static CMemThreadCache* GetThreadCache();
+
+		// Refills a thread cache with a batch of blocks from the shared cache,
+		// or from memory pages if the shared cache is empty, and returns one of them.
+		SMemBlock* RefillThreadCache(CMemThreadCache& threadCache, unsigned uCacheIndex);
+
+		// Returns a batch of blocks from a thread cache to the shared cache.
+		void FlushThreadCache(CMemThreadCache& threadCache, unsigned uCacheIndex, unsigned uMaxCount);
+#endif
 	};
 }
@@ -0,0 +1,146 @@
+#pragma once
+
+// Copyright (c) 2019 QB'k Games.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "BlockCache.h"
+
+// Number of bytes moved between a thread cache and the shared caches at once.
+#define THREAD_CACHE_BATCH_BYTES	2048
+// Maximum number of blocks moved between a thread cache and the shared caches at once.
+#define THREAD_CACHE_MAX_BATCH		32
+
+namespace EnginePlus
+{
+	// A thread local stack of free blocks of a single size.
+	struct SBlockMagazine
+	{
+		SMemBlock* pHead;
+		unsigned uCount;
+		// Block count last published to the usage statistics.
+		unsigned uReportedCount;
+	};
+
+	// ------------------------------------------------------------------------
+	// Holds free blocks of every size for a single thread, so that most
+	// allocations and deallocations need no synchronisation at all
+	// ------------------------------------------------------------------------
+	template<unsigned CacheCount>
+	class CThreadCache
+	{
+		// FIELDS =============================================================
+
+		SBlockMagazine _magazines[CacheCount];
+
+	public:
+		// INITIALISATION =====================================================
+
+		// Default constructor.
+		CThreadCache()
+		{
+			for (unsigned uIndex = 0; uIndex < CacheCount; uIndex++)
+			{
+				_magazines[uIndex].pHead = nullptr;
+				_magazines[uIndex].uCount = 0;
+				_magazines[uIndex].uReportedCount = 0;
+			}
+		}
+
+		CThreadCache(const CThreadCache&) = delete;
+		CThreadCache& operator=(const CThreadCache&) = delete;
+
+		// PROPERTIES =========================================================
+
+		// Gets the number of blocks held for the given cache index.
+		unsigned BlockCount(unsigned uCacheIndex) const { return _magazines[uCacheIndex].uCount; }
+
+		// Gets the change in the number of blocks held for the given cache index
+		// since the last call, for publishing to the usage statistics.
+		int TakeCountChange(unsigned uCacheIndex)
+		{
+			SBlockMagazine& magazine = _magazines[uCacheIndex];
+
+			int iChange = (int)(magazine.uCount - magazine.uReportedCount);
+			magazine.uReportedCount = magazine.uCount;
+
+			return iChange;
+		}
+
+		// MUTATORS ===========================================================
+
+		// Returns a block of the given cache index or null if none are held.
+		SMemBlock* Allocate(unsigned uCacheIndex)
+		{
+			SBlockMagazine& magazine = _magazines[uCacheIndex];
+
+			SMemBlock* pBlock = magazine.pHead;
+			if (pBlock)
+			{
+				magazine.pHead = pBlock->pNext;
+				magazine.uCount--;
+			}
+
+			return pBlock;
+		}
+
+		// Holds a freed block of the given cache index.
+		// Returns the number of blocks now held for that index.
+		unsigned Free(unsigned uCacheIndex, SMemBlock* pBlock)
+		{
+			SBlockMagazine& magazine = _magazines[uCacheIndex];
+
+			pBlock->pNext = magazine.pHead;
+			magazine.pHead = pBlock;
+
+			return ++magazine.uCount;
+		}
+
+		// Holds a linked list of blocks of the given cache index.
+		void Refill(unsigned uCacheIndex, SMemBlock* pHead, SMemBlock* pTail, unsigned uCount)
+		{
+			SBlockMagazine& magazine = _magazines[uCacheIndex];
+
+			pTail->pNext = magazine.pHead;
+			magazine.pHead = pHead;
+			magazine.uCount += uCount;
+		}
+
+		// Detaches up to the given number of blocks of the given cache index as a linked list.
+		// Returns the list head, or null if no blocks are held.
+		SMemBlock* Detach(unsigned uCacheIndex, unsigned uMaxCount, SMemBlock*& pTail, unsigned& uCount)
+		{
+			SBlockMagazine& magazine = _magazines[uCacheIndex];
+
+			SMemBlock* pHead = magazine.pHead;
+			pTail = nullptr;
+			uCount = 0;
+
+			while (magazine.pHead && uCount < uMaxCount)
+			{
+				pTail = magazine.pHead;
+				magazine.pHead = magazine.pHead->pNext;
+				uCount++;
+			}
+
+			magazine.uCount -= uCount;
+			return uCount ? pHead : nullptr;
+		}
+	};
+}
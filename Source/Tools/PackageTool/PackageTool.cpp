@@ -26,6 +26,7 @@
 #include <Urho3D/IO/File.h>
 #include <Urho3D/IO/FileSystem.h>
 #include <Urho3D/IO/PackageFile.h>
+#include <Urho3D/IO/VectorBuffer.h>
 
 #ifdef WIN32
 #include <windows.h>
@@ -279,6 +280,10 @@ void WritePackageFile(const String& fileName, const String& rootDir)
             SharedArrayPtr<unsigned char> compressBuffer(new unsigned char[LZ4_compressBound(blockSize_)]);
 
             unsigned pos = 0;
+            unsigned numBlocks = (dataSize + blockSize_ - 1) / blockSize_;
+            unsigned indexSize = 2 * sizeof(unsigned) + numBlocks * sizeof(unsigned);
+            PODVector<unsigned> blockOffsets;
+            VectorBuffer blocks;
 
             while (pos < dataSize)
             {
@@ -290,13 +295,22 @@ void WritePackageFile(const String& fileName, const String& rootDir)
                 if (!packedSize)
                     ErrorExit("LZ4 compression failed for file " + entries_[i].name_ + " at offset " + String(pos));
 
-                dest.WriteUShort((unsigned short)unpackedSize);
-                dest.WriteUShort((unsigned short)packedSize);
-                dest.Write(compressBuffer.Get(), packedSize);
+                // Block offsets are relative to the start of the file entry
+                blockOffsets.Push(indexSize + blocks.GetSize());
+                blocks.WriteUShort((unsigned short)unpackedSize);
+                blocks.WriteUShort((unsigned short)packedSize);
+                blocks.Write(compressBuffer.Get(), packedSize);
 
                 pos += unpackedSize;
             }
 
+            // Write the block index first so that readers can seek to any block directly
+            dest.WriteUInt(blockSize_);
+            dest.WriteUInt(numBlocks);
+            for (unsigned j = 0; j < numBlocks; ++j)
+                dest.WriteUInt(blockOffsets[j]);
+            dest.Write(blocks.GetData(), blocks.GetSize());
+
             if (!quiet_)
             {
                 unsigned totalPackedBytes = dest.GetSize() - lastOffset;
@@ -339,7 +353,7 @@ void WriteHeader(File& dest)
     if (!compress_)
         dest.WriteFileID("UPAK");
     else
-        dest.WriteFileID("ULZ4");
+        dest.WriteFileID("ULZI");
     dest.WriteUInt(entries_.Size());
     dest.WriteUInt(checksum_);
 }
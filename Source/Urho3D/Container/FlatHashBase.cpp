@@ -0,0 +1,74 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Container/FlatHashBase.h"
+
+#include <cstring>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+unsigned FlatHashBase::CapacityFor(unsigned numElements)
+{
+    unsigned capacity = MIN_CAPACITY;
+    while (MaxLoad(capacity) < numElements)
+        capacity <<= 1u;
+    return capacity;
+}
+
+unsigned char* FlatHashBase::AllocateControl(unsigned capacity)
+{
+    unsigned char* oldCtrl = ctrl_;
+
+    ctrl_ = new unsigned char[capacity + GROUP_WIDTH];
+    capacity_ = capacity;
+    growthLeft_ = MaxLoad(capacity) - size_;
+    memset(ctrl_, CTRL_EMPTY, capacity);
+    memset(ctrl_ + capacity, 0, GROUP_WIDTH);
+
+    return oldCtrl;
+}
+
+void FlatHashBase::ResetControl()
+{
+    size_ = 0;
+    if (!ctrl_)
+        return;
+
+    memset(ctrl_, CTRL_EMPTY, capacity_);
+    growthLeft_ = MaxLoad(capacity_);
+}
+
+void FlatHashBase::FreeControl()
+{
+    delete[] ctrl_;
+    ctrl_ = nullptr;
+    capacity_ = 0;
+    size_ = 0;
+    growthLeft_ = 0;
+}
+
+}
@@ -0,0 +1,237 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#ifdef URHO3D_IS_BUILDING
+#include "Urho3D.h"
+#else
+#include <Urho3D/Urho3D.h>
+#endif
+
+#include "../Container/Hash.h"
+#include "../Container/Swap.h"
+
+#ifdef URHO3D_SSE
+#include <emmintrin.h>
+#endif
+
+namespace Urho3D
+{
+
+/// Open addressing hash set/map base class. Keeps one control byte per slot: empty, deleted, or the low 7 bits of the full slot's hash. Slots are probed one group of control bytes at a time.
+class URHO3D_API FlatHashBase
+{
+public:
+    /// Number of control bytes matched at once.
+    static const unsigned GROUP_WIDTH = 16;
+    /// Initial amount of slots.
+    static const unsigned MIN_CAPACITY = 16;
+
+    /// Construct.
+    FlatHashBase() :
+        ctrl_(nullptr),
+        capacity_(0),
+        size_(0),
+        growthLeft_(0)
+    {
+    }
+
+    /// Swap with another flat hash set or map.
+    void Swap(FlatHashBase& rhs)
+    {
+        Urho3D::Swap(ctrl_, rhs.ctrl_);
+        Urho3D::Swap(capacity_, rhs.capacity_);
+        Urho3D::Swap(size_, rhs.size_);
+        Urho3D::Swap(growthLeft_, rhs.growthLeft_);
+    }
+
+    /// Return number of elements.
+    unsigned Size() const { return size_; }
+
+    /// Return number of slots.
+    unsigned Capacity() const { return capacity_; }
+
+    /// Return whether has no elements.
+    bool Empty() const { return size_ == 0; }
+
+protected:
+    /// Control byte of an empty slot.
+    static const unsigned char CTRL_EMPTY = 0x80;
+    /// Control byte of an erased slot.
+    static const unsigned char CTRL_DELETED = 0xfe;
+    /// Index returned when a key is not found.
+    static const unsigned NOT_FOUND = 0xffffffff;
+
+    /// Scramble a key hash so that the group index and control byte bits are both well distributed.
+    static unsigned MixHash(unsigned hash)
+    {
+        hash ^= hash >> 16u;
+        hash *= 0x85ebca6bu;
+        hash ^= hash >> 13u;
+        hash *= 0xc2b2ae35u;
+        hash ^= hash >> 16u;
+        return hash;
+    }
+
+    /// Return control byte for a full slot with the given mixed hash.
+    static unsigned char ControlByte(unsigned hash) { return (unsigned char)(hash & 0x7fu); }
+
+    /// Return index of the lowest set bit in a nonzero mask.
+    static unsigned LowestBit(unsigned mask)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return (unsigned)__builtin_ctz(mask);
+#else
+        unsigned index = 0;
+        while (!(mask & 1u))
+        {
+            mask >>= 1u;
+            ++index;
+        }
+        return index;
+#endif
+    }
+
+    /// Return the maximum number of full and deleted slots before growing.
+    static unsigned MaxLoad(unsigned capacity) { return capacity - capacity / 8; }
+
+    /// Return the smallest capacity that holds the given number of elements without growing.
+    static unsigned CapacityFor(unsigned numElements);
+
+    /// Return bitmask of the slots in the group starting at index whose control byte equals value.
+    unsigned MatchControl(unsigned index, unsigned char value) const
+    {
+#ifdef URHO3D_SSE
+        __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl_ + index));
+        return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)value)));
+#else
+        unsigned mask = 0;
+        for (unsigned i = 0; i < GROUP_WIDTH; ++i)
+        {
+            if (ctrl_[index + i] == value)
+                mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+    /// Return bitmask of the empty or deleted slots in the group starting at index.
+    unsigned MatchFree(unsigned index) const
+    {
+#ifdef URHO3D_SSE
+        return (unsigned)_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl_ + index)));
+#else
+        unsigned mask = 0;
+        for (unsigned i = 0; i < GROUP_WIDTH; ++i)
+        {
+            if (ctrl_[index + i] & 0x80u)
+                mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+    /// Return the first group to probe for a mixed hash. The slot array must be allocated.
+    unsigned FirstGroup(unsigned hash) const { return (hash >> 7u) & (capacity_ / GROUP_WIDTH - 1); }
+
+    /// Return the next group to probe. Triangular steps visit every group once.
+    unsigned NextGroup(unsigned group, unsigned step) const { return (group + step) & (capacity_ / GROUP_WIDTH - 1); }
+
+    /// Return the first empty or deleted slot on the probe sequence of a mixed hash.
+    unsigned FindFreeIndex(unsigned hash) const
+    {
+        unsigned group = FirstGroup(hash);
+        for (unsigned step = 1;; ++step)
+        {
+            unsigned mask = MatchFree(group * GROUP_WIDTH);
+            if (mask)
+                return group * GROUP_WIDTH + LowestBit(mask);
+            group = NextGroup(group, step);
+        }
+    }
+
+    /// Mark a free slot full for a mixed hash and update the element count.
+    void ClaimIndex(unsigned index, unsigned hash)
+    {
+        if (ctrl_[index] == CTRL_EMPTY)
+            --growthLeft_;
+        ctrl_[index] = ControlByte(hash);
+        ++size_;
+    }
+
+    /// Mark a full slot free and update the element count. A slot can become empty again if its group still has an empty slot, as probing would have stopped at that group anyway.
+    void ReleaseIndex(unsigned index)
+    {
+        unsigned groupStart = index & ~(GROUP_WIDTH - 1);
+        if (MatchControl(groupStart, CTRL_EMPTY))
+        {
+            ctrl_[index] = CTRL_EMPTY;
+            ++growthLeft_;
+        }
+        else
+            ctrl_[index] = CTRL_DELETED;
+        --size_;
+    }
+
+    /// Return whether a slot is full.
+    bool IsFull(unsigned index) const { return (ctrl_[index] & 0x80u) == 0; }
+
+    /// Return index of the first full slot at or after index, or the capacity if none. The control bytes must be allocated.
+    unsigned NextFull(unsigned index) const
+    {
+        // The control bytes past the capacity are full sentinels, so the scan always stops at the end
+        for (;;)
+        {
+            unsigned mask = ~MatchFree(index) & 0xffffu;
+            if (mask)
+                return index + LowestBit(mask);
+            index += GROUP_WIDTH;
+        }
+    }
+
+    /// Return capacity to rehash to when out of empty slots. Stays the same if mostly deleted slots can be reclaimed.
+    unsigned GrowCapacity() const
+    {
+        if (!capacity_)
+            return MIN_CAPACITY;
+        return size_ < MaxLoad(capacity_) / 2 ? capacity_ : capacity_ << 1u;
+    }
+
+    /// Allocate empty control bytes for a new capacity, which must be a power of two and at least the group width. Return the old control bytes for the caller to free.
+    unsigned char* AllocateControl(unsigned capacity);
+    /// Mark all slots empty.
+    void ResetControl();
+    /// Free the control bytes.
+    void FreeControl();
+
+    /// Control bytes, followed by a group of full sentinels.
+    unsigned char* ctrl_;
+    /// Number of slots, zero or a power of two.
+    unsigned capacity_;
+    /// Number of elements.
+    unsigned size_;
+    /// Number of empty slots that can still be filled before growing.
+    unsigned growthLeft_;
+};
+
+}
@@ -0,0 +1,512 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/FlatHashBase.h"
+#include "../Container/Pair.h"
+#include "../Container/Vector.h"
+
+#include <cassert>
+#include <initializer_list>
+#include <new>
+#include <utility>
+
+namespace Urho3D
+{
+
+/// Open addressing hash map template class. Stores pairs contiguously without per-element allocations. Iteration order is unspecified, and inserting may move pairs, invalidating iterators and pointers to them.
+template <class T, class U> class FlatHashMap : public FlatHashBase
+{
+public:
+    using KeyType = T;
+    using ValueType = U;
+
+    /// Hash map key-value pair with const key.
+    class KeyValue
+    {
+    public:
+        /// Construct with key and value.
+        KeyValue(const T& first, const U& second) :
+            first_(first),
+            second_(second)
+        {
+        }
+
+        /// Copy-construct.
+        KeyValue(const KeyValue& value) :
+            first_(value.first_),
+            second_(value.second_)
+        {
+        }
+
+        /// Move-construct. Copies the key.
+        KeyValue(KeyValue&& value) noexcept :
+            first_(value.first_),
+            second_(std::move(value.second_))
+        {
+        }
+
+        /// Prevent assignment.
+        KeyValue& operator =(const KeyValue& rhs) = delete;
+
+        /// Test for equality with another pair.
+        bool operator ==(const KeyValue& rhs) const { return first_ == rhs.first_ && second_ == rhs.second_; }
+        /// Test for inequality with another pair.
+        bool operator !=(const KeyValue& rhs) const { return first_ != rhs.first_ || second_ != rhs.second_; }
+
+        /// Key.
+        const T first_;
+        /// Value.
+        U second_;
+    };
+
+    /// Flat hash map iterator.
+    struct Iterator
+    {
+        /// Construct.
+        Iterator() = default;
+
+        /// Construct with a map and slot index.
+        Iterator(FlatHashMap* map, unsigned index) :
+            map_(map),
+            index_(index)
+        {
+        }
+
+        /// Preincrement the slot index.
+        Iterator& operator ++()
+        {
+            index_ = map_->NextFull(index_ + 1);
+            return *this;
+        }
+
+        /// Postincrement the slot index.
+        Iterator operator ++(int)
+        {
+            Iterator it = *this;
+            index_ = map_->NextFull(index_ + 1);
+            return it;
+        }
+
+        /// Test for equality with another iterator.
+        bool operator ==(const Iterator& rhs) const { return index_ == rhs.index_; }
+        /// Test for inequality with another iterator.
+        bool operator !=(const Iterator& rhs) const { return index_ != rhs.index_; }
+
+        /// Point to the pair.
+        KeyValue* operator ->() const { return map_->slots_ + index_; }
+
+        /// Dereference the pair.
+        KeyValue& operator *() const { return map_->slots_[index_]; }
+
+        /// Map.
+        FlatHashMap* map_{};
+        /// Slot index.
+        unsigned index_{};
+    };
+
+    /// Flat hash map const iterator.
+    struct ConstIterator
+    {
+        /// Construct.
+        ConstIterator() = default;
+
+        /// Construct with a map and slot index.
+        ConstIterator(const FlatHashMap* map, unsigned index) :
+            map_(map),
+            index_(index)
+        {
+        }
+
+        /// Construct from a non-const iterator.
+        ConstIterator(const Iterator& rhs) :        // NOLINT(google-explicit-constructor)
+            map_(rhs.map_),
+            index_(rhs.index_)
+        {
+        }
+
+        /// Preincrement the slot index.
+        ConstIterator& operator ++()
+        {
+            index_ = map_->NextFull(index_ + 1);
+            return *this;
+        }
+
+        /// Postincrement the slot index.
+        ConstIterator operator ++(int)
+        {
+            ConstIterator it = *this;
+            index_ = map_->NextFull(index_ + 1);
+            return it;
+        }
+
+        /// Test for equality with another iterator.
+        bool operator ==(const ConstIterator& rhs) const { return index_ == rhs.index_; }
+        /// Test for inequality with another iterator.
+        bool operator !=(const ConstIterator& rhs) const { return index_ != rhs.index_; }
+
+        /// Point to the pair.
+        const KeyValue* operator ->() const { return map_->slots_ + index_; }
+
+        /// Dereference the pair.
+        const KeyValue& operator *() const { return map_->slots_[index_]; }
+
+        /// Map.
+        const FlatHashMap* map_{};
+        /// Slot index.
+        unsigned index_{};
+    };
+
+    /// Construct empty.
+    FlatHashMap() = default;
+
+    /// Construct from another hash map.
+    FlatHashMap(const FlatHashMap<T, U>& map)
+    {
+        Reserve(map.Size());
+        Insert(map);
+    }
+
+    /// Move-construct from another hash map.
+    FlatHashMap(FlatHashMap<T, U> && map) noexcept
+    {
+        Swap(map);
+    }
+
+    /// Aggregate initialization constructor.
+    FlatHashMap(const std::initializer_list<Pair<T, U>>& list)
+    {
+        Reserve((unsigned)list.size());
+        for (auto it = list.begin(); it != list.end(); it++)
+            Insert(*it);
+    }
+
+    /// Destruct.
+    ~FlatHashMap()
+    {
+        Clear();
+        ::operator delete(slots_);
+        FreeControl();
+    }
+
+    /// Assign a hash map.
+    FlatHashMap& operator =(const FlatHashMap<T, U>& rhs)
+    {
+        if (&rhs != this)
+        {
+            Clear();
+            Reserve(rhs.Size());
+            Insert(rhs);
+        }
+        return *this;
+    }
+
+    /// Move-assign a hash map.
+    FlatHashMap& operator =(FlatHashMap<T, U> && rhs) noexcept
+    {
+        assert(&rhs != this);
+        Swap(rhs);
+        return *this;
+    }
+
+    /// Add-assign a pair.
+    FlatHashMap& operator +=(const Pair<T, U>& rhs)
+    {
+        Insert(rhs);
+        return *this;
+    }
+
+    /// Add-assign a hash map.
+    FlatHashMap& operator +=(const FlatHashMap<T, U>& rhs)
+    {
+        Insert(rhs);
+        return *this;
+    }
+
+    /// Test for equality with another hash map.
+    bool operator ==(const FlatHashMap<T, U>& rhs) const
+    {
+        if (rhs.Size() != Size())
+            return false;
+
+        for (ConstIterator i = Begin(); i != End(); ++i)
+        {
+            ConstIterator j = rhs.Find(i->first_);
+            if (j == rhs.End() || j->second_ != i->second_)
+                return false;
+        }
+
+        return true;
+    }
+
+    /// Test for inequality with another hash map.
+    bool operator !=(const FlatHashMap<T, U>& rhs) const { return !(*this == rhs); }
+
+    /// Index the map. Create a new pair if key not found.
+    U& operator [](const T& key)
+    {
+        bool exists;
+        unsigned index = InsertIndex(key, U(), exists);
+        return slots_[index].second_;
+    }
+
+    /// Index the map. Return null if key is not found, does not create a new pair.
+    U* operator [](const T& key) const
+    {
+        unsigned index = FindIndex(key);
+        return index != NOT_FOUND ? &slots_[index].second_ : nullptr;
+    }
+
+    /// Swap with another hash map.
+    void Swap(FlatHashMap<T, U>& rhs)
+    {
+        FlatHashBase::Swap(rhs);
+        Urho3D::Swap(slots_, rhs.slots_);
+    }
+
+    /// Insert a pair. Return an iterator to it.
+    Iterator Insert(const Pair<T, U>& pair)
+    {
+        bool exists;
+        return Insert(pair, exists);
+    }
+
+    /// Insert a pair. Return iterator and set exists flag according to whether the key already existed.
+    Iterator Insert(const Pair<T, U>& pair, bool& exists)
+    {
+        unsigned index = InsertIndex(pair.first_, pair.second_, exists);
+        if (exists)
+            slots_[index].second_ = pair.second_;
+        return Iterator(this, index);
+    }
+
+    /// Insert a map.
+    void Insert(const FlatHashMap<T, U>& map)
+    {
+        for (ConstIterator it = map.Begin(); it != map.End(); ++it)
+            Insert(MakePair(it->first_, it->second_));
+    }
+
+    /// Insert a pair by iterator. Return iterator to the value.
+    Iterator Insert(const ConstIterator& it) { return Insert(MakePair(it->first_, it->second_)); }
+
+    /// Erase a pair by key. Return true if was found.
+    bool Erase(const T& key)
+    {
+        unsigned index = FindIndex(key);
+        if (index == NOT_FOUND)
+            return false;
+
+        EraseIndex(index);
+        return true;
+    }
+
+    /// Erase a pair by iterator. Return iterator to the next pair.
+    Iterator Erase(const Iterator& it)
+    {
+        if (it.index_ >= capacity_)
+            return End();
+
+        EraseIndex(it.index_);
+        return Iterator(this, NextFull(it.index_ + 1));
+    }
+
+    /// Clear the map. Keeps the allocated slots.
+    void Clear()
+    {
+        if (!size_)
+            return;
+
+        for (unsigned i = NextFull(0); i < capacity_; i = NextFull(i + 1))
+            (slots_ + i)->~KeyValue();
+        ResetControl();
+    }
+
+    /// Allocate slots for at least the given number of elements.
+    void Reserve(unsigned numElements)
+    {
+        if (numElements > MaxLoad(capacity_))
+            Rehash(CapacityFor(numElements));
+    }
+
+    /// Return iterator to the pair with key, or end iterator if not found.
+    Iterator Find(const T& key)
+    {
+        unsigned index = FindIndex(key);
+        return index != NOT_FOUND ? Iterator(this, index) : End();
+    }
+
+    /// Return const iterator to the pair with key, or end iterator if not found.
+    ConstIterator Find(const T& key) const
+    {
+        unsigned index = FindIndex(key);
+        return index != NOT_FOUND ? ConstIterator(this, index) : End();
+    }
+
+    /// Return whether contains a pair with key.
+    bool Contains(const T& key) const { return FindIndex(key) != NOT_FOUND; }
+
+    /// Try to copy value to output. Return true if was found.
+    bool TryGetValue(const T& key, U& out) const
+    {
+        unsigned index = FindIndex(key);
+        if (index == NOT_FOUND)
+            return false;
+
+        out = slots_[index].second_;
+        return true;
+    }
+
+    /// Return all the keys.
+    Vector<T> Keys() const
+    {
+        Vector<T> result;
+        result.Reserve(Size());
+        for (ConstIterator i = Begin(); i != End(); ++i)
+            result.Push(i->first_);
+        return result;
+    }
+
+    /// Return all the values.
+    Vector<U> Values() const
+    {
+        Vector<U> result;
+        result.Reserve(Size());
+        for (ConstIterator i = Begin(); i != End(); ++i)
+            result.Push(i->second_);
+        return result;
+    }
+
+    /// Return iterator to the beginning.
+    Iterator Begin() { return Iterator(this, size_ ? NextFull(0) : capacity_); }
+
+    /// Return iterator to the beginning.
+    ConstIterator Begin() const { return ConstIterator(this, size_ ? NextFull(0) : capacity_); }
+
+    /// Return iterator to the end.
+    Iterator End() { return Iterator(this, capacity_); }
+
+    /// Return iterator to the end.
+    ConstIterator End() const { return ConstIterator(this, capacity_); }
+
+    /// Return first pair.
+    const KeyValue& Front() const { return *Begin(); }
+
+private:
+    /// Return slot index of a key, or NOT_FOUND.
+    unsigned FindIndex(const T& key) const { return size_ ? FindIndex(key, MixHash(MakeHash(key))) : NOT_FOUND; }
+
+    /// Return slot index of a key with mixed hash, or NOT_FOUND. The slots must be allocated.
+    unsigned FindIndex(const T& key, unsigned hash) const
+    {
+        unsigned char control = ControlByte(hash);
+        unsigned group = FirstGroup(hash);
+        for (unsigned step = 1;; ++step)
+        {
+            unsigned groupStart = group * GROUP_WIDTH;
+            for (unsigned mask = MatchControl(groupStart, control); mask; mask &= mask - 1)
+            {
+                unsigned index = groupStart + LowestBit(mask);
+                if (slots_[index].first_ == key)
+                    return index;
+            }
+            // An empty slot ends the probe sequence
+            if (MatchControl(groupStart, CTRL_EMPTY))
+                return NOT_FOUND;
+            group = NextGroup(group, step);
+        }
+    }
+
+    /// Return slot index of a key. If not found, construct a new pair from the key and value in a free slot.
+    unsigned InsertIndex(const T& key, const U& value, bool& exists)
+    {
+        unsigned hash = MixHash(MakeHash(key));
+        unsigned index = size_ ? FindIndex(key, hash) : NOT_FOUND;
+        exists = index != NOT_FOUND;
+        if (exists)
+            return index;
+
+        if (!growthLeft_)
+        {
+            // The key or value may refer to a pair of this map, which the rehash moves, so copy them first
+            KeyValue pair(key, value);
+            Rehash(GrowCapacity());
+            index = FindFreeIndex(hash);
+            ClaimIndex(index, hash);
+            new(slots_ + index) KeyValue(std::move(pair));
+            return index;
+        }
+
+        index = FindFreeIndex(hash);
+        ClaimIndex(index, hash);
+        new(slots_ + index) KeyValue(key, value);
+        return index;
+    }
+
+    /// Destruct the pair in a slot and free it.
+    void EraseIndex(unsigned index)
+    {
+        (slots_ + index)->~KeyValue();
+        ReleaseIndex(index);
+    }
+
+    /// Move all pairs to newly allocated slots, dropping deleted slots.
+    void Rehash(unsigned capacity)
+    {
+        KeyValue* oldSlots = slots_;
+        unsigned oldCapacity = capacity_;
+        unsigned oldSize = size_;
+
+        size_ = 0;
+        unsigned char* oldCtrl = AllocateControl(capacity);
+        slots_ = static_cast<KeyValue*>(::operator new(capacity * sizeof(KeyValue)));
+
+        for (unsigned i = 0; i < oldCapacity && size_ < oldSize; ++i)
+        {
+            if (oldCtrl[i] & 0x80u)
+                continue;
+
+            unsigned hash = MixHash(MakeHash(oldSlots[i].first_));
+            unsigned index = FindFreeIndex(hash);
+            ClaimIndex(index, hash);
+            new(slots_ + index) KeyValue(std::move(oldSlots[i]));
+            (oldSlots + i)->~KeyValue();
+        }
+
+        delete[] oldCtrl;
+        ::operator delete(oldSlots);
+    }
+
+    /// Pair storage, constructed in full slots only.
+    KeyValue* slots_{};
+};
+
+template <class T, class U> typename Urho3D::FlatHashMap<T, U>::ConstIterator begin(const Urho3D::FlatHashMap<T, U>& v) { return v.Begin(); }
+
+template <class T, class U> typename Urho3D::FlatHashMap<T, U>::ConstIterator end(const Urho3D::FlatHashMap<T, U>& v) { return v.End(); }
+
+template <class T, class U> typename Urho3D::FlatHashMap<T, U>::Iterator begin(Urho3D::FlatHashMap<T, U>& v) { return v.Begin(); }
+
+template <class T, class U> typename Urho3D::FlatHashMap<T, U>::Iterator end(Urho3D::FlatHashMap<T, U>& v) { return v.End(); }
+
+}
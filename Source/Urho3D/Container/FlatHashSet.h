@@ -0,0 +1,426 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/FlatHashBase.h"
+#include "../Container/Vector.h"
+
+#include <cassert>
+#include <initializer_list>
+#include <new>
+#include <utility>
+
+namespace Urho3D
+{
+
+/// Open addressing hash set template class. Stores keys contiguously without per-element allocations. Iteration order is unspecified, and inserting may move keys, invalidating iterators and pointers to them.
+template <class T> class FlatHashSet : public FlatHashBase
+{
+public:
+    using KeyType = T;
+
+    /// Flat hash set iterator.
+    struct Iterator
+    {
+        /// Construct.
+        Iterator() = default;
+
+        /// Construct with a set and slot index.
+        Iterator(FlatHashSet* set, unsigned index) :
+            set_(set),
+            index_(index)
+        {
+        }
+
+        /// Preincrement the slot index.
+        Iterator& operator ++()
+        {
+            index_ = set_->NextFull(index_ + 1);
+            return *this;
+        }
+
+        /// Postincrement the slot index.
+        Iterator operator ++(int)
+        {
+            Iterator it = *this;
+            index_ = set_->NextFull(index_ + 1);
+            return it;
+        }
+
+        /// Test for equality with another iterator.
+        bool operator ==(const Iterator& rhs) const { return index_ == rhs.index_; }
+        /// Test for inequality with another iterator.
+        bool operator !=(const Iterator& rhs) const { return index_ != rhs.index_; }
+
+        /// Point to the key.
+        const T* operator ->() const { return set_->slots_ + index_; }
+
+        /// Dereference the key.
+        const T& operator *() const { return set_->slots_[index_]; }
+
+        /// Set.
+        FlatHashSet* set_{};
+        /// Slot index.
+        unsigned index_{};
+    };
+
+    /// Flat hash set const iterator.
+    struct ConstIterator
+    {
+        /// Construct.
+        ConstIterator() = default;
+
+        /// Construct with a set and slot index.
+        ConstIterator(const FlatHashSet* set, unsigned index) :
+            set_(set),
+            index_(index)
+        {
+        }
+
+        /// Construct from a non-const iterator.
+        ConstIterator(const Iterator& rhs) :        // NOLINT(google-explicit-constructor)
+            set_(rhs.set_),
+            index_(rhs.index_)
+        {
+        }
+
+        /// Preincrement the slot index.
+        ConstIterator& operator ++()
+        {
+            index_ = set_->NextFull(index_ + 1);
+            return *this;
+        }
+
+        /// Postincrement the slot index.
+        ConstIterator operator ++(int)
+        {
+            ConstIterator it = *this;
+            index_ = set_->NextFull(index_ + 1);
+            return it;
+        }
+
+        /// Test for equality with another iterator.
+        bool operator ==(const ConstIterator& rhs) const { return index_ == rhs.index_; }
+        /// Test for inequality with another iterator.
+        bool operator !=(const ConstIterator& rhs) const { return index_ != rhs.index_; }
+
+        /// Point to the key.
+        const T* operator ->() const { return set_->slots_ + index_; }
+
+        /// Dereference the key.
+        const T& operator *() const { return set_->slots_[index_]; }
+
+        /// Set.
+        const FlatHashSet* set_{};
+        /// Slot index.
+        unsigned index_{};
+    };
+
+    /// Construct empty.
+    FlatHashSet() = default;
+
+    /// Construct from another hash set.
+    FlatHashSet(const FlatHashSet<T>& set)
+    {
+        Reserve(set.Size());
+        Insert(set);
+    }
+
+    /// Move-construct from another hash set.
+    FlatHashSet(FlatHashSet<T> && set) noexcept
+    {
+        Swap(set);
+    }
+
+    /// Aggregate initialization constructor.
+    FlatHashSet(const std::initializer_list<T>& list)
+    {
+        Reserve((unsigned)list.size());
+        for (auto it = list.begin(); it != list.end(); it++)
+            Insert(*it);
+    }
+
+    /// Destruct.
+    ~FlatHashSet()
+    {
+        Clear();
+        ::operator delete(slots_);
+        FreeControl();
+    }
+
+    /// Assign a hash set.
+    FlatHashSet& operator =(const FlatHashSet<T>& rhs)
+    {
+        if (&rhs != this)
+        {
+            Clear();
+            Reserve(rhs.Size());
+            Insert(rhs);
+        }
+        return *this;
+    }
+
+    /// Move-assign a hash set.
+    FlatHashSet& operator =(FlatHashSet<T> && rhs) noexcept
+    {
+        assert(&rhs != this);
+        Swap(rhs);
+        return *this;
+    }
+
+    /// Add-assign a value.
+    FlatHashSet& operator +=(const T& rhs)
+    {
+        Insert(rhs);
+        return *this;
+    }
+
+    /// Add-assign a hash set.
+    FlatHashSet& operator +=(const FlatHashSet<T>& rhs)
+    {
+        Insert(rhs);
+        return *this;
+    }
+
+    /// Test for equality with another hash set.
+    bool operator ==(const FlatHashSet<T>& rhs) const
+    {
+        if (rhs.Size() != Size())
+            return false;
+
+        for (ConstIterator it = Begin(); it != End(); ++it)
+        {
+            if (!rhs.Contains(*it))
+                return false;
+        }
+
+        return true;
+    }
+
+    /// Test for inequality with another hash set.
+    bool operator !=(const FlatHashSet<T>& rhs) const { return !(*this == rhs); }
+
+    /// Swap with another hash set.
+    void Swap(FlatHashSet<T>& rhs)
+    {
+        FlatHashBase::Swap(rhs);
+        Urho3D::Swap(slots_, rhs.slots_);
+    }
+
+    /// Insert a key. Return an iterator to it.
+    Iterator Insert(const T& key)
+    {
+        bool exists;
+        return Insert(key, exists);
+    }
+
+    /// Insert a key. Return an iterator and set exists flag according to whether the key already existed.
+    Iterator Insert(const T& key, bool& exists)
+    {
+        unsigned hash = MixHash(MakeHash(key));
+        unsigned index = size_ ? FindIndex(key, hash) : NOT_FOUND;
+        exists = index != NOT_FOUND;
+        if (!exists)
+        {
+            if (!growthLeft_)
+            {
+                // The key may refer to a key of this set, which the rehash moves, so copy it first
+                T keyCopy(key);
+                Rehash(GrowCapacity());
+                index = FindFreeIndex(hash);
+                ClaimIndex(index, hash);
+                new(slots_ + index) T(std::move(keyCopy));
+            }
+            else
+            {
+                index = FindFreeIndex(hash);
+                ClaimIndex(index, hash);
+                new(slots_ + index) T(key);
+            }
+        }
+        return Iterator(this, index);
+    }
+
+    /// Insert a set.
+    void Insert(const FlatHashSet<T>& set)
+    {
+        for (ConstIterator it = set.Begin(); it != set.End(); ++it)
+            Insert(*it);
+    }
+
+    /// Insert a key by iterator. Return iterator to the value.
+    Iterator Insert(const ConstIterator& it) { return Insert(*it); }
+
+    /// Erase a key. Return true if was found.
+    bool Erase(const T& key)
+    {
+        unsigned index = FindIndex(key);
+        if (index == NOT_FOUND)
+            return false;
+
+        EraseIndex(index);
+        return true;
+    }
+
+    /// Erase a key by iterator. Return iterator to the next key.
+    Iterator Erase(const Iterator& it)
+    {
+        if (it.index_ >= capacity_)
+            return End();
+
+        EraseIndex(it.index_);
+        return Iterator(this, NextFull(it.index_ + 1));
+    }
+
+    /// Clear the set. Keeps the allocated slots.
+    void Clear()
+    {
+        if (!size_)
+            return;
+
+        for (unsigned i = NextFull(0); i < capacity_; i = NextFull(i + 1))
+            (slots_ + i)->~T();
+        ResetControl();
+    }
+
+    /// Allocate slots for at least the given number of keys.
+    void Reserve(unsigned numElements)
+    {
+        if (numElements > MaxLoad(capacity_))
+            Rehash(CapacityFor(numElements));
+    }
+
+    /// Return iterator to the key, or end iterator if not found.
+    Iterator Find(const T& key)
+    {
+        unsigned index = FindIndex(key);
+        return index != NOT_FOUND ? Iterator(this, index) : End();
+    }
+
+    /// Return const iterator to the key, or end iterator if not found.
+    ConstIterator Find(const T& key) const
+    {
+        unsigned index = FindIndex(key);
+        return index != NOT_FOUND ? ConstIterator(this, index) : End();
+    }
+
+    /// Return whether contains a key.
+    bool Contains(const T& key) const { return FindIndex(key) != NOT_FOUND; }
+
+    /// Return all the keys.
+    Vector<T> Keys() const
+    {
+        Vector<T> result;
+        result.Reserve(Size());
+        for (ConstIterator i = Begin(); i != End(); ++i)
+            result.Push(*i);
+        return result;
+    }
+
+    /// Return iterator to the beginning.
+    Iterator Begin() { return Iterator(this, size_ ? NextFull(0) : capacity_); }
+
+    /// Return iterator to the beginning.
+    ConstIterator Begin() const { return ConstIterator(this, size_ ? NextFull(0) : capacity_); }
+
+    /// Return iterator to the end.
+    Iterator End() { return Iterator(this, capacity_); }
+
+    /// Return iterator to the end.
+    ConstIterator End() const { return ConstIterator(this, capacity_); }
+
+    /// Return first key.
+    const T& Front() const { return *Begin(); }
+
+private:
+    /// Return slot index of a key, or NOT_FOUND.
+    unsigned FindIndex(const T& key) const { return size_ ? FindIndex(key, MixHash(MakeHash(key))) : NOT_FOUND; }
+
+    /// Return slot index of a key with mixed hash, or NOT_FOUND. The slots must be allocated.
+    unsigned FindIndex(const T& key, unsigned hash) const
+    {
+        unsigned char control = ControlByte(hash);
+        unsigned group = FirstGroup(hash);
+        for (unsigned step = 1;; ++step)
+        {
+            unsigned groupStart = group * GROUP_WIDTH;
+            for (unsigned mask = MatchControl(groupStart, control); mask; mask &= mask - 1)
+            {
+                unsigned index = groupStart + LowestBit(mask);
+                if (slots_[index] == key)
+                    return index;
+            }
+            // An empty slot ends the probe sequence
+            if (MatchControl(groupStart, CTRL_EMPTY))
+                return NOT_FOUND;
+            group = NextGroup(group, step);
+        }
+    }
+
+    /// Destruct the key in a slot and free it.
+    void EraseIndex(unsigned index)
+    {
+        (slots_ + index)->~T();
+        ReleaseIndex(index);
+    }
+
+    /// Move all keys to newly allocated slots, dropping deleted slots.
+    void Rehash(unsigned capacity)
+    {
+        T* oldSlots = slots_;
+        unsigned oldCapacity = capacity_;
+        unsigned oldSize = size_;
+
+        size_ = 0;
+        unsigned char* oldCtrl = AllocateControl(capacity);
+        slots_ = static_cast<T*>(::operator new(capacity * sizeof(T)));
+
+        for (unsigned i = 0; i < oldCapacity && size_ < oldSize; ++i)
+        {
+            if (oldCtrl[i] & 0x80u)
+                continue;
+
+            unsigned hash = MixHash(MakeHash(oldSlots[i]));
+            unsigned index = FindFreeIndex(hash);
+            ClaimIndex(index, hash);
+            new(slots_ + index) T(std::move(oldSlots[i]));
+            (oldSlots + i)->~T();
+        }
+
+        delete[] oldCtrl;
+        ::operator delete(oldSlots);
+    }
+
+    /// Key storage, constructed in full slots only.
+    T* slots_{};
+};
+
+template <class T> typename Urho3D::FlatHashSet<T>::ConstIterator begin(const Urho3D::FlatHashSet<T>& v) { return v.Begin(); }
+
+template <class T> typename Urho3D::FlatHashSet<T>::ConstIterator end(const Urho3D::FlatHashSet<T>& v) { return v.End(); }
+
+template <class T> typename Urho3D::FlatHashSet<T>::Iterator begin(Urho3D::FlatHashSet<T>& v) { return v.Begin(); }
+
+template <class T> typename Urho3D::FlatHashSet<T>::Iterator end(Urho3D::FlatHashSet<T>& v) { return v.End(); }
+
+}
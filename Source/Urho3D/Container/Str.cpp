@@ -179,7 +179,7 @@ String::String(char value, unsigned length) :
 
 String::~String()
 {
-	if (capacity_)
+	if (buffer_ != inline_ && capacity_)
 		CMemoryMgr::Instance().Free(buffer_, capacity_);
 }
 
@@ -423,35 +423,45 @@ String::Iterator String::Erase(const String::Iterator& start, const String::Iter
 
 void String::Resize(unsigned newLength)
 {
-    if (!capacity_)
+    if (buffer_ == &endZero)
     {
         // If zero length requested, do not allocate buffer yet
         if (!newLength)
             return;
 
-        // Calculate initial capacity
-        capacity_ = newLength + 1;
-        if (capacity_ < MIN_CAPACITY)
-            capacity_ = MIN_CAPACITY;
+        // Short strings fit in the inline buffer
+        if (newLength < INLINE_CAPACITY)
+            buffer_ = inline_;
+        else
+        {
+            // Calculate initial capacity
+            capacity_ = newLength + 1;
+            if (capacity_ < MIN_CAPACITY)
+                capacity_ = MIN_CAPACITY;
 
-        buffer_ = (char*)CMemoryMgr::Instance().Allocate(capacity_);
+            buffer_ = (char*)CMemoryMgr::Instance().Allocate(capacity_);
+        }
     }
     else
     {
-        if (newLength && capacity_ < newLength + 1)
+        unsigned capacity = Capacity();
+        if (newLength && capacity < newLength + 1)
         {
-			unsigned uPrevCapacity = capacity_;
+			unsigned uPrevCapacity = capacity;
 
             // Increase the capacity with half each time it is exceeded
-            while (capacity_ < newLength + 1)
-                capacity_ += (capacity_ + 1) >> 1u;
+            while (capacity < newLength + 1)
+                capacity += (capacity + 1) >> 1u;
 
-            char* newBuffer = (char*)CMemoryMgr::Instance().Allocate(capacity_);
+            char* newBuffer = (char*)CMemoryMgr::Instance().Allocate(capacity);
             // Move the existing data to the new buffer, then delete the old buffer
             if (length_)
                 CopyChars(newBuffer, buffer_, length_);
-			CMemoryMgr::Instance().Free(buffer_, uPrevCapacity);
+            if (buffer_ != inline_)
+                CMemoryMgr::Instance().Free(buffer_, uPrevCapacity);
 
+            // Set capacity only now, as it overlaps the inline buffer
+            capacity_ = capacity;
             buffer_ = newBuffer;
         }
     }
@@ -464,22 +474,29 @@ void String::Reserve(unsigned newCapacity)
 {
     if (newCapacity < length_ + 1)
         newCapacity = length_ + 1;
-    if (newCapacity == capacity_)
+    // Use the inline buffer when the string fits
+    if (newCapacity <= INLINE_CAPACITY)
+        newCapacity = INLINE_CAPACITY;
+
+    unsigned capacity = Capacity();
+    if (newCapacity == capacity)
         return;
 
-    char* newBuffer = (char*)CMemoryMgr::Instance().Allocate(newCapacity);
+    char* oldBuffer = buffer_;
+    char* newBuffer = newCapacity == INLINE_CAPACITY ? inline_ : (char*)CMemoryMgr::Instance().Allocate(newCapacity);
     // Move the existing data to the new buffer, then delete the old buffer
-    CopyChars(newBuffer, buffer_, length_ + 1);
-    if (capacity_)
-		CMemoryMgr::Instance().Free(buffer_, capacity_);
+    CopyChars(newBuffer, oldBuffer, length_ + 1);
+    if (oldBuffer != &endZero && oldBuffer != inline_)
+		CMemoryMgr::Instance().Free(oldBuffer, capacity);
 
-    capacity_ = newCapacity;
+    if (newBuffer != inline_)
+        capacity_ = newCapacity;
     buffer_ = newBuffer;
 }
 
 void String::Compact()
 {
-    if (capacity_)
+    if (buffer_ != &endZero)
         Reserve(length_ + 1);
 }
 
@@ -490,9 +507,23 @@ void String::Clear()
 
 void String::Swap(String& str)
 {
+    bool isInline = buffer_ == inline_;
+    bool otherIsInline = str.buffer_ == str.inline_;
+
+    // Swapping the inline buffers also swaps the capacities that overlap them
+    char temp[INLINE_CAPACITY];
+    memcpy(temp, inline_, INLINE_CAPACITY);
+    memcpy(inline_, str.inline_, INLINE_CAPACITY);
+    memcpy(str.inline_, temp, INLINE_CAPACITY);
+
     Urho3D::Swap(length_, str.length_);
-    Urho3D::Swap(capacity_, str.capacity_);
     Urho3D::Swap(buffer_, str.buffer_);
+
+    // Inline buffers can not be exchanged by pointer
+    if (otherIsInline)
+        buffer_ = inline_;
+    if (isInline)
+        str.buffer_ = str.inline_;
 }
 
 String String::Substring(unsigned pos) const
@@ -424,7 +424,7 @@ public:
     unsigned Length() const { return length_; }
 
     /// Return buffer capacity.
-    unsigned Capacity() const { return capacity_; }
+    unsigned Capacity() const { return buffer_ == inline_ ? INLINE_CAPACITY : capacity_; }
 
     /// Return whether the string is empty.
     bool Empty() const { return length_ == 0; }
@@ -505,6 +505,8 @@ public:
     static const unsigned NPOS = 0xffffffff;
     /// Initial dynamic allocation size.
     static const unsigned MIN_CAPACITY = 8;
+    /// Size of the inline buffer used for short strings, including the end zero. It overlaps the capacity, but still grows the string object from two to three pointers in size on 64-bit targets.
+    static const unsigned INLINE_CAPACITY = (unsigned)(sizeof(void*) * 2 - sizeof(unsigned));
     /// Empty string.
     static const String EMPTY;
 
@@ -539,9 +541,14 @@ private:
 protected:
     /// String length.
     unsigned length_;
-    /// Capacity, zero if buffer not allocated.
-    unsigned capacity_;
-    /// String buffer, point to &endZero if buffer is not allocated.
+    union
+    {
+        /// Capacity, zero if buffer not allocated. Not used while the inline buffer is in use.
+        unsigned capacity_;
+        /// Inline buffer for short strings to avoid a heap allocation.
+        char inline_[INLINE_CAPACITY];
+    };
+    /// String buffer, point to &endZero if buffer is not allocated, or to the inline buffer.
     char* buffer_;
 
     /// End zero for empty strings.
@@ -56,7 +56,9 @@ enum AttributeMode
 };
 URHO3D_FLAGSET(AttributeMode, AttributeModeFlags);
 
+class Deserializer;
 class Serializable;
+class Serializer;
 
 /// Abstract base class for invoking attribute accessors.
 class URHO3D_API AttributeAccessor : public RefCounted
@@ -66,6 +68,12 @@ public:
     virtual void Get(const Serializable* ptr, Variant& dest) const = 0;
     /// Set the attribute.
     virtual void Set(Serializable* ptr, const Variant& src) = 0;
+    /// Return whether the attribute can be read and written as binary data directly, without conversion through Variant.
+    virtual bool IsDirect() const { return false; }
+    /// Read the attribute directly from binary data. Only valid when IsDirect() returns true.
+    virtual void ReadDirect(Serializable* ptr, Deserializer& source) { }
+    /// Write the attribute directly as binary data. Only valid when IsDirect() returns true. Return true if successful.
+    virtual bool WriteDirect(const Serializable* ptr, Serializer& dest) const { return false; }
 };
 
 /// Description of an automatically serializable variable.
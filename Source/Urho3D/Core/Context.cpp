@@ -379,6 +379,14 @@ Object* Context::GetEventSender() const
         return nullptr;
 }
 
+const void* Context::GetEventPayload(StringHash payloadType) const
+{
+    if (!eventPayloads_.Empty() && eventPayloadTypes_.Back() == payloadType)
+        return eventPayloads_.Back();
+    else
+        return nullptr;
+}
+
 const String& Context::GetTypeName(StringHash objectType) const
 {
     // Search factories to find the hash-to-name mapping
@@ -421,10 +429,10 @@ void Context::AddEventReceiver(Object* receiver, Object* sender, StringHash even
 
 void Context::RemoveEventSender(Object* sender)
 {
-    HashMap<Object*, HashMap<StringHash, SharedPtr<EventReceiverGroup> > >::Iterator i = specificEventReceivers_.Find(sender);
+    FlatHashMap<Object*, FlatHashMap<StringHash, SharedPtr<EventReceiverGroup> > >::Iterator i = specificEventReceivers_.Find(sender);
     if (i != specificEventReceivers_.End())
     {
-        for (HashMap<StringHash, SharedPtr<EventReceiverGroup> >::Iterator j = i->second_.Begin(); j != i->second_.End(); ++j)
+        for (FlatHashMap<StringHash, SharedPtr<EventReceiverGroup> >::Iterator j = i->second_.Begin(); j != i->second_.End(); ++j)
         {
             for (PODVector<Object*>::Iterator k = j->second_->receivers_.Begin(); k != j->second_->receivers_.End(); ++k)
             {
@@ -451,7 +459,7 @@ void Context::RemoveEventReceiver(Object* receiver, Object* sender, StringHash e
         group->Remove(receiver);
 }
 
-void Context::BeginSendEvent(Object* sender, StringHash eventType)
+void Context::BeginSendEvent(Object* sender, StringHash eventType, const void* payload, StringHash payloadType)
 {
 #ifdef URHO3D_PROFILING
     if (EventProfiler::IsActive())
@@ -463,11 +471,15 @@ void Context::BeginSendEvent(Object* sender, StringHash eventType)
 #endif
 
     eventSenders_.Push(sender);
+    eventPayloads_.Push(payload);
+    eventPayloadTypes_.Push(payloadType);
 }
 
 void Context::EndSendEvent()
 {
     eventSenders_.Pop();
+    eventPayloads_.Pop();
+    eventPayloadTypes_.Pop();
 
 #ifdef URHO3D_PROFILING
     if (EventProfiler::IsActive())
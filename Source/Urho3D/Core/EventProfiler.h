@@ -75,12 +75,14 @@ public:
     /// Begin timing a profiling block based on an event ID.
     void BeginBlock(StringHash eventID)
     {
-        // Profiler supports only the main thread currently
+        // Events are only sent from the main thread
         if (!Thread::IsMainThread())
             return;
 
         current_ = static_cast<EventProfilerBlock*>(current_)->GetChild(eventID);
         current_->Begin();
+        if (timelineFrames_ || mainEventDepth_)
+            BeginEvent(current_->name_);
     }
 
 private:
@@ -0,0 +1,220 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Container/Sort.h"
+#include "../Core/EventStatistics.h"
+#include "../Core/Timer.h"
+#include "../IO/Serializer.h"
+
+#include <MemoryCache/MemoryMgr.h>
+
+#include <cstdio>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+bool EventStatistics::active = false;
+
+/// Convert high-resolution timer ticks to microseconds.
+static double TicksToUSec(long long ticks)
+{
+    return (double)ticks * 1000000.0 / (double)HiresTimer::GetFrequency();
+}
+
+/// Return a printable event name. Events not described with URHO3D_EVENT are printed as hashes.
+static String GetEventName(StringHash eventType)
+{
+    const String& name = GetEventNameRegister().GetString(eventType);
+    return name.Empty() ? eventType.ToString() : name;
+}
+
+/// Write a string to a JSON document as a quoted and escaped value.
+static void WriteJSONString(String& output, const char* value)
+{
+    output += '"';
+    for (const char* c = value; *c; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+            output += '\\';
+        output += *c;
+    }
+    output += '"';
+}
+
+/// Compare handler statistics by total time, longest first.
+static bool CompareHandlerTicks(const EventHandlerStatistics* lhs, const EventHandlerStatistics* rhs)
+{
+    return lhs->totalTicks_ > rhs->totalTicks_;
+}
+
+EventStatistics::EventStatistics(Context* context) :
+    Object(context)
+{
+}
+
+EventStatistics::~EventStatistics() = default;
+
+EventStatisticsSample EventStatistics::Sample()
+{
+    return {HiresTimer::GetTicks(), (unsigned long long)EnginePlus::CMemoryMgr::ThreadAllocationCount()};
+}
+
+void EventStatistics::RecordSend(StringHash eventType, unsigned numReceivers, const EventStatisticsSample& start)
+{
+    const EventStatisticsSample end = Sample();
+    const long long ticks = end.ticks_ - start.ticks_;
+
+    EventTypeStatistics& statistics = eventTypes_[eventType];
+    statistics.eventType_ = eventType;
+    ++statistics.sendCount_;
+    statistics.receiverCount_ += numReceivers;
+    statistics.maxReceivers_ = Max(statistics.maxReceivers_, numReceivers);
+    statistics.totalTicks_ += ticks;
+    statistics.maxTicks_ = Max(statistics.maxTicks_, ticks);
+    statistics.allocationCount_ += end.allocations_ - start.allocations_;
+}
+
+void EventStatistics::RecordHandler(StringHash eventType, const TypeInfo* receiverType, const EventStatisticsSample& start)
+{
+    const EventStatisticsSample end = Sample();
+    const long long ticks = end.ticks_ - start.ticks_;
+
+    EventHandlerStatistics& statistics = handlers_[MakePair(eventType, receiverType->GetType())];
+    if (!statistics.callCount_)
+    {
+        statistics.eventType_ = eventType;
+        statistics.receiverType_ = receiverType->GetType();
+        statistics.receiverTypeName_ = receiverType->GetTypeName();
+    }
+    ++statistics.callCount_;
+    statistics.totalTicks_ += ticks;
+    statistics.maxTicks_ = Max(statistics.maxTicks_, ticks);
+    statistics.allocationCount_ += end.allocations_ - start.allocations_;
+}
+
+void EventStatistics::Clear()
+{
+    eventTypes_.Clear();
+    handlers_.Clear();
+}
+
+EventTypeStatistics EventStatistics::GetEventTypeStatistics(StringHash eventType) const
+{
+    // Copy, as the next recorded send may rehash the table
+    const EventTypeStatistics* statistics = eventTypes_[eventType];
+    if (statistics)
+        return *statistics;
+
+    EventTypeStatistics empty;
+    empty.eventType_ = eventType;
+    return empty;
+}
+
+Vector<EventHandlerStatistics> EventStatistics::GetHotHandlers(unsigned maxCount) const
+{
+    PODVector<const EventHandlerStatistics*> sorted;
+    sorted.Reserve(handlers_.Size());
+    for (FlatHashMap<Pair<StringHash, StringHash>, EventHandlerStatistics>::ConstIterator i = handlers_.Begin(); i != handlers_.End(); ++i)
+        sorted.Push(&i->second_);
+
+    Sort(sorted.Begin(), sorted.End(), CompareHandlerTicks);
+    if (sorted.Size() > maxCount)
+        sorted.Resize(maxCount);
+
+    // Copy, as the next recorded handler invocation may rehash the table
+    Vector<EventHandlerStatistics> ret;
+    ret.Reserve(sorted.Size());
+    for (PODVector<const EventHandlerStatistics*>::ConstIterator i = sorted.Begin(); i != sorted.End(); ++i)
+        ret.Push(**i);
+
+    return ret;
+}
+
+bool EventStatistics::SaveCSV(Serializer& dest) const
+{
+    String output = "Event,Receiver,Count,TotalUSec,MaxUSec,Allocations,Receivers,MaxReceivers\n";
+    char line[256];
+
+    for (FlatHashMap<StringHash, EventTypeStatistics>::ConstIterator i = eventTypes_.Begin(); i != eventTypes_.End(); ++i)
+    {
+        const EventTypeStatistics& statistics = i->second_;
+        output += GetEventName(statistics.eventType_);
+        sprintf(line, ",,%llu,%.1f,%.1f,%llu,%llu,%u\n", statistics.sendCount_, TicksToUSec(statistics.totalTicks_),
+            TicksToUSec(statistics.maxTicks_), statistics.allocationCount_, statistics.receiverCount_, statistics.maxReceivers_);
+        output.Append(line);
+    }
+
+    for (FlatHashMap<Pair<StringHash, StringHash>, EventHandlerStatistics>::ConstIterator i = handlers_.Begin(); i != handlers_.End(); ++i)
+    {
+        const EventHandlerStatistics& statistics = i->second_;
+        output += GetEventName(statistics.eventType_);
+        output += ',';
+        output += statistics.receiverTypeName_;
+        sprintf(line, ",%llu,%.1f,%.1f,%llu,,\n", statistics.callCount_, TicksToUSec(statistics.totalTicks_),
+            TicksToUSec(statistics.maxTicks_), statistics.allocationCount_);
+        output.Append(line);
+    }
+
+    return dest.Write(output.CString(), output.Length()) == output.Length();
+}
+
+bool EventStatistics::SaveJSON(Serializer& dest) const
+{
+    String output = "{\"events\":[";
+    char line[256];
+
+    for (FlatHashMap<StringHash, EventTypeStatistics>::ConstIterator i = eventTypes_.Begin(); i != eventTypes_.End(); ++i)
+    {
+        const EventTypeStatistics& statistics = i->second_;
+        output += i == eventTypes_.Begin() ? "\n{\"event\":" : ",\n{\"event\":";
+        WriteJSONString(output, GetEventName(statistics.eventType_).CString());
+        sprintf(line, ",\"sends\":%llu,\"receivers\":%llu,\"maxReceivers\":%u,\"totalUSec\":%.1f,\"maxUSec\":%.1f,\"allocations\":%llu}",
+            statistics.sendCount_, statistics.receiverCount_, statistics.maxReceivers_, TicksToUSec(statistics.totalTicks_),
+            TicksToUSec(statistics.maxTicks_), statistics.allocationCount_);
+        output.Append(line);
+    }
+
+    output += "\n],\"handlers\":[";
+
+    for (FlatHashMap<Pair<StringHash, StringHash>, EventHandlerStatistics>::ConstIterator i = handlers_.Begin(); i != handlers_.End(); ++i)
+    {
+        const EventHandlerStatistics& statistics = i->second_;
+        output += i == handlers_.Begin() ? "\n{\"event\":" : ",\n{\"event\":";
+        WriteJSONString(output, GetEventName(statistics.eventType_).CString());
+        output += ",\"receiver\":";
+        WriteJSONString(output, statistics.receiverTypeName_.CString());
+        sprintf(line, ",\"calls\":%llu,\"totalUSec\":%.1f,\"maxUSec\":%.1f,\"allocations\":%llu}", statistics.callCount_,
+            TicksToUSec(statistics.totalTicks_), TicksToUSec(statistics.maxTicks_), statistics.allocationCount_);
+        output.Append(line);
+    }
+
+    output += "\n]}\n";
+
+    return dest.Write(output.CString(), output.Length()) == output.Length();
+}
+
+}
@@ -0,0 +1,131 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/FlatHashMap.h"
+#include "../Core/Object.h"
+
+namespace Urho3D
+{
+
+class Serializer;
+
+/// Dispatch statistics of one event type.
+struct URHO3D_API EventTypeStatistics
+{
+    /// Event type.
+    StringHash eventType_;
+    /// Number of sends.
+    unsigned long long sendCount_{};
+    /// Number of receivers invoked over all sends.
+    unsigned long long receiverCount_{};
+    /// Highest number of receivers invoked by one send.
+    unsigned maxReceivers_{};
+    /// Time spent in sends in high-resolution timer ticks, including nested sends.
+    long long totalTicks_{};
+    /// Longest send in high-resolution timer ticks.
+    long long maxTicks_{};
+    /// Memory manager allocations during sends, including nested sends.
+    unsigned long long allocationCount_{};
+};
+
+/// Handler statistics of one receiver class for one event type.
+struct URHO3D_API EventHandlerStatistics
+{
+    /// Event type.
+    StringHash eventType_;
+    /// Receiver class type.
+    StringHash receiverType_;
+    /// Receiver class type name.
+    String receiverTypeName_;
+    /// Number of handler invocations.
+    unsigned long long callCount_{};
+    /// Time spent in handlers in high-resolution timer ticks, including events they send.
+    long long totalTicks_{};
+    /// Longest handler invocation in high-resolution timer ticks.
+    long long maxTicks_{};
+    /// Memory manager allocations during handler invocations.
+    unsigned long long allocationCount_{};
+};
+
+/// Counters sampled at the start of a send or handler invocation.
+struct EventStatisticsSample
+{
+    /// High-resolution timer ticks.
+    long long ticks_;
+    /// Memory manager allocations made by the main thread.
+    unsigned long long allocations_;
+};
+
+/// Event dispatch statistics subsystem. Counts sends, receivers, handler time and allocations per event type and receiver class.
+class URHO3D_API EventStatistics : public Object
+{
+    URHO3D_OBJECT(EventStatistics, Object);
+
+public:
+    /// Construct.
+    explicit EventStatistics(Context* context);
+    /// Destruct.
+    ~EventStatistics() override;
+
+    /// Activate collecting statistics. This incurs two timer reads and a table update per event receiver invocation. By default inactive.
+    static void SetActive(bool newActive) { active = newActive; }
+    /// Return true if active.
+    static bool IsActive() { return active; }
+
+    /// Sample the counters at the start of a send or handler invocation. Called by Object.
+    static EventStatisticsSample Sample();
+    /// Record a finished send. Called by Object.
+    void RecordSend(StringHash eventType, unsigned numReceivers, const EventStatisticsSample& start);
+    /// Record a finished handler invocation. Called by Object.
+    void RecordHandler(StringHash eventType, const TypeInfo* receiverType, const EventStatisticsSample& start);
+
+    /// Reset all statistics.
+    void Clear();
+
+    /// Return statistics per event type.
+    const FlatHashMap<StringHash, EventTypeStatistics>& GetEventTypeStatistics() const { return eventTypes_; }
+    /// Return statistics per event type and receiver class.
+    const FlatHashMap<Pair<StringHash, StringHash>, EventHandlerStatistics>& GetHandlerStatistics() const { return handlers_; }
+    /// Return a copy of the statistics of one event type. The counters are zero if not sent since the last reset.
+    EventTypeStatistics GetEventTypeStatistics(StringHash eventType) const;
+    /// Return copies of the handler statistics that took the most total time, in descending order.
+    Vector<EventHandlerStatistics> GetHotHandlers(unsigned maxCount) const;
+
+    /// Save the statistics as CSV, one row per event type and one per event type and receiver class. Times are in microseconds. Return true if successful.
+    bool SaveCSV(Serializer& dest) const;
+    /// Save the statistics as a JSON document with event type and handler arrays. Times are in microseconds. Return true if successful.
+    bool SaveJSON(Serializer& dest) const;
+
+private:
+    /// Statistics per event type.
+    FlatHashMap<StringHash, EventTypeStatistics> eventTypes_;
+    /// Statistics per event type and receiver class.
+    FlatHashMap<Pair<StringHash, StringHash>, EventHandlerStatistics> handlers_;
+
+    /// Statistics active. Default false.
+    static bool active;
+};
+
+}
@@ -0,0 +1,406 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Core/CoreEvents.h"
+#include "../Core/FrameAllocator.h"
+#include "../Core/Mutex.h"
+
+#include <atomic>
+#include <cstdint>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Default size of the first arena chunk of each thread.
+static const unsigned DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+/// Arena chunk header. The usable memory follows it.
+struct alignas(16) FrameChunk
+{
+    /// Previous chunk of the same frame.
+    FrameChunk* next_;
+    /// Usable size in bytes.
+    unsigned size_;
+
+    /// Return the usable memory.
+    unsigned char* GetData() { return reinterpret_cast<unsigned char*>(this + 1); }
+};
+
+/// Add to a counter which only the owning thread writes.
+static inline void AddCounter(std::atomic<unsigned long long>& counter, unsigned long long value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+/// Linear scratch arena of one thread.
+struct FrameArena
+{
+    /// Destruct. Fold the counters into the totals of exited threads and free the chunks.
+    ~FrameArena();
+
+    /// Add to the allocator's arena list.
+    void Register();
+    /// Make a new current chunk with room for at least the given number of bytes.
+    void AddChunk(unsigned minSize);
+    /// Start a new frame, coalescing the chunks used during the last one.
+    void Reset(unsigned frame);
+    /// Free all chunks.
+    void FreeChunks();
+
+    /// Chunk being allocated from.
+    FrameChunk* current_{};
+    /// Full chunks of this frame.
+    FrameChunk* retired_{};
+    /// Allocation offset in the current chunk.
+    unsigned offset_{};
+    /// Offset where the most recent allocation begins.
+    unsigned lastOffset_{};
+    /// Most recent allocation.
+    void* last_{};
+    /// Bytes allocated this frame.
+    unsigned frameBytes_{};
+    /// Allocations not released yet.
+    unsigned live_{};
+    /// Frame number the arena was last reset on.
+    unsigned frame_{};
+    /// Registered flag.
+    bool registered_{};
+
+    /// Allocations.
+    std::atomic<unsigned long long> allocationCount_{};
+    /// Bytes allocated.
+    std::atomic<unsigned long long> allocatedBytes_{};
+    /// In-place grows.
+    std::atomic<unsigned long long> extendCount_{};
+    /// Chunk allocations.
+    std::atomic<unsigned long long> chunkAllocationCount_{};
+    /// Allocations refused because no frame allocator existed.
+    std::atomic<unsigned long long> heapFallbackCount_{};
+    /// Bytes held in chunks.
+    std::atomic<unsigned long long> reservedBytes_{};
+    /// Most bytes used in a frame.
+    std::atomic<unsigned long long> peakFrameBytes_{};
+};
+
+/// Frame allocator existence flag.
+static std::atomic<bool> active{false};
+/// Frames ended so far.
+static std::atomic<unsigned> frameNumber{0};
+/// Size of the first chunk of each arena.
+static std::atomic<unsigned> chunkSize{DEFAULT_CHUNK_SIZE};
+/// Calling thread's arena.
+static thread_local FrameArena threadArena;
+
+/// Return the mutex guarding the arena list.
+static Mutex& GetArenaMutex()
+{
+    static Mutex mutex;
+    return mutex;
+}
+
+/// Return the arenas of running threads.
+static PODVector<FrameArena*>& GetArenas()
+{
+    static PODVector<FrameArena*> arenas;
+    return arenas;
+}
+
+/// Return the counters of exited threads.
+static FrameAllocatorStats& GetExitedStats()
+{
+    static FrameAllocatorStats stats;
+    return stats;
+}
+
+/// Return the counter values at the last ResetStats().
+static FrameAllocatorStats& GetBaselineStats()
+{
+    static FrameAllocatorStats stats;
+    return stats;
+}
+
+FrameArena::~FrameArena()
+{
+    if (registered_)
+    {
+        MutexLock lock(GetArenaMutex());
+        GetArenas().Remove(this);
+
+        FrameAllocatorStats& exited = GetExitedStats();
+        exited.allocationCount_ += allocationCount_.load(std::memory_order_relaxed);
+        exited.allocatedBytes_ += allocatedBytes_.load(std::memory_order_relaxed);
+        exited.extendCount_ += extendCount_.load(std::memory_order_relaxed);
+        exited.chunkAllocationCount_ += chunkAllocationCount_.load(std::memory_order_relaxed);
+        exited.heapFallbackCount_ += heapFallbackCount_.load(std::memory_order_relaxed);
+        exited.peakFrameBytes_ = Max(exited.peakFrameBytes_, peakFrameBytes_.load(std::memory_order_relaxed));
+    }
+
+    FreeChunks();
+}
+
+void FrameArena::Register()
+{
+    MutexLock lock(GetArenaMutex());
+    GetArenas().Push(this);
+    frame_ = frameNumber.load(std::memory_order_relaxed);
+    registered_ = true;
+}
+
+void FrameArena::AddChunk(unsigned minSize)
+{
+    unsigned size = current_ ? current_->size_ * 2 : chunkSize.load(std::memory_order_relaxed);
+    size = Max(size, minSize);
+
+    auto* chunk = reinterpret_cast<FrameChunk*>(new unsigned char[sizeof(FrameChunk) + size]);
+    chunk->size_ = size;
+    chunk->next_ = nullptr;
+
+    if (current_)
+    {
+        current_->next_ = retired_;
+        retired_ = current_;
+    }
+    current_ = chunk;
+    offset_ = 0;
+    last_ = nullptr;
+
+    AddCounter(chunkAllocationCount_, 1);
+    AddCounter(reservedBytes_, size);
+}
+
+void FrameArena::Reset(unsigned frame)
+{
+    if (frameBytes_ > peakFrameBytes_.load(std::memory_order_relaxed))
+        peakFrameBytes_.store(frameBytes_, std::memory_order_relaxed);
+
+    // If the last frame needed several chunks, replace them with one chunk of the combined size
+    if (retired_)
+    {
+        unsigned total = 0;
+        for (FrameChunk* chunk = retired_; chunk; chunk = chunk->next_)
+            total += chunk->size_;
+        total += current_->size_;
+
+        FreeChunks();
+        AddChunk(total);
+    }
+
+    offset_ = 0;
+    lastOffset_ = 0;
+    last_ = nullptr;
+    frameBytes_ = 0;
+    frame_ = frame;
+}
+
+void FrameArena::FreeChunks()
+{
+    while (retired_)
+    {
+        FrameChunk* next = retired_->next_;
+        AddCounter(reservedBytes_, 0ull - retired_->size_);
+        delete[] reinterpret_cast<unsigned char*>(retired_);
+        retired_ = next;
+    }
+
+    if (current_)
+    {
+        AddCounter(reservedBytes_, 0ull - current_->size_);
+        delete[] reinterpret_cast<unsigned char*>(current_);
+        current_ = nullptr;
+    }
+
+    offset_ = 0;
+    lastOffset_ = 0;
+    last_ = nullptr;
+}
+
+FrameAllocator::FrameAllocator(Context* context) :
+    Object(context)
+{
+    active.store(true);
+    SubscribeToEvent(E_ENDFRAME, URHO3D_HANDLER(FrameAllocator, HandleEndFrame));
+}
+
+FrameAllocator::~FrameAllocator()
+{
+    active.store(false);
+
+    // Give back the calling thread's chunks now. Other threads free theirs when they exit
+    FrameArena& arena = threadArena;
+    if (!arena.live_)
+        arena.FreeChunks();
+}
+
+void FrameAllocator::SetChunkSize(unsigned size)
+{
+    chunkSize.store(Max(size, 1024u));
+}
+
+void FrameAllocator::EndFrame()
+{
+    unsigned frame = frameNumber.fetch_add(1) + 1;
+
+    // Reset the calling thread's arena right away. Other threads reset theirs on their next allocation
+    FrameArena& arena = threadArena;
+    if (arena.registered_ && !arena.live_)
+        arena.Reset(frame);
+}
+
+void FrameAllocator::ResetStats()
+{
+    GetBaselineStats() = FrameAllocatorStats();
+    FrameAllocatorStats stats = GetStats();
+
+    MutexLock lock(GetArenaMutex());
+    GetBaselineStats() = stats;
+    GetExitedStats().peakFrameBytes_ = 0;
+    PODVector<FrameArena*>& arenas = GetArenas();
+    for (unsigned i = 0; i < arenas.Size(); ++i)
+        arenas[i]->peakFrameBytes_.store(0, std::memory_order_relaxed);
+}
+
+unsigned FrameAllocator::GetChunkSize() const
+{
+    return chunkSize.load();
+}
+
+FrameAllocatorStats FrameAllocator::GetStats() const
+{
+    MutexLock lock(GetArenaMutex());
+
+    FrameAllocatorStats stats = GetExitedStats();
+    const FrameAllocatorStats& baseline = GetBaselineStats();
+    const PODVector<FrameArena*>& arenas = GetArenas();
+
+    stats.frameNumber_ = frameNumber.load();
+    stats.numArenas_ = arenas.Size();
+    for (unsigned i = 0; i < arenas.Size(); ++i)
+    {
+        const FrameArena* arena = arenas[i];
+        stats.allocationCount_ += arena->allocationCount_.load(std::memory_order_relaxed);
+        stats.allocatedBytes_ += arena->allocatedBytes_.load(std::memory_order_relaxed);
+        stats.extendCount_ += arena->extendCount_.load(std::memory_order_relaxed);
+        stats.chunkAllocationCount_ += arena->chunkAllocationCount_.load(std::memory_order_relaxed);
+        stats.heapFallbackCount_ += arena->heapFallbackCount_.load(std::memory_order_relaxed);
+        stats.reservedBytes_ += arena->reservedBytes_.load(std::memory_order_relaxed);
+        stats.peakFrameBytes_ = Max(stats.peakFrameBytes_, arena->peakFrameBytes_.load(std::memory_order_relaxed));
+    }
+
+    stats.allocationCount_ -= baseline.allocationCount_;
+    stats.allocatedBytes_ -= baseline.allocatedBytes_;
+    stats.extendCount_ -= baseline.extendCount_;
+    stats.chunkAllocationCount_ -= baseline.chunkAllocationCount_;
+    stats.heapFallbackCount_ -= baseline.heapFallbackCount_;
+    return stats;
+}
+
+void* FrameAllocator::Allocate(unsigned size, unsigned alignment)
+{
+    FrameArena& arena = threadArena;
+    if (!arena.registered_)
+        arena.Register();
+
+    if (!active.load(std::memory_order_relaxed))
+    {
+        AddCounter(arena.heapFallbackCount_, 1);
+        return nullptr;
+    }
+
+    unsigned frame = frameNumber.load(std::memory_order_relaxed);
+    if (arena.frame_ != frame && !arena.live_)
+        arena.Reset(frame);
+
+    if (!alignment)
+        alignment = 1;
+    assert(!(alignment & (alignment - 1)));
+
+    uintptr_t base = arena.current_ ? reinterpret_cast<uintptr_t>(arena.current_->GetData()) : 0;
+    uintptr_t start = (base + arena.offset_ + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    if (!arena.current_ || start - base + size > arena.current_->size_)
+    {
+        arena.AddChunk(size + alignment);
+        base = reinterpret_cast<uintptr_t>(arena.current_->GetData());
+        start = (base + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    }
+
+    arena.lastOffset_ = arena.offset_;
+    arena.offset_ = (unsigned)(start - base) + size;
+    arena.last_ = reinterpret_cast<void*>(start);
+    arena.frameBytes_ += size;
+    ++arena.live_;
+
+    AddCounter(arena.allocationCount_, 1);
+    AddCounter(arena.allocatedBytes_, size);
+    return arena.last_;
+}
+
+bool FrameAllocator::Extend(void* ptr, unsigned oldSize, unsigned newSize)
+{
+    FrameArena& arena = threadArena;
+    if (!ptr || ptr != arena.last_ || newSize < oldSize)
+        return false;
+
+    unsigned start = (unsigned)(static_cast<unsigned char*>(ptr) - arena.current_->GetData());
+    if (start + newSize > arena.current_->size_)
+        return false;
+
+    arena.offset_ = start + newSize;
+    arena.frameBytes_ += newSize - oldSize;
+
+    AddCounter(arena.extendCount_, 1);
+    AddCounter(arena.allocatedBytes_, newSize - oldSize);
+    return true;
+}
+
+void FrameAllocator::Release(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    FrameArena& arena = threadArena;
+    assert(arena.live_);
+    if (arena.live_)
+        --arena.live_;
+
+    // Releasing the most recent allocation gives its space back right away, so nested scratch use behaves like a stack
+    if (ptr == arena.last_)
+    {
+        arena.offset_ = arena.lastOffset_;
+        arena.last_ = nullptr;
+    }
+}
+
+bool FrameAllocator::IsActive()
+{
+    return active.load(std::memory_order_relaxed);
+}
+
+void FrameAllocator::HandleEndFrame(StringHash eventType, VariantMap& eventData)
+{
+    EndFrame();
+}
+
+}
@@ -0,0 +1,278 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Core/Object.h"
+
+#include <cstring>
+#include <type_traits>
+
+namespace Urho3D
+{
+
+/// Frame allocator statistics, summed over all threads.
+struct URHO3D_API FrameAllocatorStats
+{
+    /// Frames ended since the allocator was created.
+    unsigned frameNumber_{};
+    /// Number of threads that have allocated scratch memory and are still running.
+    unsigned numArenas_{};
+    /// Scratch allocations served from the arenas.
+    unsigned long long allocationCount_{};
+    /// Bytes handed out from the arenas.
+    unsigned long long allocatedBytes_{};
+    /// Allocations grown in place instead of copied.
+    unsigned long long extendCount_{};
+    /// Arena chunks allocated from the heap.
+    unsigned long long chunkAllocationCount_{};
+    /// Scratch allocations made while no frame allocator existed, served from the heap by the caller.
+    unsigned long long heapFallbackCount_{};
+    /// Bytes currently held in arena chunks.
+    unsigned long long reservedBytes_{};
+    /// Most bytes one thread has allocated in a single frame.
+    unsigned long long peakFrameBytes_{};
+};
+
+/// %Frame allocator subsystem. Hands out per-thread linear scratch memory which is recycled after E_ENDFRAME.
+class URHO3D_API FrameAllocator : public Object
+{
+    URHO3D_OBJECT(FrameAllocator, Object);
+
+public:
+    /// Construct.
+    explicit FrameAllocator(Context* context);
+    /// Destruct.
+    ~FrameAllocator() override;
+
+    /// Set size of the first arena chunk of each thread.
+    void SetChunkSize(unsigned size);
+    /// End the frame: later allocations on any thread may reuse all scratch memory that is no longer in use. Called automatically on E_ENDFRAME.
+    void EndFrame();
+    /// Clear the cumulative counters.
+    void ResetStats();
+
+    /// Return size of the first arena chunk of each thread.
+    unsigned GetChunkSize() const;
+    /// Return statistics.
+    FrameAllocatorStats GetStats() const;
+
+    /// Allocate scratch memory on the calling thread's arena. Return null if no frame allocator exists, in which case the caller should use the heap.
+    static void* Allocate(unsigned size, unsigned alignment = 16);
+    /// Try to grow the most recent allocation of the calling thread in place. Return true on success.
+    static bool Extend(void* ptr, unsigned oldSize, unsigned newSize);
+    /// Release an allocation on the thread that made it. The memory is reused once all allocations of the thread are released and a frame has ended.
+    static void Release(void* ptr);
+    /// Return whether a frame allocator exists.
+    static bool IsActive();
+
+private:
+    /// Handle end of frame.
+    void HandleEndFrame(StringHash eventType, VariantMap& eventData);
+};
+
+/// Scratch vector of POD values backed by the calling thread's frame allocator. Must stay on the thread and in the frame where it was created.
+template <class T> class FramePODVector
+{
+    static_assert(std::is_trivially_copyable<T>::value, "FramePODVector can only be used with trivially copyable types");
+
+public:
+    using ValueType = T;
+    using Iterator = T*;
+    using ConstIterator = const T*;
+
+    /// Construct empty.
+    FramePODVector() noexcept = default;
+
+    /// Construct with initial capacity.
+    explicit FramePODVector(unsigned capacity)
+    {
+        Reserve(capacity);
+    }
+
+    /// Destruct.
+    ~FramePODVector()
+    {
+        FreeBuffer();
+    }
+
+    /// Prevent copy construction.
+    FramePODVector(const FramePODVector<T>& rhs) = delete;
+    /// Prevent assignment.
+    FramePODVector<T>& operator =(const FramePODVector<T>& rhs) = delete;
+
+    /// Return element at index.
+    T& operator [](unsigned index)
+    {
+        assert(index < size_);
+        return buffer_[index];
+    }
+
+    /// Return const element at index.
+    const T& operator [](unsigned index) const
+    {
+        assert(index < size_);
+        return buffer_[index];
+    }
+
+    /// Add an element at the end.
+    void Push(const T& value)
+    {
+        if (size_ == capacity_)
+            Grow(size_ + 1);
+        buffer_[size_++] = value;
+    }
+
+    /// Remove the last element.
+    void Pop()
+    {
+        if (size_)
+            --size_;
+    }
+
+    /// Resize the vector. New elements are left uninitialized.
+    void Resize(unsigned newSize)
+    {
+        if (newSize > capacity_)
+            Grow(newSize);
+        size_ = newSize;
+    }
+
+    /// Reserve space for at least the given number of elements.
+    void Reserve(unsigned newCapacity)
+    {
+        if (newCapacity > capacity_)
+            Reallocate(newCapacity);
+    }
+
+    /// Clear the vector. Scratch memory is kept until destruction.
+    void Clear() { size_ = 0; }
+
+    /// Return iterator to the beginning.
+    Iterator Begin() { return buffer_; }
+
+    /// Return const iterator to the beginning.
+    ConstIterator Begin() const { return buffer_; }
+
+    /// Return iterator to the end.
+    Iterator End() { return buffer_ + size_; }
+
+    /// Return const iterator to the end.
+    ConstIterator End() const { return buffer_ + size_; }
+
+    /// Return first element.
+    T& Front()
+    {
+        assert(size_);
+        return buffer_[0];
+    }
+
+    /// Return last element.
+    T& Back()
+    {
+        assert(size_);
+        return buffer_[size_ - 1];
+    }
+
+    /// Return number of elements.
+    unsigned Size() const { return size_; }
+
+    /// Return capacity.
+    unsigned Capacity() const { return capacity_; }
+
+    /// Return whether the vector is empty.
+    bool Empty() const { return size_ == 0; }
+
+    /// Return the buffer.
+    T* Buffer() const { return buffer_; }
+
+    /// Return whether the buffer came from the heap because no frame allocator existed.
+    bool IsHeap() const { return heap_; }
+
+private:
+    /// Grow capacity to hold at least the given number of elements.
+    void Grow(unsigned minCapacity)
+    {
+        unsigned newCapacity = capacity_ ? capacity_ : 8;
+        while (newCapacity < minCapacity)
+            newCapacity += (newCapacity + 1) >> 1u;
+        Reallocate(newCapacity);
+    }
+
+    /// Move to a buffer of the given capacity.
+    void Reallocate(unsigned newCapacity)
+    {
+        if (buffer_ && !heap_ && FrameAllocator::Extend(buffer_, capacity_ * sizeof(T), newCapacity * sizeof(T)))
+        {
+            capacity_ = newCapacity;
+            return;
+        }
+
+        T* newBuffer = nullptr;
+        bool newHeap = heap_;
+        if (!newHeap)
+        {
+            newBuffer = static_cast<T*>(FrameAllocator::Allocate(newCapacity * sizeof(T), alignof(T) > 16 ? alignof(T) : 16));
+            newHeap = !newBuffer;
+        }
+        if (newHeap)
+            newBuffer = reinterpret_cast<T*>(new unsigned char[newCapacity * sizeof(T)]);
+
+        if (size_)
+            memcpy(newBuffer, buffer_, size_ * sizeof(T));
+        FreeBuffer();
+        buffer_ = newBuffer;
+        capacity_ = newCapacity;
+        heap_ = newHeap;
+    }
+
+    /// Return the buffer to where it came from.
+    void FreeBuffer()
+    {
+        if (!buffer_)
+            return;
+        if (heap_)
+            delete[] reinterpret_cast<unsigned char*>(buffer_);
+        else
+            FrameAllocator::Release(buffer_);
+        buffer_ = nullptr;
+    }
+
+    /// Buffer.
+    T* buffer_{};
+    /// Number of elements.
+    unsigned size_{};
+    /// Capacity.
+    unsigned capacity_{};
+    /// Heap buffer flag.
+    bool heap_{};
+};
+
+template <class T> typename Urho3D::FramePODVector<T>::ConstIterator begin(const Urho3D::FramePODVector<T>& v) { return v.Begin(); }
+
+template <class T> typename Urho3D::FramePODVector<T>::ConstIterator end(const Urho3D::FramePODVector<T>& v) { return v.End(); }
+
+template <class T> typename Urho3D::FramePODVector<T>::Iterator begin(Urho3D::FramePODVector<T>& v) { return v.Begin(); }
+
+template <class T> typename Urho3D::FramePODVector<T>::Iterator end(Urho3D::FramePODVector<T>& v) { return v.End(); }
+
+}
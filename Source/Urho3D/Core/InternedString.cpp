@@ -0,0 +1,101 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Container/HashMap.h"
+#include "../Core/InternedString.h"
+#include "../Core/Mutex.h"
+
+#include <MemoryCache/MemoryMgr.h>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+/// Storage for all interned strings. Strings are never removed, so pointers to them stay valid.
+struct InternTable
+{
+    /// Destruct. Free the interned strings.
+    ~InternTable()
+    {
+        for (HashMap<StringHash, PODVector<String*> >::Iterator i = strings_.Begin(); i != strings_.End(); ++i)
+        {
+            for (PODVector<String*>::Iterator j = i->second_.Begin(); j != i->second_.End(); ++j)
+                delete *j;
+        }
+    }
+
+    /// Interned strings by hash. Strings with colliding hashes share a bucket.
+    HashMap<StringHash, PODVector<String*> > strings_;
+    /// Mutex for interning from several threads.
+    Mutex mutex_;
+};
+
+InternTable& GetInternTable()
+{
+    // Interned strings free their buffers through the memory manager, so make sure it is constructed first and destroyed last
+    EnginePlus::CMemoryMgr::Instance();
+    static InternTable table;
+    return table;
+}
+
+}
+
+InternedString::InternedString(const String& str) :
+    string_(&String::EMPTY),
+    hash_(str)
+{
+    if (!str.Empty())
+        string_ = Intern(str.CString(), hash_);
+}
+
+InternedString::InternedString(const char* str) :
+    string_(&String::EMPTY),
+    hash_(str)
+{
+    if (str && *str)
+        string_ = Intern(str, hash_);
+}
+
+const String* InternedString::Intern(const char* str, StringHash hash)
+{
+    InternTable& table = GetInternTable();
+    MutexLock lock(table.mutex_);
+
+    PODVector<String*>& bucket = table.strings_[hash];
+    for (PODVector<String*>::ConstIterator i = bucket.Begin(); i != bucket.End(); ++i)
+    {
+        if (**i == str)
+            return *i;
+    }
+
+    auto* interned = new String(str);
+    bucket.Push(interned);
+    return interned;
+}
+
+}
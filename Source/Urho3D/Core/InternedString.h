@@ -0,0 +1,88 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Math/StringHash.h"
+
+namespace Urho3D
+{
+
+/// Immutable string stored once per process in a table keyed by its hash. Copying, hashing and testing for equality do not touch the characters.
+class URHO3D_API InternedString
+{
+public:
+    /// Construct empty.
+    InternedString() noexcept :
+        string_(&String::EMPTY)
+    {
+    }
+
+    /// Construct by interning a string.
+    explicit InternedString(const String& str);
+    /// Construct by interning a C string.
+    explicit InternedString(const char* str);
+
+    /// Test for equality with another interned string.
+    bool operator ==(const InternedString& rhs) const { return string_ == rhs.string_; }
+
+    /// Test for inequality with another interned string.
+    bool operator !=(const InternedString& rhs) const { return string_ != rhs.string_; }
+
+    /// Test if less than another interned string. Orders by hash, not alphabetically.
+    bool operator <(const InternedString& rhs) const { return hash_ < rhs.hash_ || (hash_ == rhs.hash_ && *string_ < *rhs.string_); }
+
+    /// Test for equality with a string.
+    bool operator ==(const String& rhs) const { return *string_ == rhs; }
+
+    /// Test for inequality with a string.
+    bool operator !=(const String& rhs) const { return *string_ != rhs; }
+
+    /// Return the string.
+    const String& GetString() const { return *string_; }
+
+    /// Return the C string.
+    const char* CString() const { return string_->CString(); }
+
+    /// Return length.
+    unsigned Length() const { return string_->Length(); }
+
+    /// Return whether the string is empty.
+    bool Empty() const { return string_->Empty(); }
+
+    /// Return the string hash.
+    StringHash GetHash() const { return hash_; }
+
+    /// Return hash value for HashSet & HashMap.
+    unsigned ToHash() const { return hash_.Value(); }
+
+private:
+    /// Return the table copy of a string, adding it if not interned yet.
+    static const String* Intern(const char* str, StringHash hash);
+
+    /// Interned string, shared by all equal interned strings.
+    const String* string_;
+    /// String hash.
+    StringHash hash_;
+};
+
+}
@@ -22,11 +22,15 @@
 
 #include "../Precompiled.h"
 
+#include "../Container/Sort.h"
 #include "../Core/Context.h"
+#include "../Core/EventStatistics.h"
 #include "../Core/ProcessUtils.h"
 #include "../Core/Thread.h"
 #include "../IO/Log.h"
 
+#include <algorithm>
+
 #include "../DebugNew.h"
 
 
@@ -290,14 +294,41 @@ void Object::UnsubscribeFromAllEventsExcept(const PODVector<StringHash>& excepti
     }
 }
 
+/// Invoke an event receiver, recording its handler time and allocations if collecting event statistics.
+static void InvokeReceiver(Object* receiver, Object* sender, StringHash eventType, VariantMap& eventData, EventStatistics* statistics)
+{
+    if (!statistics)
+    {
+        receiver->OnEvent(sender, eventType, eventData);
+        return;
+    }
+
+    // Get the type first, as the receiver may be destroyed by its handler
+    const TypeInfo* receiverType = receiver->GetTypeInfo();
+    const EventStatisticsSample start = EventStatistics::Sample();
+    receiver->OnEvent(sender, eventType, eventData);
+    statistics->RecordHandler(eventType, receiverType, start);
+}
+
 void Object::SendEvent(StringHash eventType)
 {
-    VariantMap noEventData;
+    // Use one shared map instead of constructing one per send, which allocates. The preallocated map of the current nesting
+    // level can not be used, as the caller may still be using it. Events are only sent from the main thread
+    static VariantMap noEventData;
+
+    DispatchEvent(eventType, noEventData, nullptr, StringHash::ZERO);
 
-    SendEvent(eventType, noEventData);
+    // Handlers may have stored values into the map
+    if (!noEventData.Empty())
+        noEventData.Clear();
 }
 
 void Object::SendEvent(StringHash eventType, VariantMap& eventData)
+{
+    DispatchEvent(eventType, eventData, nullptr, StringHash::ZERO);
+}
+
+void Object::DispatchEvent(StringHash eventType, VariantMap& eventData, const void* payload, StringHash payloadType)
 {
     if (!Thread::IsMainThread())
     {
@@ -311,9 +342,15 @@ void Object::SendEvent(StringHash eventType, VariantMap& eventData)
     // Make a weak pointer to self to check for destruction during event handling
     WeakPtr<Object> self(this);
     Context* context = context_;
-    HashSet<Object*> processed;
+    // Specific receivers are recorded on a stack shared by nested sends, so that no set needs to be allocated per send
+    PODVector<Object*>& processed = context->processedEventReceivers_;
+    const unsigned processedStart = processed.Size();
+    // Hold the statistics subsystem alive during the send, in case a handler removes it
+    SharedPtr<EventStatistics> statistics(EventStatistics::IsActive() ? context->GetSubsystem<EventStatistics>() : nullptr);
+    const EventStatisticsSample statisticsStart = statistics ? EventStatistics::Sample() : EventStatisticsSample();
+    unsigned numInvoked = 0;
 
-    context->BeginSendEvent(this, eventType);
+    context->BeginSendEvent(this, eventType, payload, payloadType);
 
     // Check first the specific event receivers
     // Note: group is held alive with a shared ptr, as it may get destroyed along with the sender
@@ -330,17 +367,21 @@ void Object::SendEvent(StringHash eventType, VariantMap& eventData)
             if (!receiver)
                 continue;
 
-            receiver->OnEvent(this, eventType, eventData);
+            InvokeReceiver(receiver, this, eventType, eventData, statistics);
+            ++numInvoked;
 
             // If self has been destroyed as a result of event handling, exit
             if (self.Expired())
             {
+                processed.Resize(processedStart);
                 group->EndSendEvent();
                 context->EndSendEvent();
+                if (statistics)
+                    statistics->RecordSend(eventType, numInvoked, statisticsStart);
                 return;
             }
 
-            processed.Insert(receiver);
+            processed.Push(receiver);
         }
 
         group->EndSendEvent();
@@ -352,7 +393,8 @@ void Object::SendEvent(StringHash eventType, VariantMap& eventData)
     {
         group->BeginSendEvent();
 
-        if (processed.Empty())
+        const unsigned numProcessed = processed.Size() - processedStart;
+        if (!numProcessed)
         {
             const unsigned numReceivers = group->receivers_.Size();
             for (unsigned i = 0; i < numReceivers; ++i)
@@ -361,32 +403,45 @@ void Object::SendEvent(StringHash eventType, VariantMap& eventData)
                 if (!receiver)
                     continue;
 
-                receiver->OnEvent(this, eventType, eventData);
+                InvokeReceiver(receiver, this, eventType, eventData, statistics);
+                ++numInvoked;
 
                 if (self.Expired())
                 {
                     group->EndSendEvent();
                     context->EndSendEvent();
+                    if (statistics)
+                        statistics->RecordSend(eventType, numInvoked, statisticsStart);
                     return;
                 }
             }
         }
         else
         {
-            // If there were specific receivers, check that the event is not sent doubly to them
+            // If there were specific receivers, check that the event is not sent doubly to them. Sort them for binary search;
+            // nested sends only push past them, but may reallocate the stack, so look up its buffer each time
+            Sort(processed.Begin() + processedStart, processed.End());
+
             const unsigned numReceivers = group->receivers_.Size();
             for (unsigned i = 0; i < numReceivers; ++i)
             {
                 Object* receiver = group->receivers_[i];
-                if (!receiver || processed.Contains(receiver))
+                if (!receiver)
+                    continue;
+                Object** processedBegin = &processed[processedStart];
+                if (std::binary_search(processedBegin, processedBegin + numProcessed, receiver))
                     continue;
 
-                receiver->OnEvent(this, eventType, eventData);
+                InvokeReceiver(receiver, this, eventType, eventData, statistics);
+                ++numInvoked;
 
                 if (self.Expired())
                 {
+                    processed.Resize(processedStart);
                     group->EndSendEvent();
                     context->EndSendEvent();
+                    if (statistics)
+                        statistics->RecordSend(eventType, numInvoked, statisticsStart);
                     return;
                 }
             }
@@ -395,7 +450,10 @@ void Object::SendEvent(StringHash eventType, VariantMap& eventData)
         group->EndSendEvent();
     }
 
+    processed.Resize(processedStart);
     context->EndSendEvent();
+    if (statistics)
+        statistics->RecordSend(eventType, numInvoked, statisticsStart);
 }
 
 VariantMap& Object::GetEventDataMap() const
@@ -403,6 +461,11 @@ VariantMap& Object::GetEventDataMap() const
     return context_->GetEventDataMap();
 }
 
+const void* Object::GetEventPayload(StringHash payloadType) const
+{
+    return context_->GetEventPayload(payloadType);
+}
+
 const Variant& Object::GetGlobalVar(StringHash key) const
 {
     return context_->GetGlobalVar(key);
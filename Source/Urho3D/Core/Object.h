@@ -139,6 +139,16 @@ public:
     {
         SendEvent(eventType, GetEventDataMap().Populate(args...));
     }
+    /// Send event with a typed payload to all subscribers. Receivers read the payload with GetEventPayload() without Variant boxing. The event data map is passed along for receivers that only understand event data maps, such as script handlers.
+    template <class T> void SendTypedEvent(StringHash eventType, const T& payload, VariantMap& eventData)
+    {
+        DispatchEvent(eventType, eventData, &payload, T::GetPayloadTypeStatic());
+    }
+    /// Send event with a typed payload and an empty event data map to all subscribers.
+    template <class T> void SendTypedEvent(StringHash eventType, const T& payload)
+    {
+        DispatchEvent(eventType, GetEventDataMap(), &payload, T::GetPayloadTypeStatic());
+    }
 
     /// Return execution context.
     Context* GetContext() const { return context_; }
@@ -154,6 +164,10 @@ public:
     Object* GetEventSender() const;
     /// Return active event handler. Null outside event handling.
     EventHandler* GetEventHandler() const;
+    /// Return typed payload of the event being handled, or null if it was not sent with a payload of the specified type.
+    const void* GetEventPayload(StringHash payloadType) const;
+    /// Template version of returning the typed payload of the event being handled.
+    template <class T> const T* GetEventPayload() const { return static_cast<const T*>(GetEventPayload(T::GetPayloadTypeStatic())); }
     /// Return whether has subscribed to an event without specific sender.
     bool HasSubscribedToEvent(StringHash eventType) const;
     /// Return whether has subscribed to a specific sender's event.
@@ -177,6 +191,8 @@ protected:
     Context* context_;
 
 private:
+    /// Send event to all subscribers, optionally with a typed payload.
+    void DispatchEvent(StringHash eventType, VariantMap& eventData, const void* payload, StringHash payloadType);
     /// Find the first event handler with no specific sender.
     EventHandler* FindEventHandler(StringHash eventType, EventHandler** previous = nullptr) const;
     /// Find the first event handler with specific sender.
@@ -362,6 +378,9 @@ URHO3D_API StringHashRegister& GetEventNameRegister();
 #define URHO3D_EVENT(eventID, eventName) static const Urho3D::StringHash eventID(Urho3D::GetEventNameRegister().RegisterString(#eventName)); namespace eventName
 /// Describe an event's parameter hash ID. Should be used inside an event namespace.
 #define URHO3D_PARAM(paramID, paramName) static const Urho3D::StringHash paramID(#paramName)
+/// Declare a struct as a typed event payload, which can be sent with Object::SendTypedEvent() and read with Object::GetEventPayload().
+#define URHO3D_EVENT_PAYLOAD(typeName) \
+    static Urho3D::StringHash GetPayloadTypeStatic() { static const Urho3D::StringHash payloadType(#typeName); return payloadType; }
 /// Convenience macro to construct an EventHandler that points to a receiver object and its member function.
 #define URHO3D_HANDLER(className, function) (new Urho3D::EventHandlerImpl<className>(this, &className::function))
 /// Convenience macro to construct an EventHandler that points to a receiver object and its member function, and also defines a userdata pointer.
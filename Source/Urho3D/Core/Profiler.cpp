@@ -23,6 +23,7 @@
 #include "../Precompiled.h"
 
 #include "../Core/Profiler.h"
+#include "../IO/Serializer.h"
 
 #include <cstdio>
 
@@ -31,19 +32,149 @@
 namespace Urho3D
 {
 
+/// Profiling state of one thread.
+struct ProfilerThread
+{
+    /// Construct with name, thread ID and index.
+    ProfilerThread(const String& name, ThreadID threadID, unsigned index) :
+        name_(name),
+        threadID_(threadID),
+        index_(index),
+        root_(nullptr),
+        current_(nullptr),
+        depth_(0)
+    {
+    }
+
+    /// Destruct. Free the block tree.
+    ~ProfilerThread()
+    {
+        delete root_;
+    }
+
+    /// Acquire exclusive access to the block tree and events. Only contended while the main thread ends a frame or prints the data.
+    void Lock()
+    {
+        while (lock_.test_and_set(std::memory_order_acquire))
+            ;
+    }
+
+    /// Release exclusive access.
+    void Unlock()
+    {
+        lock_.clear(std::memory_order_release);
+    }
+
+    /// Record the start of a timeline event, or a placeholder if timestamp is negative.
+    void BeginEvent(const char* name, long long timestamp)
+    {
+        if (timestamp < 0)
+        {
+            openEvents_.Push(M_MAX_UNSIGNED);
+            return;
+        }
+
+        ProfilerEvent event;
+        event.name_ = name;
+        event.begin_ = timestamp;
+        event.end_ = -1;
+        event.threadIndex_ = index_;
+        openEvents_.Push(events_.Size());
+        events_.Push(event);
+    }
+
+    /// Record the end of the innermost timeline event.
+    void EndEvent(long long timestamp)
+    {
+        unsigned index = openEvents_.Back();
+        openEvents_.Pop();
+        if (index != M_MAX_UNSIGNED)
+            events_[index].end_ = timestamp;
+    }
+
+    /// Move the ended events to a frame timeline, keeping the events still running.
+    void CollectEvents(PODVector<ProfilerEvent>& dest)
+    {
+        unsigned kept = 0;
+        for (unsigned i = 0; i < events_.Size(); ++i)
+        {
+            if (events_[i].end_ >= 0)
+                dest.Push(events_[i]);
+            else
+                events_[kept++] = events_[i];
+        }
+        events_.Resize(kept);
+
+        // The running events keep their order, so renumber the open event stack
+        kept = 0;
+        for (unsigned i = 0; i < openEvents_.Size(); ++i)
+        {
+            if (openEvents_[i] != M_MAX_UNSIGNED)
+                openEvents_[i] = kept++;
+        }
+    }
+
+    /// Thread name.
+    String name_;
+    /// Thread ID.
+    ThreadID threadID_;
+    /// Index in the profiler's thread list. 0 = main thread.
+    unsigned index_;
+    /// Root block, timing the time spent in profiling blocks. Null for the main thread, which uses the profiler's block tree.
+    ProfilerBlock* root_;
+    /// Current profiling block.
+    ProfilerBlock* current_;
+    /// Profiling block nesting depth.
+    unsigned depth_;
+    /// Timeline events of the current frame.
+    PODVector<ProfilerEvent> events_;
+    /// Indices of the running timeline events, innermost last. M_MAX_UNSIGNED for blocks begun while timeline capture was disabled.
+    PODVector<unsigned> openEvents_;
+    /// Access flag.
+    std::atomic_flag lock_ = ATOMIC_FLAG_INIT;
+};
+
+/// Next unique profiler ID.
+static std::atomic<unsigned> nextProfilerID{1};
+/// Profiler the calling thread's state was last looked up for.
+static thread_local unsigned currentProfilerID = 0;
+/// Calling thread's state in that profiler.
+static thread_local ProfilerThread* currentThread = nullptr;
+
+/// Write a string to a JSON document as a quoted and escaped value.
+static void WriteJSONString(String& output, const char* value)
+{
+    output += '"';
+    for (const char* c = value; *c; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+            output += '\\';
+        output += *c;
+    }
+    output += '"';
+}
+
 Profiler::Profiler(Context* context) :
     Object(context),
     current_(nullptr),
     root_(nullptr),
-    intervalFrames_(0)
+    intervalFrames_(0),
+    timelineFrames_(0),
+    mainEventDepth_(0),
+    id_(nextProfilerID.fetch_add(1))
 {
     current_ = root_ = new ProfilerBlock(nullptr, "RunFrame");
+    threads_.Push(new ProfilerThread("Main", Thread::GetCurrentThreadID(), 0));
 }
 
 Profiler::~Profiler()
 {
     delete root_;
     root_ = nullptr;
+
+    for (PODVector<ProfilerThread*>::Iterator i = threads_.Begin(); i != threads_.End(); ++i)
+        delete *i;
+    threads_.Clear();
 }
 
 void Profiler::BeginFrame()
@@ -53,6 +184,8 @@ void Profiler::BeginFrame()
         EndFrame();
 
     root_->Begin();
+    if (timelineFrames_ || mainEventDepth_)
+        BeginEvent(root_->name_);
 }
 
 void Profiler::EndFrame()
@@ -61,12 +194,47 @@ void Profiler::EndFrame()
     ++intervalFrames_;
     root_->EndFrame();
     current_ = root_;
+    EndThreadFrames();
 }
 
 void Profiler::BeginInterval()
 {
     root_->BeginInterval();
     intervalFrames_ = 0;
+
+    MutexLock lock(threadsMutex_);
+    for (unsigned i = 1; i < threads_.Size(); ++i)
+    {
+        ProfilerThread* thread = threads_[i];
+        thread->Lock();
+        thread->root_->BeginInterval();
+        thread->Unlock();
+    }
+}
+
+void Profiler::SetThreadName(const String& name)
+{
+    if (Thread::IsMainThread())
+    {
+        threads_[0]->name_ = name;
+        return;
+    }
+
+    ProfilerThread* thread = GetThread();
+    thread->Lock();
+    thread->name_ = name;
+    // The root block never appears in the timeline, so its name may be replaced
+    delete [] thread->root_->name_;
+    thread->root_->name_ = new char[name.Length() + 1];
+    memcpy(thread->root_->name_, name.CString(), name.Length() + 1);
+    thread->Unlock();
+}
+
+void Profiler::SetTimelineFrames(unsigned frames)
+{
+    timelineFrames_ = frames;
+    if (timeline_.Size() > frames)
+        timeline_.Erase(0, timeline_.Size() - frames);
 }
 
 const String& Profiler::PrintData(bool showUnused, bool showTotal, unsigned maxDepth) const
@@ -86,9 +254,54 @@ const String& Profiler::PrintData(bool showUnused, bool showTotal, unsigned maxD
 
     PrintData(root_, output, 0, maxDepth, showUnused, showTotal);
 
+    MutexLock lock(threadsMutex_);
+    for (unsigned i = 1; i < threads_.Size(); ++i)
+    {
+        ProfilerThread* thread = threads_[i];
+        thread->Lock();
+        PrintData(thread->root_, output, 0, maxDepth, showUnused, showTotal);
+        thread->Unlock();
+    }
+
     return output;
 }
 
+bool Profiler::SaveTimeline(Serializer& dest) const
+{
+    String output = "{\"traceEvents\":[\n";
+    char line[256];
+
+    {
+        MutexLock lock(threadsMutex_);
+        for (unsigned i = 0; i < threads_.Size(); ++i)
+        {
+            sprintf(line, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":", i);
+            output.Append(line);
+            WriteJSONString(output, threads_[i]->name_.CString());
+            output += "}},\n";
+        }
+    }
+
+    for (unsigned i = 0; i < timeline_.Size(); ++i)
+    {
+        const PODVector<ProfilerEvent>& events = timeline_[i];
+        for (PODVector<ProfilerEvent>::ConstIterator j = events.Begin(); j != events.End(); ++j)
+        {
+            output += "{\"name\":";
+            WriteJSONString(output, j->name_);
+            sprintf(line, ",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%lld,\"dur\":%lld},\n", j->threadIndex_, j->begin_,
+                j->end_ - j->begin_);
+            output.Append(line);
+        }
+    }
+
+    // Replace the separator after the last event
+    output.Resize(output.Length() - 2);
+    output += "\n]}\n";
+
+    return dest.Write(output.CString(), output.Length()) == output.Length();
+}
+
 void Profiler::PrintData(ProfilerBlock* block, String& output, unsigned depth, unsigned maxDepth, bool showUnused,
     bool showTotal) const
 {
@@ -141,4 +354,113 @@ void Profiler::PrintData(ProfilerBlock* block, String& output, unsigned depth, u
         PrintData(*i, output, depth, maxDepth, showUnused, showTotal);
 }
 
+void Profiler::BeginEvent(const char* name)
+{
+    ProfilerThread* thread = threads_[0];
+    thread->BeginEvent(name, timelineFrames_ ? GetTimestamp() : -1);
+    mainEventDepth_ = thread->openEvents_.Size();
+}
+
+void Profiler::EndEvent()
+{
+    ProfilerThread* thread = threads_[0];
+    thread->EndEvent(GetTimestamp());
+    mainEventDepth_ = thread->openEvents_.Size();
+}
+
+void Profiler::BeginThreadBlock(const char* name)
+{
+    ProfilerThread* thread = GetThread();
+    thread->Lock();
+
+    // The root block times how long the thread spends in profiling blocks in total
+    if (!thread->depth_++)
+        thread->root_->Begin();
+    thread->current_ = thread->current_->GetChild(name);
+    thread->current_->Begin();
+    if (timelineFrames_ || !thread->openEvents_.Empty())
+        thread->BeginEvent(thread->current_->name_, timelineFrames_ ? GetTimestamp() : -1);
+
+    thread->Unlock();
+}
+
+void Profiler::EndThreadBlock()
+{
+    ProfilerThread* thread = GetThread();
+    thread->Lock();
+
+    if (thread->depth_)
+    {
+        thread->current_->End();
+        thread->current_ = thread->current_->parent_;
+        if (!--thread->depth_)
+            thread->root_->End();
+        if (!thread->openEvents_.Empty())
+            thread->EndEvent(GetTimestamp());
+    }
+
+    thread->Unlock();
+}
+
+ProfilerThread* Profiler::GetThread()
+{
+    if (currentProfilerID == id_)
+        return currentThread;
+
+    ThreadID threadID = Thread::GetCurrentThreadID();
+    ProfilerThread* thread = nullptr;
+
+    {
+        MutexLock lock(threadsMutex_);
+        for (unsigned i = 1; i < threads_.Size(); ++i)
+        {
+            if (threads_[i]->threadID_ == threadID)
+            {
+                thread = threads_[i];
+                break;
+            }
+        }
+
+        if (!thread)
+        {
+            unsigned index = threads_.Size();
+            thread = new ProfilerThread("Thread " + String(index), threadID, index);
+            thread->current_ = thread->root_ = new ProfilerBlock(nullptr, thread->name_.CString());
+            threads_.Push(thread);
+        }
+    }
+
+    currentProfilerID = id_;
+    currentThread = thread;
+    return thread;
+}
+
+void Profiler::EndThreadFrames()
+{
+    unsigned frames = timelineFrames_;
+    if (frames)
+    {
+        if (timeline_.Size() >= frames)
+            timeline_.Erase(0, timeline_.Size() - frames + 1);
+        timeline_.Resize(timeline_.Size() + 1);
+    }
+
+    MutexLock lock(threadsMutex_);
+    for (unsigned i = 0; i < threads_.Size(); ++i)
+    {
+        ProfilerThread* thread = threads_[i];
+        thread->Lock();
+
+        // Blocks still running in other threads are accounted to the frame in which they end
+        if (thread->root_)
+            thread->root_->EndFrame();
+        if (frames)
+            thread->CollectEvents(timeline_.Back());
+        else
+            thread->events_.Clear();
+
+        thread->Unlock();
+    }
+}
+
 }
@@ -23,12 +23,31 @@
 #pragma once
 
 #include "../Container/Str.h"
+#include "../Core/Mutex.h"
 #include "../Core/Thread.h"
 #include "../Core/Timer.h"
 
+#include <atomic>
+
 namespace Urho3D
 {
 
+class Serializer;
+struct ProfilerThread;
+
+/// Timeline record of one profiling block execution.
+struct ProfilerEvent
+{
+    /// Block name.
+    const char* name_;
+    /// Start time in microseconds since the profiler was created.
+    long long begin_;
+    /// End time in microseconds since the profiler was created, or negative while the block is running.
+    long long end_;
+    /// Index of the recording thread. 0 = main thread.
+    unsigned threadIndex_;
+};
+
 /// Profiling data for one block in the profiling tree.
 class URHO3D_API ProfilerBlock
 {
@@ -179,26 +198,35 @@ public:
     /// Destruct.
     ~Profiler() override;
 
-    /// Begin timing a profiling block.
+    /// Begin timing a profiling block. Other threads than the main thread record into their own block trees.
     void BeginBlock(const char* name)
     {
-        // Profiler supports only the main thread currently
         if (!Thread::IsMainThread())
+        {
+            BeginThreadBlock(name);
             return;
+        }
 
         current_ = current_->GetChild(name);
         current_->Begin();
+        if (timelineFrames_ || mainEventDepth_)
+            BeginEvent(current_->name_);
     }
 
     /// End timing the current profiling block.
     void EndBlock()
     {
         if (!Thread::IsMainThread())
+        {
+            EndThreadBlock();
             return;
+        }
 
         current_->End();
         if (current_->parent_)
             current_ = current_->parent_;
+        if (mainEventDepth_)
+            EndEvent();
     }
 
     /// Begin the profiling frame. Called by HandleBeginFrame().
@@ -207,17 +235,31 @@ public:
     void EndFrame();
     /// Begin a new interval.
     void BeginInterval();
+    /// Set the name of the calling thread, shown in the profiling data and timeline. Other threads than the main thread are named by registration order by default.
+    void SetThreadName(const String& name);
+    /// Set number of most recent frames to keep the timelines of. 0 (default) disables timeline capture.
+    void SetTimelineFrames(unsigned frames);
 
     /// Return profiling data as text output. This method is not thread-safe.
     const String& PrintData(bool showUnused = false, bool showTotal = false, unsigned maxDepth = M_MAX_UNSIGNED) const;
+    /// Save the captured frame timelines in the Chrome trace event JSON format. Return true if successful.
+    bool SaveTimeline(Serializer& dest) const;
     /// Return the current profiling block.
     const ProfilerBlock* GetCurrentBlock() { return current_; }
     /// Return the root profiling block.
     const ProfilerBlock* GetRootBlock() { return root_; }
+    /// Return number of most recent frames to keep the timelines of.
+    unsigned GetTimelineFrames() const { return timelineFrames_; }
+    /// Return the captured frame timelines, oldest first. Each holds the events of all threads, ordered by thread.
+    const Vector<PODVector<ProfilerEvent> >& GetTimeline() const { return timeline_; }
 
 protected:
     /// Return profiling data as text output for a specified profiling block.
     void PrintData(ProfilerBlock* block, String& output, unsigned depth, unsigned maxDepth, bool showUnused, bool showTotal) const;
+    /// Record the start of a timeline event in the main thread, or a placeholder if timeline capture is disabled.
+    void BeginEvent(const char* name);
+    /// Record the end of the innermost timeline event in the main thread.
+    void EndEvent();
 
     /// Current profiling block.
     ProfilerBlock* current_;
@@ -225,6 +267,33 @@ protected:
     ProfilerBlock* root_;
     /// Frames in the current interval.
     unsigned intervalFrames_;
+    /// Number of most recent frames to keep the timelines of.
+    std::atomic<unsigned> timelineFrames_;
+    /// Number of main thread blocks which recorded a timeline event or placeholder and have not ended yet.
+    unsigned mainEventDepth_;
+
+private:
+    /// Begin timing a profiling block in another thread than the main thread.
+    void BeginThreadBlock(const char* name);
+    /// End timing the current profiling block in another thread than the main thread.
+    void EndThreadBlock();
+    /// Return the calling thread's profiling state, registering it on first use.
+    ProfilerThread* GetThread();
+    /// End the profiling frame of the other threads and collect the frame's timeline events.
+    void EndThreadFrames();
+    /// Return microseconds since the profiler was created.
+    long long GetTimestamp() const { return epoch_.GetUSec(false); }
+
+    /// Per-thread profiling states. The main thread's state is first and holds only its timeline events.
+    PODVector<ProfilerThread*> threads_;
+    /// Mutex for registering threads.
+    mutable Mutex threadsMutex_;
+    /// Timer for event timestamps.
+    mutable HiresTimer epoch_;
+    /// Unique ID to tell the thread-local state of different profiler instances apart.
+    unsigned id_;
+    /// Captured frame timelines, oldest first.
+    Vector<PODVector<ProfilerEvent> > timeline_;
 };
 
 /// Helper class for automatically beginning and ending a profiling block
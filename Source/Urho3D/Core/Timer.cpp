@@ -237,4 +237,9 @@ void HiresTimer::Reset()
     startTime_ = HiresTick();
 }
 
+long long HiresTimer::GetTicks()
+{
+    return HiresTick();
+}
+
 }
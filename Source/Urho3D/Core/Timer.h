@@ -64,6 +64,9 @@ public:
     /// Return high-resolution timer frequency if supported.
     static long long GetFrequency() { return frequency; }
 
+    /// Return current high-resolution clock value in ticks of the timer frequency.
+    static long long GetTicks();
+
 private:
     /// Starting clock value in CPU ticks.
     long long startTime_{};
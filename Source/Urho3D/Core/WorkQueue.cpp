@@ -26,11 +26,98 @@
 #include "../Core/ProcessUtils.h"
 #include "../Core/Profiler.h"
 #include "../Core/WorkQueue.h"
+#include "../Core/WorkStealingDeque.h"
 #include "../IO/Log.h"
 
 namespace Urho3D
 {
 
+/// Work item scheduling states.
+enum WorkItemState
+{
+    /// Not queued.
+    WIS_IDLE = 0,
+    /// Queued and waiting for a thread to claim it.
+    WIS_QUEUED,
+    /// Claimed by a thread for execution.
+    WIS_RUNNING,
+    /// Removed from the queue before execution, with a stale entry still in a deque.
+    WIS_REMOVED,
+    /// Removed, and the stale deque entry has been consumed.
+    WIS_DRAINED
+};
+
+/// Lowest priority contained in each priority bucket.
+static const unsigned bucketMinPriorities[NUM_WORK_PRIORITY_BUCKETS] = { 0, 1, 0x10000, M_MAX_UNSIGNED };
+
+/// Return the priority bucket for a work item priority.
+static unsigned GetPriorityBucket(unsigned priority)
+{
+    unsigned bucket = NUM_WORK_PRIORITY_BUCKETS - 1;
+    while (priority < bucketMinPriorities[bucket])
+        --bucket;
+    return bucket;
+}
+
+/// Return the lowest priority bucket whose items all have at least the specified priority.
+static unsigned GetFirstFullBucket(unsigned priority)
+{
+    unsigned bucket = GetPriorityBucket(priority);
+    return priority > bucketMinPriorities[bucket] ? bucket + 1 : bucket;
+}
+
+/// Shared state of a parallel for operation.
+struct ParallelForData
+{
+    /// Take the next chunk of the range. Return false if the range has been exhausted.
+    bool TakeChunk(unsigned& start, unsigned& end)
+    {
+        unsigned next = next_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            if (next >= end_)
+                return false;
+
+            // Take large chunks while much work remains, then smaller ones so that threads finish at about the same time
+            unsigned remaining = end_ - next;
+            unsigned size = Min(Max(remaining / (numItems_ * 2), grainSize_), remaining);
+            if (next_.compare_exchange_weak(next, next + size, std::memory_order_relaxed))
+            {
+                start = next;
+                end = next + size;
+                return true;
+            }
+        }
+    }
+
+    /// Next unprocessed index.
+    std::atomic<unsigned> next_;
+    /// End of range.
+    unsigned end_;
+    /// Minimum chunk size.
+    unsigned grainSize_;
+    /// Number of work items processing the range.
+    unsigned numItems_;
+    /// Range function.
+    ParallelForFunction function_;
+};
+
+/// Process chunks of a parallel for range until exhausted.
+static void ParallelForWork(const WorkItem* item, unsigned threadIndex)
+{
+    auto* data = reinterpret_cast<ParallelForData*>(item->aux_);
+    unsigned start, end;
+
+    while (data->TakeChunk(start, end))
+        data->function_(start, end, threadIndex);
+}
+
+/// Release the shared state of a parallel for once all its work items have completed.
+static void ParallelForFinishWork(const WorkItem* item, unsigned threadIndex)
+{
+    delete reinterpret_cast<ParallelForData*>(item->aux_);
+}
+
 /// Worker thread managed by the work queue.
 class WorkerThread : public Thread, public RefCounted
 {
@@ -62,14 +149,20 @@ private:
 
 WorkQueue::WorkQueue(Context* context) :
     Object(context),
+    numDequeThreads_(1),
     shutDown_(false),
-    pausing_(false),
     paused_(false),
     completing_(false),
     tolerance_(10),
     lastSize_(0),
     maxNonThreadedWorkMs_(5)
 {
+    for (unsigned i = 0; i < NUM_WORK_PRIORITY_BUCKETS; ++i)
+    {
+        pendingItems_[i] = 0;
+        deques_.Push(new WorkStealingDeque());
+    }
+
     SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(WorkQueue, HandleBeginFrame));
 }
 
@@ -81,6 +174,9 @@ WorkQueue::~WorkQueue()
 
     for (unsigned i = 0; i < threads_.Size(); ++i)
         threads_[i]->Stop();
+
+    for (unsigned i = 0; i < deques_.Size(); ++i)
+        delete deques_[i];
 }
 
 void WorkQueue::CreateThreads(unsigned numThreads)
@@ -94,6 +190,11 @@ void WorkQueue::CreateThreads(unsigned numThreads)
     // Start threads in paused mode
     Pause();
 
+    // Create the deques of all threads before any thread starts stealing
+    for (unsigned i = 0; i < numThreads * NUM_WORK_PRIORITY_BUCKETS; ++i)
+        deques_.Push(new WorkStealingDeque());
+    numDequeThreads_ = numThreads + 1;
+
     for (unsigned i = 0; i < numThreads; ++i)
     {
         SharedPtr<WorkerThread> thread(new WorkerThread(this, i + 1));
@@ -138,81 +239,91 @@ void WorkQueue::AddWorkItem(const SharedPtr<WorkItem>& item)
     workItems_.Push(item);
     item->completed_ = false;
 
-    // Make sure worker threads' list is safe to modify
-    if (threads_.Size() && !paused_)
-        queueMutex_.Acquire();
+    bool requeued = false;
+    List<SharedPtr<WorkItem> >::Iterator i = removedItems_.Find(item);
+    if (i != removedItems_.End())
+    {
+        // The item was removed but its stale deque entry has not been consumed yet: reactivate that entry instead of pushing
+        // again. An item must have only one deque entry, so a changed priority does not move it to another bucket. Count it
+        // as pending first, as a worker thread may claim it right away
+        ++pendingItems_[item->bucket_];
+        unsigned state = WIS_REMOVED;
+        requeued = item->state_.compare_exchange_strong(state, WIS_QUEUED);
+        if (!requeued)
+            --pendingItems_[item->bucket_];
+        removedItems_.Erase(i);
+    }
 
-    // Find position for new item
-    if (queue_.Empty())
-        queue_.Push(item);
-    else
+    if (!requeued)
     {
-        bool inserted = false;
+        // Priority buckets replace sorted insertion; within a bucket items are taken in submission order by other threads
+        item->bucket_ = GetPriorityBucket(item->priority_);
+        item->state_.store(WIS_QUEUED, std::memory_order_relaxed);
+        ++pendingItems_[item->bucket_];
+
+        // Release the reference held until adding. If predecessors are still unfinished, the last one to complete schedules the item
+        if (item->dependencies_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            ScheduleItem(item.Get(), 0);
+    }
 
-        for (List<WorkItem*>::Iterator i = queue_.Begin(); i != queue_.End(); ++i)
-        {
-            if ((*i)->priority_ <= item->priority_)
-            {
-                queue_.Insert(i, item);
-                inserted = true;
-                break;
-            }
-        }
+    if (threads_.Size())
+        Resume();
+}
 
-        if (!inserted)
-            queue_.Push(item);
+bool WorkQueue::AddDependency(const SharedPtr<WorkItem>& item, const SharedPtr<WorkItem>& predecessor)
+{
+    if (!item || !predecessor || item == predecessor)
+    {
+        URHO3D_LOGERROR("Null or self work item dependency");
+        return false;
     }
 
-    if (threads_.Size())
+    if (item->state_.load(std::memory_order_relaxed) != WIS_IDLE || predecessor->state_.load(std::memory_order_relaxed) != WIS_IDLE ||
+        workItems_.Contains(item))
     {
-        queueMutex_.Release();
-        paused_ = false;
+        URHO3D_LOGERROR("Work item dependencies must be added before the items are added to the work queue");
+        return false;
     }
+
+    // A predecessor which has already run and not been requeued does not need to be waited for
+    if (predecessor->completed_)
+        return true;
+
+    item->dependencies_.fetch_add(1, std::memory_order_relaxed);
+    predecessor->successors_.Push(item.Get());
+    predecessor->hasSuccessors_ = true;
+    return true;
 }
 
 bool WorkQueue::RemoveWorkItem(SharedPtr<WorkItem> item)
 {
-    if (!item)
+    if (!item || item->hasSuccessors_)
         return false;
 
-    MutexLock lock(queueMutex_);
-
     // Can only remove successfully if the item was not yet taken by threads for execution
-    List<WorkItem*>::Iterator i = queue_.Find(item.Get());
-    if (i != queue_.End())
-    {
-        List<SharedPtr<WorkItem> >::Iterator j = workItems_.Find(item);
-        if (j != workItems_.End())
-        {
-            queue_.Erase(i);
-            ReturnToPool(item);
-            workItems_.Erase(j);
-            return true;
-        }
-    }
+    List<SharedPtr<WorkItem> >::Iterator i = workItems_.Find(item);
+    if (i == workItems_.End())
+        return false;
 
-    return false;
+    unsigned state = WIS_QUEUED;
+    if (!item->state_.compare_exchange_strong(state, WIS_REMOVED))
+        return false;
+
+    // The item stays referenced until a thread consumes its deque entry, after which it can be returned to the pool
+    --pendingItems_[item->bucket_];
+    removedItems_.Push(item);
+    workItems_.Erase(i);
+    return true;
 }
 
 unsigned WorkQueue::RemoveWorkItems(const Vector<SharedPtr<WorkItem> >& items)
 {
-    MutexLock lock(queueMutex_);
     unsigned removed = 0;
 
     for (Vector<SharedPtr<WorkItem> >::ConstIterator i = items.Begin(); i != items.End(); ++i)
     {
-        List<WorkItem*>::Iterator j = queue_.Find(i->Get());
-        if (j != queue_.End())
-        {
-            List<SharedPtr<WorkItem> >::Iterator k = workItems_.Find(*i);
-            if (k != workItems_.End())
-            {
-                queue_.Erase(j);
-                ReturnToPool(*k);
-                workItems_.Erase(k);
-                ++removed;
-            }
-        }
+        if (RemoveWorkItem(*i))
+            ++removed;
     }
 
     return removed;
@@ -222,12 +333,8 @@ void WorkQueue::Pause()
 {
     if (!paused_)
     {
-        pausing_ = true;
-
-        queueMutex_.Acquire();
+        pauseMutex_.Acquire();
         paused_ = true;
-
-        pausing_ = false;
     }
 }
 
@@ -235,8 +342,8 @@ void WorkQueue::Resume()
 {
     if (paused_)
     {
-        queueMutex_.Release();
         paused_ = false;
+        pauseMutex_.Release();
     }
 }
 
@@ -249,23 +356,13 @@ void WorkQueue::Complete(unsigned priority)
     {
         Resume();
 
-        // Take work items also in the main thread until queue empty or no high-priority items anymore
-        while (!queue_.Empty())
+        // Take work items also in the main thread until no high-priority items anymore. Only buckets that can not contain
+        // lower priority items are processed here, the rest are left to the worker threads
+        unsigned minBucket = GetFirstFullBucket(priority);
+        if (minBucket < NUM_WORK_PRIORITY_BUCKETS)
         {
-            queueMutex_.Acquire();
-            if (!queue_.Empty() && queue_.Front()->priority_ >= priority)
-            {
-                WorkItem* item = queue_.Front();
-                queue_.PopFront();
-                queueMutex_.Release();
-                item->workFunction_(item, 0);
-                item->completed_ = true;
-            }
-            else
-            {
-                queueMutex_.Release();
-                break;
-            }
+            while (WorkItem* item = TakeItem(0, minBucket))
+                ExecuteItem(item, 0);
         }
 
         // Wait for threaded work to complete
@@ -274,27 +371,123 @@ void WorkQueue::Complete(unsigned priority)
         }
 
         // If no work at all remaining, pause worker threads by leaving the mutex locked
-        if (queue_.Empty())
+        if (!GetNumPendingItems())
             Pause();
     }
     else
+        CompleteNonThreaded(priority);
+
+    PurgeCompleted(priority);
+    completing_ = false;
+}
+
+void WorkQueue::WaitFor(const SharedPtr<WorkItem>& item)
+{
+    if (!item)
+        return;
+
+    if (!item->completed_ && !workItems_.Contains(item))
     {
-        // No worker threads: ensure all high-priority items are completed in the main thread
-        while (!queue_.Empty() && queue_.Front()->priority_ >= priority)
+        URHO3D_LOGERROR("Can not wait for a work item which has not been added to the work queue");
+        return;
+    }
+
+    completing_ = true;
+
+    if (threads_.Size())
+    {
+        Resume();
+
+        // Help with work that can not have lower priority than the waited item, otherwise just wait for the worker threads
+        unsigned minBucket = GetFirstFullBucket(item->priority_);
+        while (!item->completed_)
         {
-            WorkItem* item = queue_.Front();
-            queue_.PopFront();
-            item->workFunction_(item, 0);
-            item->completed_ = true;
+            WorkItem* other = minBucket < NUM_WORK_PRIORITY_BUCKETS ? TakeItem(0, minBucket) : nullptr;
+            if (other)
+                ExecuteItem(other, 0);
         }
+
+        if (!GetNumPendingItems())
+            Pause();
     }
+    else
+        CompleteNonThreaded(item->priority_);
 
-    PurgeCompleted(priority);
+    PurgeCompleted(item->priority_);
     completing_ = false;
 }
 
+SharedPtr<WorkItem> WorkQueue::AddParallelFor(unsigned begin, unsigned end, unsigned grainSize, const ParallelForFunction& function,
+    unsigned priority)
+{
+    grainSize = Max(grainSize, 1U);
+    unsigned range = end > begin ? end - begin : 0;
+    unsigned numItems = Clamp((range + grainSize - 1) / grainSize, 1U, GetNumThreads() + 1);
+
+    auto* data = new ParallelForData();
+    data->next_ = begin;
+    data->end_ = end;
+    data->grainSize_ = grainSize;
+    data->numItems_ = numItems;
+    data->function_ = function;
+
+    SharedPtr<WorkItem> finishItem = GetFreeItem();
+    finishItem->priority_ = priority;
+    finishItem->workFunction_ = ParallelForFinishWork;
+    finishItem->aux_ = data;
+
+    for (unsigned i = 0; i < numItems; ++i)
+    {
+        SharedPtr<WorkItem> item = GetFreeItem();
+        item->priority_ = priority;
+        item->workFunction_ = ParallelForWork;
+        item->aux_ = data;
+        AddDependency(finishItem, item);
+        AddWorkItem(item);
+    }
+
+    AddWorkItem(finishItem);
+    return finishItem;
+}
+
+void WorkQueue::ParallelFor(unsigned begin, unsigned end, unsigned grainSize, const ParallelForFunction& function, unsigned priority)
+{
+    if (begin >= end)
+        return;
+
+    // Process small ranges, or all ranges without worker threads, directly
+    if (threads_.Empty() || end - begin <= grainSize)
+    {
+        function(begin, end, 0);
+        return;
+    }
+
+    WaitFor(AddParallelFor(begin, end, grainSize, function, priority));
+}
+
+unsigned WorkQueue::GetNumPendingItems() const
+{
+    unsigned numPending = 0;
+    for (unsigned i = 0; i < NUM_WORK_PRIORITY_BUCKETS; ++i)
+        numPending += pendingItems_[i].load(std::memory_order_acquire);
+    return numPending;
+}
+
 bool WorkQueue::IsCompleted(unsigned priority) const
 {
+    unsigned bucket = GetPriorityBucket(priority);
+    for (unsigned i = bucket + 1; i < NUM_WORK_PRIORITY_BUCKETS; ++i)
+    {
+        if (pendingItems_[i].load(std::memory_order_acquire))
+            return false;
+    }
+
+    if (!pendingItems_[bucket].load(std::memory_order_acquire))
+        return true;
+    if (priority == bucketMinPriorities[bucket])
+        return false;
+
+    // The bucket also holds lower priority items, so check the items individually
     for (List<SharedPtr<WorkItem> >::ConstIterator i = workItems_.Begin(); i != workItems_.End(); ++i)
     {
         if ((*i)->priority_ >= priority && !(*i)->completed_)
@@ -306,35 +499,149 @@ bool WorkQueue::IsCompleted(unsigned priority) const
 
 void WorkQueue::ProcessItems(unsigned threadIndex)
 {
-    bool wasActive = false;
+#ifdef URHO3D_PROFILING
+    auto* profiler = GetSubsystem<Profiler>();
+    if (profiler)
+        profiler->SetThreadName("Worker " + String(threadIndex));
+#endif
 
     for (;;)
     {
         if (shutDown_)
             return;
 
-        if (pausing_ && !wasActive)
-            Time::Sleep(0);
+        if (paused_)
+        {
+            // Block until the main thread releases the pause mutex
+            pauseMutex_.Acquire();
+            pauseMutex_.Release();
+            continue;
+        }
+
+        WorkItem* item = TakeItem(threadIndex, 0);
+        if (item)
+        {
+            URHO3D_PROFILE(ExecuteWorkItem);
+            ExecuteItem(item, threadIndex);
+        }
         else
+            Time::Sleep(0);
+    }
+}
+
+WorkItem* WorkQueue::TakeItem(unsigned threadIndex, unsigned minBucket)
+{
+    for (unsigned bucket = NUM_WORK_PRIORITY_BUCKETS; bucket-- > minBucket;)
+    {
+        // Prefer own work, popped in LIFO order for cache locality
+        while (WorkItem* item = GetDeque(threadIndex, bucket)->Pop())
         {
-            queueMutex_.Acquire();
-            if (!queue_.Empty())
-            {
-                wasActive = true;
+            if (ClaimItem(item))
+                return item;
+        }
 
-                WorkItem* item = queue_.Front();
-                queue_.PopFront();
-                queueMutex_.Release();
-                item->workFunction_(item, threadIndex);
-                item->completed_ = true;
-            }
-            else
+        // Then steal the oldest work from the other threads, starting from the next thread to spread the contention
+        for (unsigned i = 1; i < numDequeThreads_; ++i)
+        {
+            WorkStealingDeque* victim = GetDeque((threadIndex + i) % numDequeThreads_, bucket);
+            while (WorkItem* item = victim->Steal())
             {
-                wasActive = false;
+                if (ClaimItem(item))
+                    return item;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+bool WorkQueue::ClaimItem(WorkItem* item)
+{
+    for (;;)
+    {
+        unsigned state = WIS_QUEUED;
+        if (item->state_.compare_exchange_strong(state, WIS_RUNNING))
+            return true;
+
+        // The item was removed before execution. Mark its stale entry consumed so that the main thread may recycle it.
+        // If the main thread requeued it concurrently, retry the claim
+        if (state == WIS_REMOVED && item->state_.compare_exchange_strong(state, WIS_DRAINED))
+            return false;
+    }
+}
+
+void WorkQueue::ScheduleItem(WorkItem* item, unsigned threadIndex)
+{
+    // Worker threads schedule continuations to their own deque, where they are likely to be executed next while the
+    // predecessor's data is still in cache
+    GetDeque(threadIndex, item->bucket_)->Push(item);
+}
+
+void WorkQueue::ExecuteItem(WorkItem* item, unsigned threadIndex)
+{
+    // The main thread may recycle the item as soon as it is flagged completed, so do not touch it afterward
+    unsigned bucket = item->bucket_;
+    if (item->workFunction_)
+        item->workFunction_(item, threadIndex);
+
+    for (unsigned i = 0; i < item->successors_.Size(); ++i)
+    {
+        WorkItem* successor = item->successors_[i];
+        if (successor->dependencies_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            ScheduleItem(successor, threadIndex);
+    }
+    item->successors_.Clear();
+    item->dependencies_.store(1, std::memory_order_relaxed);
+
+    item->state_.store(WIS_IDLE);
+    item->completed_ = true;
+    pendingItems_[bucket].fetch_sub(1, std::memory_order_release);
+}
+
+void WorkQueue::CompleteNonThreaded(unsigned priority)
+{
+    // No worker threads: ensure all high-priority items are completed in the main thread, in bucket order
+    PODVector<WorkItem*> deferred;
+    unsigned minBucket = GetPriorityBucket(priority);
+
+    for (;;)
+    {
+        bool executed = false;
+
+        for (unsigned bucket = NUM_WORK_PRIORITY_BUCKETS; bucket-- > minBucket;)
+        {
+            WorkStealingDeque* deque = GetDeque(0, bucket);
 
-                queueMutex_.Release();
-                Time::Sleep(0);
+            // The main thread is the only user of the deque, so it can be drained and lower priority items put back in order
+            while (WorkItem* item = deque->Steal())
+            {
+                if (item->priority_ < priority && item->state_.load(std::memory_order_relaxed) == WIS_QUEUED)
+                    deferred.Push(item);
+                else if (ClaimItem(item))
+                {
+                    ExecuteItem(item, 0);
+                    executed = true;
+                }
             }
+
+            for (unsigned i = 0; i < deferred.Size(); ++i)
+                deque->Push(deferred[i]);
+            deferred.Clear();
+        }
+
+        if (IsCompleted(priority))
+            break;
+
+        // Remaining items wait for lower priority predecessors. Execute lower priority work to make progress
+        if (!executed)
+        {
+            WorkItem* item = nullptr;
+            for (unsigned bucket = NUM_WORK_PRIORITY_BUCKETS; bucket-- > 0 && !item;)
+                item = GetDeque(0, bucket)->Steal();
+            if (!item)
+                break;
+            if (ClaimItem(item))
+                ExecuteItem(item, 0);
         }
     }
 }
@@ -357,12 +664,25 @@ void WorkQueue::PurgeCompleted(unsigned priority)
                 SendEvent(E_WORKITEMCOMPLETED, eventData);
             }
 
+            (*i)->hasSuccessors_ = false;
             ReturnToPool(*i);
             i = workItems_.Erase(i);
         }
         else
             ++i;
     }
+
+    // Recycle removed items once no thread can reach them anymore
+    for (List<SharedPtr<WorkItem> >::Iterator i = removedItems_.Begin(); i != removedItems_.End();)
+    {
+        if ((*i)->state_.load(std::memory_order_acquire) == WIS_DRAINED)
+        {
+            ReturnToPool(*i);
+            i = removedItems_.Erase(i);
+        }
+        else
+            ++i;
+    }
 }
 
 void WorkQueue::PurgePool()
@@ -393,6 +713,10 @@ void WorkQueue::ReturnToPool(SharedPtr<WorkItem>& item)
         item->priority_ = M_MAX_UNSIGNED;
         item->sendEvent_ = false;
         item->completed_ = false;
+        item->hasSuccessors_ = false;
+        item->state_.store(WIS_IDLE, std::memory_order_relaxed);
+        item->dependencies_.store(1, std::memory_order_relaxed);
+        item->successors_.Clear();
 
         poolItems_.Push(item);
     }
@@ -401,18 +725,24 @@ void WorkQueue::ReturnToPool(SharedPtr<WorkItem>& item)
 void WorkQueue::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
 {
     // If no worker threads, complete low-priority work here
-    if (threads_.Empty() && !queue_.Empty())
+    if (threads_.Empty() && GetNumPendingItems())
     {
         URHO3D_PROFILE(CompleteWorkNonthreaded);
 
         HiresTimer timer;
 
-        while (!queue_.Empty() && timer.GetUSec(false) < maxNonThreadedWorkMs_ * 1000LL)
+        // Take the highest priority items first, in submission order within a bucket
+        for (unsigned bucket = NUM_WORK_PRIORITY_BUCKETS; bucket-- > 0;)
         {
-            WorkItem* item = queue_.Front();
-            queue_.PopFront();
-            item->workFunction_(item, 0);
-            item->completed_ = true;
+            WorkStealingDeque* deque = GetDeque(0, bucket);
+            while (timer.GetUSec(false) < maxNonThreadedWorkMs_ * 1000LL)
+            {
+                WorkItem* item = deque->Steal();
+                if (!item)
+                    break;
+                if (ClaimItem(item))
+                    ExecuteItem(item, 0);
+            }
         }
     }
 
@@ -26,9 +26,14 @@
 #include "../Core/Mutex.h"
 #include "../Core/Object.h"
 
+#include <atomic>
+
 namespace Urho3D
 {
 
+/// Number of priority buckets used by the work queue scheduler.
+static const unsigned NUM_WORK_PRIORITY_BUCKETS = 4;
+
 /// Work item completed event.
 URHO3D_EVENT(E_WORKITEMCOMPLETED, WorkItemCompleted)
 {
@@ -36,6 +41,10 @@ URHO3D_EVENT(E_WORKITEMCOMPLETED, WorkItemCompleted)
 }
 
 class WorkerThread;
+class WorkStealingDeque;
+
+/// Function for processing an index range in parallel. Called with the range start, range end (exclusive) and thread index (0 = main thread) as parameters.
+using ParallelForFunction = std::function<void(unsigned, unsigned, unsigned)>;
 
 /// Work queue item.
 struct WorkItem : public RefCounted
@@ -43,7 +52,7 @@ struct WorkItem : public RefCounted
     friend class WorkQueue;
 
 public:
-    /// Work function. Called with the work item and thread index (0 = main thread) as parameters.
+    /// Work function. Called with the work item and thread index (0 = main thread) as parameters. May be null for an item that only joins its dependencies.
     void (* workFunction_)(const WorkItem*, unsigned){};
     /// Data start pointer.
     void* start_{};
@@ -59,7 +68,18 @@ public:
     volatile bool completed_{};
 
 private:
+    /// Pooled flag.
     bool pooled_{};
+    /// Whether other items depend on this item.
+    bool hasSuccessors_{};
+    /// Priority bucket the item was queued to.
+    unsigned bucket_{};
+    /// Scheduling state, used to claim the item for execution without locking.
+    std::atomic<unsigned> state_{};
+    /// Number of unfinished predecessors, plus one until the item has been added to the queue.
+    std::atomic<int> dependencies_{1};
+    /// Items depending on this item. Modified by the main thread before queuing, and by the executing thread afterward.
+    PODVector<WorkItem*> successors_;
 };
 
 /// Work queue subsystem for multithreading.
@@ -79,9 +99,11 @@ public:
     void CreateThreads(unsigned numThreads);
     /// Get pointer to an usable WorkItem from the item pool. Allocate one if no more free items.
     SharedPtr<WorkItem> GetFreeItem();
-    /// Add a work item and resume worker threads.
+    /// Add a work item and resume worker threads. Must be called from the main thread. An item re-added after removal, before a worker thread has discarded it, keeps the priority bucket it was first queued with.
     void AddWorkItem(const SharedPtr<WorkItem>& item);
-    /// Remove a work item before it has started executing. Return true if successfully removed.
+    /// Make a work item wait for another item to complete before it executes. Both items must not have been added yet, and both must be added eventually. Return true if successful.
+    bool AddDependency(const SharedPtr<WorkItem>& item, const SharedPtr<WorkItem>& predecessor);
+    /// Remove a work item before it has started executing. Items which other items depend on can not be removed. Return true if successfully removed.
     bool RemoveWorkItem(SharedPtr<WorkItem> item);
     /// Remove a number of work items before they have started executing. Return the number of items successfully removed.
     unsigned RemoveWorkItems(const Vector<SharedPtr<WorkItem> >& items);
@@ -91,6 +113,8 @@ public:
     void Resume();
     /// Finish all queued work which has at least the specified priority. Main thread will also execute priority work. Pause worker threads if no more work remains.
     void Complete(unsigned priority);
+    /// Finish a work item and its predecessors. Unlike Complete(), does not wait for unrelated work. Main thread will also execute work of at least the item's priority. Pause worker threads if no more work remains.
+    void WaitFor(const SharedPtr<WorkItem>& item);
 
     /// Set the pool telerance before it starts deleting pool items.
     void SetTolerance(int tolerance) { tolerance_ = tolerance; }
@@ -98,9 +122,32 @@ public:
     /// Set how many milliseconds maximum per frame to spend on low-priority work, when there are no worker threads.
     void SetNonThreadedWorkMs(int ms) { maxNonThreadedWorkMs_ = Max(ms, 1); }
 
+    /// Queue processing of the index range [begin, end) in chunks of at least grainSize indices. Chunks shrink as the range runs out to balance uneven work between threads. Return a work item which completes once the whole range has been processed. Must be called from the main thread.
+    SharedPtr<WorkItem> AddParallelFor(unsigned begin, unsigned end, unsigned grainSize, const ParallelForFunction& function, unsigned priority = M_MAX_UNSIGNED);
+    /// Process the index range [begin, end) in chunks of at least grainSize indices and wait for completion. The main thread also processes chunks. Must be called from the main thread.
+    void ParallelFor(unsigned begin, unsigned end, unsigned grainSize, const ParallelForFunction& function, unsigned priority = M_MAX_UNSIGNED);
+
+    /// Process the index range [begin, end) in parallel chunks, accumulating into one value per thread, and return the per-thread values combined. The accumulate function is called with the range start, range end and value to accumulate into. The combine function must be associative and commutative. Must be called from the main thread.
+    template <class T, class Accumulate, class Combine> T ParallelReduce(unsigned begin, unsigned end, unsigned grainSize, const T& identity,
+        Accumulate accumulate, Combine combine, unsigned priority = M_MAX_UNSIGNED)
+    {
+        Vector<T> values(GetNumThreads() + 1, identity);
+        ParallelFor(begin, end, grainSize, [&values, &accumulate](unsigned start, unsigned end, unsigned threadIndex)
+        {
+            accumulate(start, end, values[threadIndex]);
+        }, priority);
+
+        T result = identity;
+        for (unsigned i = 0; i < values.Size(); ++i)
+            result = combine(result, values[i]);
+        return result;
+    }
+
     /// Return number of worker threads.
     unsigned GetNumThreads() const { return threads_.Size(); }
 
+    /// Return number of queued or executing work items.
+    unsigned GetNumPendingItems() const;
     /// Return whether all work with at least the specified priority is finished.
     bool IsCompleted(unsigned priority) const;
     /// Return whether the queue is currently completing work in the main thread.
@@ -115,6 +162,18 @@ public:
 private:
     /// Process work items until shut down. Called by the worker threads.
     void ProcessItems(unsigned threadIndex);
+    /// Take a work item for execution from the thread's own deques, or steal from the other threads. Only buckets at or above the minimum are considered. Return null if no work found.
+    WorkItem* TakeItem(unsigned threadIndex, unsigned minBucket);
+    /// Claim a dequeued item for execution. Return false if the item was removed from the queue in the meanwhile.
+    bool ClaimItem(WorkItem* item);
+    /// Push an item whose predecessors have all completed to the deque of the current thread.
+    void ScheduleItem(WorkItem* item, unsigned threadIndex);
+    /// Execute a claimed work item, mark it completed and schedule the items waiting for it.
+    void ExecuteItem(WorkItem* item, unsigned threadIndex);
+    /// Execute queued items with at least the specified priority in the main thread, when there are no worker threads.
+    void CompleteNonThreaded(unsigned priority);
+    /// Return the deque of a thread for a priority bucket.
+    WorkStealingDeque* GetDeque(unsigned threadIndex, unsigned bucket) const { return deques_[threadIndex * NUM_WORK_PRIORITY_BUCKETS + bucket]; }
     /// Purge completed work items which have at least the specified priority, and send completion events as necessary.
     void PurgeCompleted(unsigned priority);
     /// Purge the pool to reduce allocation where its unneeded.
@@ -130,16 +189,20 @@ private:
     List<SharedPtr<WorkItem> > poolItems_;
     /// Work item collection. Accessed only by the main thread.
     List<SharedPtr<WorkItem> > workItems_;
-    /// Work item prioritized queue for worker threads. Pointers are guaranteed to be valid (point to workItems.)
-    List<WorkItem*> queue_;
-    /// Worker queue mutex.
-    Mutex queueMutex_;
+    /// Work items removed before execution whose stale deque entries have not been consumed yet. Accessed only by the main thread.
+    List<SharedPtr<WorkItem> > removedItems_;
+    /// Work-stealing deques per thread (main thread first) and priority bucket. Item pointers are kept valid by workItems_ or removedItems_.
+    PODVector<WorkStealingDeque*> deques_;
+    /// Number of threads owning deques, including the main thread.
+    unsigned numDequeThreads_;
+    /// Number of queued or executing items per priority bucket.
+    std::atomic<unsigned> pendingItems_[NUM_WORK_PRIORITY_BUCKETS];
+    /// Pause mutex. Held by the main thread while paused to prevent worker threads using up CPU time.
+    Mutex pauseMutex_;
     /// Shutting down flag.
     volatile bool shutDown_;
-    /// Pausing flag. Indicates the worker threads should not contend for the queue mutex.
-    volatile bool pausing_;
-    /// Paused flag. Indicates the queue mutex being locked to prevent worker threads using up CPU time.
-    bool paused_;
+    /// Paused flag. Indicates the pause mutex being locked.
+    volatile bool paused_;
     /// Completing work in the main thread flag.
     bool completing_;
     /// Tolerance for the shared pool before it begins to deallocate.
@@ -0,0 +1,138 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Core/WorkStealingDeque.h"
+#include "../Math/MathDefs.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+WorkStealingDeque::Buffer::Buffer(long long capacity) :
+    capacity_(capacity),
+    mask_(capacity - 1),
+    items_(new std::atomic<WorkItem*>[capacity])
+{
+}
+
+WorkStealingDeque::Buffer::~Buffer()
+{
+    delete[] items_;
+}
+
+WorkStealingDeque::WorkStealingDeque(unsigned capacity) :
+    top_(0),
+    bottom_(0),
+    buffer_(new Buffer(NextPowerOfTwo(Max(capacity, 2U))))
+{
+}
+
+WorkStealingDeque::~WorkStealingDeque()
+{
+    delete buffer_.load(std::memory_order_relaxed);
+    for (unsigned i = 0; i < retiredBuffers_.Size(); ++i)
+        delete retiredBuffers_[i];
+}
+
+void WorkStealingDeque::Push(WorkItem* item)
+{
+    long long bottom = bottom_.load(std::memory_order_relaxed);
+    long long top = top_.load(std::memory_order_acquire);
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+
+    if (bottom - top > buffer->capacity_ - 1)
+        buffer = Grow(buffer, bottom, top);
+
+    buffer->Put(bottom, item);
+    // Publish the item before the new bottom becomes visible to stealing threads
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+}
+
+WorkItem* WorkStealingDeque::Pop()
+{
+    long long bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long top = top_.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+        // Empty, restore bottom
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    WorkItem* item = buffer->Get(bottom);
+    if (top == bottom)
+    {
+        // Last item: race against stealing threads for it
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            item = nullptr;
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return item;
+}
+
+WorkItem* WorkStealingDeque::Steal()
+{
+    for (;;)
+    {
+        long long top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long long bottom = bottom_.load(std::memory_order_acquire);
+
+        if (top >= bottom)
+            return nullptr;
+
+        Buffer* buffer = buffer_.load(std::memory_order_acquire);
+        WorkItem* item = buffer->Get(top);
+        if (top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return item;
+        // Lost the race to another thread, retry while items remain
+    }
+}
+
+unsigned WorkStealingDeque::Size() const
+{
+    long long bottom = bottom_.load(std::memory_order_relaxed);
+    long long top = top_.load(std::memory_order_relaxed);
+    return bottom > top ? (unsigned)(bottom - top) : 0;
+}
+
+WorkStealingDeque::Buffer* WorkStealingDeque::Grow(Buffer* buffer, long long bottom, long long top)
+{
+    auto* newBuffer = new Buffer(buffer->capacity_ * 2);
+    for (long long i = top; i < bottom; ++i)
+        newBuffer->Put(i, buffer->Get(i));
+
+    retiredBuffers_.Push(buffer);
+    buffer_.store(newBuffer, std::memory_order_release);
+    return newBuffer;
+}
+
+}
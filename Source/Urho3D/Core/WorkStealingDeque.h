@@ -0,0 +1,97 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/Vector.h"
+
+#include <atomic>
+
+namespace Urho3D
+{
+
+struct WorkItem;
+
+/// Lock-free work-stealing deque of work items (Chase-Lev). The owner thread pushes and pops at the bottom, other threads steal from the top.
+class URHO3D_API WorkStealingDeque
+{
+public:
+    /// Construct with initial capacity, which is rounded up to a power of two.
+    explicit WorkStealingDeque(unsigned capacity = 64);
+    /// Destruct.
+    ~WorkStealingDeque();
+
+    /// Prevent copy construction.
+    WorkStealingDeque(const WorkStealingDeque& rhs) = delete;
+    /// Prevent assignment.
+    WorkStealingDeque& operator =(const WorkStealingDeque& rhs) = delete;
+
+    /// Push an item to the bottom, growing the storage if necessary. Must only be called by the owner thread.
+    void Push(WorkItem* item);
+    /// Pop an item from the bottom. Must only be called by the owner thread. Return null if empty.
+    WorkItem* Pop();
+    /// Steal an item from the top. Can be called from any thread. Return null if empty.
+    WorkItem* Steal();
+
+    /// Return approximate number of items. Exact only when no other thread is accessing the deque.
+    unsigned Size() const;
+    /// Return whether the deque appears empty.
+    bool IsEmpty() const { return Size() == 0; }
+
+private:
+    /// Circular item storage.
+    struct Buffer
+    {
+        /// Construct with a power of two capacity.
+        explicit Buffer(long long capacity);
+        /// Destruct.
+        ~Buffer();
+
+        /// Return item at logical index.
+        WorkItem* Get(long long index) const { return items_[index & mask_].load(std::memory_order_relaxed); }
+        /// Set item at logical index.
+        void Put(long long index, WorkItem* item) { items_[index & mask_].store(item, std::memory_order_relaxed); }
+
+        /// Capacity.
+        long long capacity_;
+        /// Index mask.
+        long long mask_;
+        /// Item slots.
+        std::atomic<WorkItem*>* items_;
+    };
+
+    /// Replace the storage with a buffer of double capacity. Return the new buffer.
+    Buffer* Grow(Buffer* buffer, long long bottom, long long top);
+
+    /// Top index, advanced by stealing threads.
+    std::atomic<long long> top_;
+    /// Padding to keep the top and bottom indices on separate cache lines.
+    char padding_[64 - sizeof(std::atomic<long long>)];
+    /// Bottom index, modified only by the owner thread.
+    std::atomic<long long> bottom_;
+    /// Current storage.
+    std::atomic<Buffer*> buffer_;
+    /// Storage buffers replaced by growing. Kept alive until destruction, as stealing threads may still be reading them.
+    PODVector<Buffer*> retiredBuffers_;
+};
+
+}
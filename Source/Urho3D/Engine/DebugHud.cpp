@@ -36,6 +36,8 @@
 #include "../UI/Text.h"
 #include "../UI/UI.h"
 
+#include <MemoryCache/MemoryMgr.h>
+
 #include "../DebugNew.h"
 
 namespace Urho3D
@@ -59,6 +61,38 @@ static const char* shadowQualityTexts[] =
     "Blurred VSM"
 };
 
+/// Format the usage statistics of the small block memory manager.
+static String PrintManagedMemoryUsage()
+{
+    EnginePlus::SMemoryStatistics statistics;
+    EnginePlus::CMemoryMgr::Instance().GetStatistics(statistics);
+
+    String output = "Block Size                    Live      Peak    Cached     Total\n\n";
+    char outputLine[256];
+
+    for (unsigned i = 0; i < MEM_CACHE_COUNT; ++i)
+    {
+        const EnginePlus::SMemCacheStatistics& cache = statistics.caches[i];
+        if (!cache.uPageBlocks)
+            continue;
+
+        sprintf(outputLine, "%-28u %5u %9u %9u %9s\n", (unsigned)cache.uBlockSize, cache.uLiveBlocks, cache.uPeakBlocks,
+            cache.uFreeBlocks + cache.uThreadBlocks, GetFileSizeString(cache.uPageBlocks * cache.uBlockSize).CString());
+        output += (const char*)outputLine;
+    }
+
+    const unsigned long long pageBytes = (unsigned long long)statistics.uPageCount * MEMORY_PAGE_SIZE;
+    const unsigned usedPercent = pageBytes ? (unsigned)((pageBytes - statistics.uUnusedPageBytes) * 100 / pageBytes) : 0;
+    output.AppendWithFormat("\nPages: %u (%s, %u%% carved) Live: %s Cached: %s\n", statistics.uPageCount,
+        GetFileSizeString(pageBytes).CString(), usedPercent, GetFileSizeString(statistics.uLiveBlockBytes).CString(),
+        GetFileSizeString(statistics.uFreeBlockBytes).CString());
+    output.AppendWithFormat("Large blocks: %u live (%s, peak %s) of %u, size %u - %u\n", (unsigned)statistics.uLiveLargeBlocks,
+        GetFileSizeString(statistics.uLiveLargeBytes).CString(), GetFileSizeString(statistics.uPeakLargeBytes).CString(),
+        (unsigned)statistics.uLargeBlockCount, (unsigned)statistics.uLargeBlocksMin, (unsigned)statistics.uLargeBlocksMax);
+
+    return output;
+}
+
 DebugHud::DebugHud(Context* context) :
     Object(context),
     profilerMaxDepth_(M_MAX_UNSIGNED),
@@ -202,7 +236,7 @@ void DebugHud::Update()
     }
 
     if (memoryText_->IsVisible())
-        memoryText_->SetText(GetSubsystem<ResourceCache>()->PrintMemoryUsage());
+        memoryText_->SetText(GetSubsystem<ResourceCache>()->PrintMemoryUsage() + "\n" + PrintManagedMemoryUsage());
 }
 
 void DebugHud::SetDefaultStyle(XMLFile* style)
@@ -26,6 +26,8 @@
 #include "../Core/Context.h"
 #include "../Core/CoreEvents.h"
 #include "../Core/EventProfiler.h"
+#include "../Core/EventStatistics.h"
+#include "../Core/FrameAllocator.h"
 #include "../Core/ProcessUtils.h"
 #include "../Core/WorkQueue.h"
 #include "../Engine/Console.h"
@@ -35,6 +37,7 @@
 #include "../Graphics/Graphics.h"
 #include "../Graphics/Renderer.h"
 #include "../Input/Input.h"
+#include "../IO/File.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
 #include "../IO/PackageFile.h"
@@ -121,6 +124,7 @@ Engine::Engine(Context* context) :
     // Create subsystems which do not depend on engine initialization or startup parameters
     context_->RegisterSubsystem(new Time(context_));
     context_->RegisterSubsystem(new WorkQueue(context_));
+    context_->RegisterSubsystem(new FrameAllocator(context_));
 #ifdef URHO3D_PROFILING
     context_->RegisterSubsystem(new Profiler(context_));
 #endif
@@ -311,6 +315,11 @@ bool Engine::Initialize(const VariantMap& parameters)
         EventProfiler::SetActive(true);
     }
 #endif
+    if (GetParameter(parameters, EP_EVENT_STATISTICS, false).GetBool())
+    {
+        context_->RegisterSubsystem(new EventStatistics(context_));
+        EventStatistics::SetActive(true);
+    }
     frameTimer_.Reset();
 
     URHO3D_LOGINFO("Initialized engine");
@@ -334,6 +343,9 @@ bool Engine::InitializeResourceCache(const VariantMap& parameters, bool removeOl
             cache->RemovePackageFile(packageFiles[i]);
     }
 
+    cache->SetMemoryMapPackages(GetParameter(parameters, EP_MEMORY_MAP_PACKAGES, false).GetBool());
+    cache->SetCacheResourceDirLookups(GetParameter(parameters, EP_CACHE_RESOURCE_DIR_LOOKUPS, false).GetBool());
+
     // Add resource paths
     Vector<String> resourcePrefixPaths = GetParameter(parameters, EP_RESOURCE_PREFIX_PATHS, String::EMPTY).GetString().Split(';', true);
     for (unsigned i = 0; i < resourcePrefixPaths.Size(); ++i)
@@ -615,6 +627,22 @@ void Engine::DumpProfiler()
 #endif
 }
 
+bool Engine::SaveProfilerTimeline(const String& fileName)
+{
+    auto* profiler = GetSubsystem<Profiler>();
+    if (!profiler)
+    {
+        URHO3D_LOGERROR("Can not save profiler timeline without the profiler");
+        return false;
+    }
+
+    File file(context_, fileName, FILE_WRITE);
+    if (!file.IsOpen())
+        return false;
+
+    return profiler->SaveTimeline(file);
+}
+
 void Engine::DumpResources(bool dumpFileName)
 {
 #ifdef URHO3D_LOGGING
@@ -70,6 +70,8 @@ public:
     void Exit();
     /// Dump profiling information to the log.
     void DumpProfiler();
+    /// Save the frame timelines captured by the profiler to a file in the Chrome trace event JSON format. Return true if successful.
+    bool SaveProfilerTimeline(const String& fileName);
     /// Dump information of all resources to the log.
     void DumpResources(bool dumpFileName = false);
     /// Dump information of all memory allocations to the log. Supported in MSVC debug mode only.
@@ -28,8 +28,10 @@ namespace Urho3D
 // Engine parameters
 static const String EP_AUTOLOAD_PATHS = "AutoloadPaths";
 static const String EP_BORDERLESS = "Borderless";
+static const String EP_CACHE_RESOURCE_DIR_LOOKUPS = "CacheResourceDirLookups";
 static const String EP_DUMP_SHADERS = "DumpShaders";
 static const String EP_EVENT_PROFILER = "EventProfiler";
+static const String EP_EVENT_STATISTICS = "EventStatistics";
 static const String EP_EXTERNAL_WINDOW = "ExternalWindow";
 static const String EP_FLUSH_GPU = "FlushGPU";
 static const String EP_FORCE_GL2 = "ForceGL2";
@@ -42,6 +44,7 @@ static const String EP_LOG_NAME = "LogName";
 static const String EP_LOG_QUIET = "LogQuiet";
 static const String EP_LOW_QUALITY_SHADOWS = "LowQualityShadows";
 static const String EP_MATERIAL_QUALITY = "MaterialQuality";
+static const String EP_MEMORY_MAP_PACKAGES = "MemoryMapPackages";
 static const String EP_MONITOR = "Monitor";
 static const String EP_MULTI_SAMPLE = "MultiSample";
 static const String EP_ORIENTATIONS = "Orientations";
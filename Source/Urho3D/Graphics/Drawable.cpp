@@ -67,6 +67,7 @@ Drawable::Drawable(Context* context, unsigned char drawableFlags) :
     updateQueued_(false),
     zoneDirty_(false),
     octant_(nullptr),
+    flatIndex_(M_MAX_UNSIGNED),
     zone_(nullptr),
     viewMask_(DEFAULT_VIEWMASK),
     lightMask_(DEFAULT_LIGHTMASK),
@@ -415,6 +416,7 @@ void Drawable::RemoveFromOctree()
         // Perform subclass specific deinitialization if necessary
         OnRemoveFromOctree();
 
+        octree->MarkFlatStorageDirty();
         octant_->RemoveDrawable(this);
     }
 }
@@ -54,7 +54,6 @@ class Octant;
 class RayOctreeQuery;
 class Zone;
 struct RayQueryResult;
-struct WorkItem;
 
 /// Geometry update type.
 enum UpdateGeometryType
@@ -113,7 +112,7 @@ class URHO3D_API Drawable : public Component
 
     friend class Octant;
     friend class Octree;
-    friend void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex);
+    friend void UpdateDrawables(const FrameInfo& frame, Drawable** start, Drawable** end);
 
 public:
     /// Construct.
@@ -347,6 +346,8 @@ protected:
     bool zoneDirty_;
     /// Octree octant.
     Octant* octant_;
+    /// Index in the octree's flat culling storage.
+    unsigned flatIndex_;
     /// Current zone.
     Zone* zone_;
     /// View mask.
@@ -45,15 +45,38 @@ namespace Urho3D
 
 static const float DEFAULT_OCTREE_SIZE = 1000.0f;
 static const int DEFAULT_OCTREE_LEVELS = 8;
+static const float DEFAULT_OCTREE_LOOSENESS = 2.0f;
 
 extern const char* SUBSYSTEM_CATEGORY;
 
-void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex)
+/// Minimum number of drawables per work chunk when updating drawables.
+static const unsigned DRAWABLES_PER_UPDATE_CHUNK = 16;
+/// Minimum number of drawables per work chunk when computing reinsertion target octants.
+static const unsigned DRAWABLES_PER_REINSERTION_CHUNK = 64;
+/// Minimum number of updated drawables to use threaded reinsertion for.
+static const unsigned MIN_THREADED_REINSERTIONS = 256;
+/// Maximum number of rays traversed together in a batched ray query.
+static const unsigned RAY_PACKET_SIZE = 32;
+
+/// Rays of a batched ray query traversed together through the octree.
+struct RayQueryPacket
+{
+    /// Batched ray query.
+    RayBatchOctreeQuery* query_;
+    /// Index of the first ray.
+    unsigned start_;
+    /// Number of rays.
+    unsigned numRays_;
+    /// Maximum distance of each ray, reduced to the closest hit so far.
+    float maxDistances_[RAY_PACKET_SIZE];
+    /// View mask of each ray.
+    unsigned viewMasks_[RAY_PACKET_SIZE];
+    /// Temporary hit list for the drawables' ray queries.
+    PODVector<RayQueryResult>* hits_;
+};
+
+void UpdateDrawables(const FrameInfo& frame, Drawable** start, Drawable** end)
 {
-    const FrameInfo& frame = *(reinterpret_cast<FrameInfo*>(item->aux_));
-    auto** start = reinterpret_cast<Drawable**>(item->start_);
-    auto** end = reinterpret_cast<Drawable**>(item->end_);
-
     while (start != end)
     {
         Drawable* drawable = *start;
@@ -63,6 +86,30 @@ void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex)
     }
 }
 
+/// Store a bounding box to a box group.
+static void SetGroupBox(DrawableBoxGroup& group, unsigned index, const BoundingBox& box)
+{
+    // Calculate the half size the same way as Frustum::IsInsideFast() for identical results
+    Vector3 center = box.Center();
+    Vector3 halfSize = center - box.min_;
+
+    group.centerX_[index] = center.x_;
+    group.centerY_[index] = center.y_;
+    group.centerZ_[index] = center.z_;
+    group.halfSizeX_[index] = halfSize.x_;
+    group.halfSizeY_[index] = halfSize.y_;
+    group.halfSizeZ_[index] = halfSize.z_;
+}
+
+static void UpdateWorldTransforms(const Node* node)
+{
+    node->GetWorldTransform();
+
+    const Vector<SharedPtr<Node> >& children = node->GetChildren();
+    for (Vector<SharedPtr<Node> >::ConstIterator i = children.Begin(); i != children.End(); ++i)
+        UpdateWorldTransforms(*i);
+}
+
 inline bool CompareRayQueryResults(const RayQueryResult& lhs, const RayQueryResult& rhs)
 {
     return lhs.distance_ < rhs.distance_;
@@ -74,7 +121,8 @@ Octant::Octant(const BoundingBox& box, unsigned level, Octant* parent, Octree* r
     root_(root),
     index_(index)
 {
-    Initialize(box);
+    // The root octant is initialized again by the octree once its looseness is known
+    Initialize(box, parent ? root->GetLooseness() : DEFAULT_OCTREE_LOOSENESS);
 }
 
 Octant::~Octant()
@@ -148,6 +196,8 @@ void Octant::InsertDrawable(Drawable* drawable)
         Octant* oldOctant = drawable->octant_;
         if (oldOctant != this)
         {
+            root_->MarkFlatStorageDirty();
+
             // Add first, then remove, because drawable count going to zero deletes the octree branch in question
             AddDrawable(drawable);
             if (oldOctant)
@@ -165,9 +215,70 @@ void Octant::InsertDrawable(Drawable* drawable)
     }
 }
 
+bool Octant::ApplyCountIncrease()
+{
+    if (drawableCountChange_ < 0)
+        return true;
+
+    IncDrawableCount((unsigned)drawableCountChange_);
+    drawableCountChange_ = 0;
+    countChangeQueued_ = false;
+    return false;
+}
+
+void Octant::ApplyCountDecrease()
+{
+    auto count = (unsigned)-drawableCountChange_;
+    drawableCountChange_ = 0;
+    countChangeQueued_ = false;
+    // May delete this octant
+    DecDrawableCount(count);
+}
+
+Octant* Octant::FindInsertionOctant(Drawable* drawable, bool createChildren, bool& final)
+{
+    const BoundingBox& box = drawable->GetWorldBoundingBox();
+    Vector3 boxCenter = box.Center();
+    Octant* octant = this;
+
+    // Same fit rules as InsertDrawable()
+    for (;;)
+    {
+        bool insertHere;
+        if (octant == root_)
+            insertHere = !drawable->IsOccludee() || octant->cullingBox_.IsInside(box) != INSIDE || octant->CheckDrawableFit(box);
+        else
+            insertHere = octant->CheckDrawableFit(box);
+
+        if (insertHere)
+        {
+            final = true;
+            return octant;
+        }
+
+        unsigned x = boxCenter.x_ < octant->center_.x_ ? 0 : 1;
+        unsigned y = boxCenter.y_ < octant->center_.y_ ? 0 : 2;
+        unsigned z = boxCenter.z_ < octant->center_.z_ ? 0 : 4;
+
+        Octant* child = octant->children_[x + y + z];
+        if (!child)
+        {
+            if (!createChildren)
+            {
+                final = false;
+                return octant;
+            }
+            child = octant->GetOrCreateChild(x + y + z);
+        }
+        octant = child;
+    }
+}
+
 bool Octant::CheckDrawableFit(const BoundingBox& box) const
 {
     Vector3 boxSize = box.Size();
+    // Child octant culling boxes extend this much beyond the child octants, relative to this octant's half size
+    float childMargin = 0.5f * (root_->GetLooseness() - 1.0f);
 
     // If max split level, size always OK, otherwise check that box is at least half size of octant
     if (level_ >= root_->GetNumLevels() || boxSize.x_ >= halfSize_.x_ || boxSize.y_ >= halfSize_.y_ ||
@@ -176,12 +287,12 @@ bool Octant::CheckDrawableFit(const BoundingBox& box) const
     // Also check if the box can not fit a child octant's culling box, in that case size OK (must insert here)
     else
     {
-        if (box.min_.x_ <= worldBoundingBox_.min_.x_ - 0.5f * halfSize_.x_ ||
-            box.max_.x_ >= worldBoundingBox_.max_.x_ + 0.5f * halfSize_.x_ ||
-            box.min_.y_ <= worldBoundingBox_.min_.y_ - 0.5f * halfSize_.y_ ||
-            box.max_.y_ >= worldBoundingBox_.max_.y_ + 0.5f * halfSize_.y_ ||
-            box.min_.z_ <= worldBoundingBox_.min_.z_ - 0.5f * halfSize_.z_ ||
-            box.max_.z_ >= worldBoundingBox_.max_.z_ + 0.5f * halfSize_.z_)
+        if (box.min_.x_ <= worldBoundingBox_.min_.x_ - childMargin * halfSize_.x_ ||
+            box.max_.x_ >= worldBoundingBox_.max_.x_ + childMargin * halfSize_.x_ ||
+            box.min_.y_ <= worldBoundingBox_.min_.y_ - childMargin * halfSize_.y_ ||
+            box.max_.y_ >= worldBoundingBox_.max_.y_ + childMargin * halfSize_.y_ ||
+            box.min_.z_ <= worldBoundingBox_.min_.z_ - childMargin * halfSize_.z_ ||
+            box.max_.z_ >= worldBoundingBox_.max_.z_ + childMargin * halfSize_.z_)
             return true;
     }
 
@@ -218,12 +329,13 @@ void Octant::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
     }
 }
 
-void Octant::Initialize(const BoundingBox& box)
+void Octant::Initialize(const BoundingBox& box, float looseness)
 {
     worldBoundingBox_ = box;
     center_ = box.Center();
     halfSize_ = 0.5f * box.Size();
-    cullingBox_ = BoundingBox(worldBoundingBox_.min_ - halfSize_, worldBoundingBox_.max_ + halfSize_);
+    Vector3 margin = (looseness - 1.0f) * halfSize_;
+    cullingBox_ = BoundingBox(worldBoundingBox_.min_ - margin, worldBoundingBox_.max_ + margin);
 }
 
 void Octant::GetDrawablesInternal(OctreeQuery& query, bool inside) const
@@ -281,6 +393,121 @@ void Octant::GetDrawablesInternal(RayOctreeQuery& query) const
     }
 }
 
+void Octant::RaycastPacketInternal(RayQueryPacket& packet, unsigned rayMask) const
+{
+    const RayBatchOctreeQuery& query = *packet.query_;
+    const Ray* rays = &query.rays_[packet.start_];
+
+    // Drop the rays that miss the octant, or hit it beyond their closest hit so far
+    for (unsigned i = 0; i < packet.numRays_; ++i)
+    {
+        if ((rayMask & (1u << i)) && rays[i].HitDistance(cullingBox_) >= packet.maxDistances_[i])
+            rayMask &= ~(1u << i);
+    }
+
+    if (!rayMask)
+        return;
+
+    for (PODVector<Drawable*>::ConstIterator j = drawables_.Begin(); j != drawables_.End(); ++j)
+    {
+        Drawable* drawable = *j;
+        if (!(drawable->GetDrawableFlags() & query.drawableFlags_))
+            continue;
+
+        const BoundingBox& box = drawable->GetWorldBoundingBox();
+        for (unsigned i = 0; i < packet.numRays_; ++i)
+        {
+            if (!(rayMask & (1u << i)) || !(drawable->GetViewMask() & packet.viewMasks_[i]) ||
+                rays[i].HitDistance(box) >= packet.maxDistances_[i])
+                continue;
+
+            RayOctreeQuery rayQuery(*packet.hits_, rays[i], query.level_, packet.maxDistances_[i], query.drawableFlags_,
+                packet.viewMasks_[i]);
+            packet.hits_->Clear();
+            drawable->ProcessRayQuery(rayQuery, *packet.hits_);
+
+            for (PODVector<RayQueryResult>::ConstIterator k = packet.hits_->Begin(); k != packet.hits_->End(); ++k)
+            {
+                if (k->distance_ < packet.maxDistances_[i])
+                {
+                    query.result_[packet.start_ + i] = *k;
+                    packet.maxDistances_[i] = k->distance_;
+                }
+            }
+        }
+    }
+
+    // Visit the children in approximate front-to-back order of the first remaining ray, so that closer hits cull more
+    unsigned first = 0;
+    while (!(rayMask & (1u << first)))
+        ++first;
+    const Vector3& direction = rays[first].direction_;
+    unsigned flip = (direction.x_ < 0.0f ? 1u : 0u) | (direction.y_ < 0.0f ? 2u : 0u) | (direction.z_ < 0.0f ? 4u : 0u);
+    for (unsigned i = 0; i < NUM_OCTANTS; ++i)
+    {
+        Octant* child = children_[i ^ flip];
+        if (child)
+            child->RaycastPacketInternal(packet, rayMask);
+    }
+}
+
+void Octant::UpdateWorldBoundingBoxesInternal() const
+{
+    for (PODVector<Drawable*>::ConstIterator i = drawables_.Begin(); i != drawables_.End(); ++i)
+        (*i)->GetWorldBoundingBox();
+
+    for (auto child : children_)
+    {
+        if (child)
+            child->UpdateWorldBoundingBoxesInternal();
+    }
+}
+
+void Octant::FlattenInternal(PODVector<OctreeFlatNode>& nodes, PODVector<Drawable*>& drawables,
+    PODVector<DrawableBoxGroup>& boxes) const
+{
+    unsigned nodeIndex = nodes.Size();
+    unsigned drawableStart = drawables.Size();
+    unsigned drawableEnd = drawableStart + (drawables_.Size() + DRAWABLE_BOX_GROUP_SIZE - 1) / DRAWABLE_BOX_GROUP_SIZE *
+        DRAWABLE_BOX_GROUP_SIZE;
+
+    OctreeFlatNode node;
+    node.cullingBox_ = cullingBox_;
+    node.drawableStart_ = drawableStart;
+    node.drawableEnd_ = drawableEnd;
+    nodes.Push(node);
+
+    drawables.Resize(drawableEnd);
+    boxes.Resize(drawableEnd / DRAWABLE_BOX_GROUP_SIZE);
+
+    for (unsigned i = 0; i < drawableEnd - drawableStart; ++i)
+    {
+        unsigned flatIndex = drawableStart + i;
+        DrawableBoxGroup& group = boxes[flatIndex / DRAWABLE_BOX_GROUP_SIZE];
+
+        if (i < drawables_.Size())
+        {
+            Drawable* drawable = drawables_[i];
+            drawable->flatIndex_ = flatIndex;
+            drawables[flatIndex] = drawable;
+            SetGroupBox(group, flatIndex % DRAWABLE_BOX_GROUP_SIZE, drawable->GetWorldBoundingBox());
+        }
+        else
+        {
+            drawables[flatIndex] = nullptr;
+            SetGroupBox(group, flatIndex % DRAWABLE_BOX_GROUP_SIZE, BoundingBox(0.0f, 0.0f));
+        }
+    }
+
+    for (auto child : children_)
+    {
+        if (child)
+            child->FlattenInternal(nodes, drawables, boxes);
+    }
+
+    nodes[nodeIndex].subtreeEnd_ = nodes.Size();
+}
+
 void Octant::GetDrawablesOnlyInternal(RayOctreeQuery& query, PODVector<Drawable*>& drawables) const
 {
     float octantDist = query.ray_.HitDistance(cullingBox_);
@@ -311,7 +538,11 @@ void Octant::GetDrawablesOnlyInternal(RayOctreeQuery& query, PODVector<Drawable*
 Octree::Octree(Context* context) :
     Component(context),
     Octant(BoundingBox(-DEFAULT_OCTREE_SIZE, DEFAULT_OCTREE_SIZE), 0, nullptr, this),
-    numLevels_(DEFAULT_OCTREE_LEVELS)
+    numLevels_(DEFAULT_OCTREE_LEVELS),
+    looseness_(DEFAULT_OCTREE_LOOSENESS),
+    threadedReinsertion_(false),
+    flatCulling_(false),
+    flatStorageDirty_(true)
 {
     // If the engine is running headless, subscribe to RenderUpdate events for manually updating the octree
     // to allow raycasts and animation update
@@ -336,6 +567,9 @@ void Octree::RegisterObject(Context* context)
     URHO3D_ATTRIBUTE_EX("Bounding Box Min", Vector3, worldBoundingBox_.min_, UpdateOctreeSize, defaultBoundsMin, AM_DEFAULT);
     URHO3D_ATTRIBUTE_EX("Bounding Box Max", Vector3, worldBoundingBox_.max_, UpdateOctreeSize, defaultBoundsMax, AM_DEFAULT);
     URHO3D_ATTRIBUTE_EX("Number of Levels", int, numLevels_, UpdateOctreeSize, DEFAULT_OCTREE_LEVELS, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Looseness", GetLooseness, SetLooseness, float, DEFAULT_OCTREE_LOOSENESS, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Threaded Reinsertion", GetThreadedReinsertion, SetThreadedReinsertion, bool, false, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Flat Culling", GetFlatCulling, SetFlatCulling, bool, false, AM_DEFAULT);
 }
 
 void Octree::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
@@ -356,9 +590,37 @@ void Octree::SetSize(const BoundingBox& box, unsigned numLevels)
     for (unsigned i = 0; i < NUM_OCTANTS; ++i)
         DeleteChild(i);
 
-    Initialize(box);
+    Initialize(box, looseness_);
     numDrawables_ = drawables_.Size();
     numLevels_ = Max(numLevels, 1U);
+    flatStorageDirty_ = true;
+}
+
+void Octree::SetLooseness(float looseness)
+{
+    looseness = Clamp(looseness, 2.0f, 4.0f);
+    if (looseness == looseness_)
+        return;
+
+    looseness_ = looseness;
+    SetSize(worldBoundingBox_, numLevels_);
+}
+
+void Octree::SetFlatCulling(bool enable)
+{
+    if (enable == flatCulling_)
+        return;
+
+    flatCulling_ = enable;
+    flatStorageDirty_ = true;
+
+    // The storage is built on the next Update(). Until then, queries use the octants
+    if (!enable)
+    {
+        flatNodes_.Clear();
+        flatDrawables_.Clear();
+        flatBoxes_.Clear();
+    }
 }
 
 void Octree::Update(const FrameInfo& frame)
@@ -369,6 +631,10 @@ void Octree::Update(const FrameInfo& frame)
         return;
     }
 
+    // Apply batched transform changes made after the scene update, so that moved drawables get queued for reinsertion
+    if (Scene* scene = GetScene())
+        scene->UpdateTransforms();
+
     // Let drawables update themselves before reinsertion. This can be used for animation
     if (!drawableUpdates_.Empty())
     {
@@ -380,30 +646,13 @@ void Octree::Update(const FrameInfo& frame)
         auto* queue = GetSubsystem<WorkQueue>();
         scene->BeginThreadedUpdate();
 
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = Max((int)(drawableUpdates_.Size() / numWorkItems), 1);
-
-        PODVector<Drawable*>::Iterator start = drawableUpdates_.Begin();
-        // Create a work item for each thread
-        for (int i = 0; i < numWorkItems; ++i)
+        // Animated drawables are far more expensive to update than static ones, so let the work queue balance the chunks between threads
+        queue->ParallelFor(0, drawableUpdates_.Size(), DRAWABLES_PER_UPDATE_CHUNK,
+            [this, &frame](unsigned start, unsigned end, unsigned threadIndex)
         {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = UpdateDrawablesWork;
-            item->aux_ = const_cast<FrameInfo*>(&frame);
-
-            PODVector<Drawable*>::Iterator end = drawableUpdates_.End();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
-
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
-
-            start = end;
-        }
+            UpdateDrawables(frame, &drawableUpdates_[start], &drawableUpdates_[0] + end);
+        });
 
-        queue->Complete(M_MAX_UNSIGNED);
         scene->EndThreadedUpdate();
     }
 
@@ -435,6 +684,9 @@ void Octree::Update(const FrameInfo& frame)
         eventData[P_SCENE] = scene;
         eventData[P_TIMESTEP] = frame.timeStep_;
         scene->SendEvent(E_SCENEDRAWABLEUPDATEFINISHED, eventData);
+
+        // Apply batched transform changes made by the handlers, so that the moved drawables are reinserted this frame
+        scene->UpdateTransforms();
     }
 
     // Reinsert drawables that have been moved or resized, or that have been newly added to the octree and do not sit inside
@@ -443,37 +695,131 @@ void Octree::Update(const FrameInfo& frame)
     {
         URHO3D_PROFILE(ReinsertToOctree);
 
-        for (PODVector<Drawable*>::Iterator i = drawableUpdates_.Begin(); i != drawableUpdates_.End(); ++i)
+        if (threadedReinsertion_ && drawableUpdates_.Size() >= MIN_THREADED_REINSERTIONS)
+            ReinsertDrawablesThreaded();
+        else
+            ReinsertDrawables();
+
+#ifdef _DEBUG
+        // Verify that the drawables will be culled correctly
+        for (PODVector<Drawable*>::ConstIterator i = drawableUpdates_.Begin(); i != drawableUpdates_.End(); ++i)
         {
             Drawable* drawable = *i;
-            drawable->updateQueued_ = false;
             Octant* octant = drawable->GetOctant();
             const BoundingBox& box = drawable->GetWorldBoundingBox();
-
-            // Skip if no octant or does not belong to this octree anymore
-            if (!octant || octant->GetRoot() != this)
-                continue;
-            // Skip if still fits the current octant
-            if (drawable->IsOccludee() && octant->GetCullingBox().IsInside(box) == INSIDE && octant->CheckDrawableFit(box))
-                continue;
-
-            InsertDrawable(drawable);
-
-#ifdef _DEBUG
-            // Verify that the drawable will be culled correctly
-            octant = drawable->GetOctant();
-            if (octant != this && octant->GetCullingBox().IsInside(box) != INSIDE)
+            if (octant && octant->GetRoot() == this && octant != this && octant->GetCullingBox().IsInside(box) != INSIDE)
             {
                 URHO3D_LOGERROR("Drawable is not fully inside its octant's culling bounds: drawable box " + box.ToString() +
                          " octant box " + octant->GetCullingBox().ToString());
             }
-#endif
         }
+#endif
     }
 
+    if (flatCulling_)
+        UpdateFlatStorage();
+
     drawableUpdates_.Clear();
 }
 
+void Octree::ReinsertDrawables()
+{
+    for (PODVector<Drawable*>::Iterator i = drawableUpdates_.Begin(); i != drawableUpdates_.End(); ++i)
+    {
+        Drawable* drawable = *i;
+        drawable->updateQueued_ = false;
+        Octant* octant = drawable->GetOctant();
+        const BoundingBox& box = drawable->GetWorldBoundingBox();
+
+        // Skip if no octant or does not belong to this octree anymore
+        if (!octant || octant->GetRoot() != this)
+            continue;
+        // Skip if still fits the current octant
+        if (drawable->IsOccludee() && octant->GetCullingBox().IsInside(box) == INSIDE && octant->CheckDrawableFit(box))
+            continue;
+
+        InsertDrawable(drawable);
+    }
+}
+
+void Octree::ReinsertDrawablesThreaded()
+{
+    reinsertions_.Resize(drawableUpdates_.Size());
+
+    // Refresh the world bounding boxes first. A dirty box updates the world transforms of the node and its parents, which
+    // drawables in different worker threads could share
+    {
+        URHO3D_PROFILE(UpdateReinsertionBoxes);
+
+        for (PODVector<Drawable*>::ConstIterator i = drawableUpdates_.Begin(); i != drawableUpdates_.End(); ++i)
+            (*i)->GetWorldBoundingBox();
+    }
+
+    // Find the target octants in worker threads. The octant hierarchy is only read during this
+    {
+        URHO3D_PROFILE(FindReinsertionOctants);
+
+        auto* queue = GetSubsystem<WorkQueue>();
+        queue->ParallelFor(0, drawableUpdates_.Size(), DRAWABLES_PER_REINSERTION_CHUNK,
+            [this](unsigned start, unsigned end, unsigned threadIndex)
+        {
+            for (unsigned i = start; i < end; ++i)
+            {
+                Drawable* drawable = drawableUpdates_[i];
+                OctreeReinsertion& reinsertion = reinsertions_[i];
+                reinsertion.drawable_ = drawable;
+                reinsertion.newOctant_ = nullptr;
+                drawable->updateQueued_ = false;
+
+                Octant* octant = drawable->GetOctant();
+                reinsertion.oldOctant_ = octant;
+                if (!octant || octant->GetRoot() != this)
+                    continue;
+                const BoundingBox& box = drawable->GetWorldBoundingBox();
+                if (drawable->IsOccludee() && octant->GetCullingBox().IsInside(box) == INSIDE && octant->CheckDrawableFit(box))
+                    continue;
+
+                Octant* newOctant = FindInsertionOctant(drawable, false, reinsertion.final_);
+                if (newOctant != octant || !reinsertion.final_)
+                    reinsertion.newOctant_ = newOctant;
+            }
+        });
+    }
+
+    URHO3D_PROFILE(ApplyReinsertions);
+
+    // Move the drawables in the same order as serial reinsertion, but defer the drawable count updates, which walk up the
+    // octree and may delete octants, to be done once per octant. Missing child octants are created, but none are deleted
+    // before the counts are updated, so the octants found by the worker threads stay valid
+    for (PODVector<OctreeReinsertion>::Iterator i = reinsertions_.Begin(); i != reinsertions_.End(); ++i)
+    {
+        if (!i->newOctant_)
+            continue;
+
+        if (!i->final_)
+            i->newOctant_ = i->newOctant_->FindInsertionOctant(i->drawable_, true, i->final_);
+        if (i->newOctant_->AddMovingDrawable(i->drawable_))
+            movedOctants_.Push(i->newOctant_);
+        if (i->oldOctant_->RemoveMovingDrawable(i->drawable_))
+            movedOctants_.Push(i->oldOctant_);
+
+        MarkFlatStorageDirty();
+    }
+
+    // Increase counts first, because drawable count going to zero deletes the octree branch in question
+    unsigned numDecreases = 0;
+    for (PODVector<Octant*>::Iterator i = movedOctants_.Begin(); i != movedOctants_.End(); ++i)
+    {
+        if ((*i)->ApplyCountIncrease())
+            movedOctants_[numDecreases++] = *i;
+    }
+    for (unsigned i = 0; i < numDecreases; ++i)
+        movedOctants_[i]->ApplyCountDecrease();
+
+    movedOctants_.Clear();
+    reinsertions_.Clear();
+}
+
 void Octree::AddManualDrawable(Drawable* drawable)
 {
     if (!drawable || drawable->GetOctant())
@@ -495,7 +841,12 @@ void Octree::RemoveManualDrawable(Drawable* drawable)
 void Octree::GetDrawables(OctreeQuery& query) const
 {
     query.result_.Clear();
-    GetDrawablesInternal(query, false);
+
+    // The flat storage is up to date only if no drawables have changed since the last update
+    if (flatCulling_ && !flatStorageDirty_ && drawableUpdates_.Empty())
+        GetDrawablesFlat(query);
+    else
+        GetDrawablesInternal(query, false);
 }
 
 void Octree::Raycast(RayOctreeQuery& query) const
@@ -547,6 +898,71 @@ void Octree::RaycastSingle(RayOctreeQuery& query) const
     }
 }
 
+void Octree::RaycastSingleBatch(RayBatchOctreeQuery& query) const
+{
+    URHO3D_PROFILE(RaycastBatch);
+
+    unsigned numRays = query.rays_.Size();
+    query.result_.Resize(numRays);
+    if (!numRays)
+        return;
+
+    auto* queue = GetSubsystem<WorkQueue>();
+    if (queue && Thread::IsMainThread())
+    {
+        // The packets read world transforms and bounding boxes, which update lazily when dirty, also through shared
+        // parent nodes and bones. Bring them up to date first, so that the worker threads only read them
+        {
+            URHO3D_PROFILE(UpdateRaycastBatchTransforms);
+
+            Scene* scene = GetScene();
+            if (scene)
+            {
+                scene->UpdateTransforms();
+                UpdateWorldTransforms(scene);
+            }
+            UpdateWorldBoundingBoxesInternal();
+        }
+
+        rayBatchHits_.Resize(queue->GetNumThreads() + 1);
+        queue->ParallelFor(0, numRays, RAY_PACKET_SIZE, [this, &query](unsigned start, unsigned end, unsigned threadIndex)
+        {
+            RaycastBatchRange(query, start, end, rayBatchHits_[threadIndex]);
+        });
+    }
+    else
+    {
+        PODVector<RayQueryResult> hits;
+        RaycastBatchRange(query, 0, numRays, hits);
+    }
+}
+
+void Octree::RaycastBatchRange(RayBatchOctreeQuery& query, unsigned start, unsigned end, PODVector<RayQueryResult>& hits) const
+{
+    RayQueryPacket packet;
+    packet.query_ = &query;
+    packet.hits_ = &hits;
+
+    for (packet.start_ = start; packet.start_ < end; packet.start_ += RAY_PACKET_SIZE)
+    {
+        packet.numRays_ = Min(end - packet.start_, RAY_PACKET_SIZE);
+
+        for (unsigned i = 0; i < packet.numRays_; ++i)
+        {
+            unsigned index = packet.start_ + i;
+            packet.maxDistances_[i] = query.maxDistances_ ? (*query.maxDistances_)[index] : query.maxDistance_;
+            packet.viewMasks_[i] = query.viewMasks_ ? (*query.viewMasks_)[index] : query.viewMask_;
+
+            RayQueryResult& result = query.result_[index];
+            result = RayQueryResult();
+            result.distance_ = M_INFINITY;
+        }
+
+        unsigned rayMask = packet.numRays_ < 32 ? (1u << packet.numRays_) - 1 : M_MAX_UNSIGNED;
+        RaycastPacketInternal(packet, rayMask);
+    }
+}
+
 void Octree::QueueUpdate(Drawable* drawable)
 {
     Scene* scene = GetScene();
@@ -575,6 +991,74 @@ void Octree::DrawDebugGeometry(bool depthTest)
     DrawDebugGeometry(debug, depthTest);
 }
 
+void Octree::UpdateFlatStorage()
+{
+    if (flatStorageDirty_)
+    {
+        URHO3D_PROFILE(BuildFlatOctree);
+
+        flatNodes_.Clear();
+        flatDrawables_.Clear();
+        flatBoxes_.Clear();
+        FlattenInternal(flatNodes_, flatDrawables_, flatBoxes_);
+        flatStorageDirty_ = false;
+        return;
+    }
+
+    // No structural changes, so only the bounding boxes of updated drawables may have changed
+    for (PODVector<Drawable*>::ConstIterator i = drawableUpdates_.Begin(); i != drawableUpdates_.End(); ++i)
+    {
+        Drawable* drawable = *i;
+        unsigned flatIndex = drawable->flatIndex_;
+        if (flatIndex < flatDrawables_.Size() && flatDrawables_[flatIndex] == drawable)
+        {
+            SetGroupBox(flatBoxes_[flatIndex / DRAWABLE_BOX_GROUP_SIZE], flatIndex % DRAWABLE_BOX_GROUP_SIZE,
+                drawable->GetWorldBoundingBox());
+        }
+    }
+}
+
+void Octree::GetDrawablesFlat(OctreeQuery& query) const
+{
+    auto** drawables = const_cast<Drawable**>(flatDrawables_.Begin().ptr_);
+    const DrawableBoxGroup* boxes = flatBoxes_.Begin().ptr_;
+    unsigned numNodes = flatNodes_.Size();
+    // Octants before this index are inside the query volume as a whole
+    unsigned insideEnd = 0;
+    unsigned i = 0;
+
+    while (i < numNodes)
+    {
+        const OctreeFlatNode& node = flatNodes_[i];
+        bool inside = i < insideEnd;
+
+        // The root octant is not tested, as drawables outside the octree bounds are inserted to it
+        if (i)
+        {
+            Intersection res = query.TestOctant(node.cullingBox_, inside);
+            if (res == OUTSIDE)
+            {
+                // Fully outside, so skip the octant's whole subtree
+                i = node.subtreeEnd_;
+                continue;
+            }
+            else if (res == INSIDE && !inside)
+            {
+                insideEnd = node.subtreeEnd_;
+                inside = true;
+            }
+        }
+
+        if (node.drawableStart_ != node.drawableEnd_)
+        {
+            query.TestDrawableBoxes(drawables + node.drawableStart_, drawables + node.drawableEnd_,
+                boxes + node.drawableStart_ / DRAWABLE_BOX_GROUP_SIZE, inside);
+        }
+
+        ++i;
+    }
+}
+
 void Octree::HandleRenderUpdate(StringHash eventType, VariantMap& eventData)
 {
     // When running in headless mode, update the Octree manually during the RenderUpdate event
@@ -31,10 +31,37 @@ namespace Urho3D
 {
 
 class Octree;
+struct RayQueryPacket;
 
 static const int NUM_OCTANTS = 8;
 static const unsigned ROOT_INDEX = M_MAX_UNSIGNED;
 
+/// %Octant in the flat culling storage of an octree. Octants are stored depth-first, so that the subtree of an octant follows it.
+struct OctreeFlatNode
+{
+    /// Bounding box used for culling.
+    BoundingBox cullingBox_;
+    /// Index of the first drawable.
+    unsigned drawableStart_;
+    /// Index one past the last drawable, padded to a whole number of box groups.
+    unsigned drawableEnd_;
+    /// Index one past the last octant of the subtree.
+    unsigned subtreeEnd_;
+};
+
+/// Reinsertion of a drawable computed by threaded octree reinsertion.
+struct OctreeReinsertion
+{
+    /// Drawable object.
+    Drawable* drawable_;
+    /// Octant the drawable is in.
+    Octant* oldOctant_;
+    /// Octant to move the drawable to, or null if it does not need to move.
+    Octant* newOctant_;
+    /// Whether the new octant is the final one. If false, its child octants need to be created first.
+    bool final_;
+};
+
 /// %Octree octant
 class URHO3D_API Octant
 {
@@ -54,6 +81,8 @@ public:
     void InsertDrawable(Drawable* drawable);
     /// Check if a drawable object fits.
     bool CheckDrawableFit(const BoundingBox& box) const;
+    /// Return the octant a drawable object would be inserted to, starting from this octant. If not creating child octants and the octant does not exist yet, return its deepest existing ancestor and set final to false.
+    Octant* FindInsertionOctant(Drawable* drawable, bool createChildren, bool& final);
 
     /// Add a drawable object to this octant.
     void AddDrawable(Drawable* drawable)
@@ -63,6 +92,28 @@ public:
         IncDrawableCount();
     }
 
+    /// Add a drawable object moving from another octant and defer the drawable count update, called internally. Return true if the octant needs to be queued for the count update.
+    bool AddMovingDrawable(Drawable* drawable)
+    {
+        drawable->SetOctant(this);
+        drawables_.Push(drawable);
+        ++drawableCountChange_;
+        return QueueCountChange();
+    }
+
+    /// Remove a drawable object moving to another octant and defer the drawable count update, called internally. Return true if the octant needs to be queued for the count update.
+    bool RemoveMovingDrawable(Drawable* drawable)
+    {
+        drawables_.Remove(drawable);
+        --drawableCountChange_;
+        return QueueCountChange();
+    }
+
+    /// Apply a deferred drawable count increase, called internally. Return true if the count decreases instead, which must be applied with ApplyCountDecrease() after all increases.
+    bool ApplyCountIncrease();
+    /// Apply a deferred drawable count decrease, called internally. May delete the octant.
+    void ApplyCountDecrease();
+
     /// Remove a drawable object from this octant.
     void RemoveDrawable(Drawable* drawable, bool resetOctant = true)
     {
@@ -101,29 +152,44 @@ public:
     void DrawDebugGeometry(DebugRenderer* debug, bool depthTest);
 
 protected:
-    /// Initialize bounding box.
-    void Initialize(const BoundingBox& box);
+    /// Initialize bounding box and the culling box enlarged by the octree looseness.
+    void Initialize(const BoundingBox& box, float looseness);
     /// Return drawable objects by a query, called internally.
     void GetDrawablesInternal(OctreeQuery& query, bool inside) const;
     /// Return drawable objects by a ray query, called internally.
     void GetDrawablesInternal(RayOctreeQuery& query) const;
     /// Return drawable objects only for a threaded ray query, called internally.
     void GetDrawablesOnlyInternal(RayOctreeQuery& query, PODVector<Drawable*>& drawables) const;
+    /// Return the closest hits for a packet of rays of a batched ray query, called internally.
+    void RaycastPacketInternal(RayQueryPacket& packet, unsigned rayMask) const;
+    /// Update the world bounding boxes of the drawable objects recursively before a threaded query, called internally.
+    void UpdateWorldBoundingBoxesInternal() const;
+    /// Append this octant and its children to flat culling storage, called internally.
+    void FlattenInternal(PODVector<OctreeFlatNode>& nodes, PODVector<Drawable*>& drawables, PODVector<DrawableBoxGroup>& boxes) const;
 
     /// Increase drawable object count recursively.
-    void IncDrawableCount()
+    void IncDrawableCount(unsigned count = 1)
     {
-        ++numDrawables_;
+        numDrawables_ += count;
         if (parent_)
-            parent_->IncDrawableCount();
+            parent_->IncDrawableCount(count);
+    }
+
+    /// Mark the octant queued for a deferred drawable count change. Return true if it was not queued yet.
+    bool QueueCountChange()
+    {
+        if (countChangeQueued_)
+            return false;
+        countChangeQueued_ = true;
+        return true;
     }
 
     /// Decrease drawable object count recursively and remove octant if it becomes empty.
-    void DecDrawableCount()
+    void DecDrawableCount(unsigned count = 1)
     {
         Octant* parent = parent_;
 
-        --numDrawables_;
+        numDrawables_ -= count;
         if (!numDrawables_)
         {
             if (parent)
@@ -131,7 +197,7 @@ protected:
         }
 
         if (parent)
-            parent->DecDrawableCount();
+            parent->DecDrawableCount(count);
     }
 
     /// World bounding box.
@@ -150,6 +216,10 @@ protected:
     unsigned level_;
     /// Number of drawable objects in this octant and child octants.
     unsigned numDrawables_{};
+    /// Deferred drawable count change during threaded reinsertion.
+    int drawableCountChange_{};
+    /// Whether the octant is queued for a deferred drawable count change.
+    bool countChangeQueued_{};
     /// Parent octant.
     Octant* parent_;
     /// Octree root.
@@ -189,14 +259,33 @@ public:
     void Raycast(RayOctreeQuery& query) const;
     /// Return the closest drawable object by a ray query.
     void RaycastSingle(RayOctreeQuery& query) const;
+    /// Return the closest drawable object for each ray of a batched ray query. The rays are traversed in packets, which are split between worker threads when called from the main thread.
+    void RaycastSingleBatch(RayBatchOctreeQuery& query) const;
 
     /// Return subdivision levels.
     unsigned GetNumLevels() const { return numLevels_; }
 
+    /// Set looseness, the size of the octant culling boxes relative to the octants (2-4.) Larger values let moving drawables stay in their octants longer at the cost of less precise culling. If octree is not empty, drawable objects will be temporarily moved to the root.
+    void SetLooseness(float looseness);
+    /// Return looseness.
+    float GetLooseness() const { return looseness_; }
+
+    /// Set whether to compute the reinsertion target octants of moved drawable objects in worker threads and apply them in per-octant batches.
+    void SetThreadedReinsertion(bool enable) { threadedReinsertion_ = enable; }
+    /// Return whether threaded reinsertion is used.
+    bool GetThreadedReinsertion() const { return threadedReinsertion_; }
+
+    /// Set whether to also keep the octants and drawable bounding boxes in flat arrays for faster culling. The arrays are rebuilt on Update() when drawables have been inserted, moved between octants or removed.
+    void SetFlatCulling(bool enable);
+    /// Return whether flat culling storage is used.
+    bool GetFlatCulling() const { return flatCulling_; }
+
     /// Mark drawable object as requiring an update and a reinsertion.
     void QueueUpdate(Drawable* drawable);
     /// Cancel drawable object's update.
     void CancelUpdate(Drawable* drawable);
+    /// Mark the flat culling storage as needing a rebuild. Called internally when drawables are inserted, moved between octants or removed.
+    void MarkFlatStorageDirty() { flatStorageDirty_ = true; }
     /// Visualize the component as debug geometry.
     void DrawDebugGeometry(bool depthTest);
 
@@ -205,6 +294,16 @@ private:
     void HandleRenderUpdate(StringHash eventType, VariantMap& eventData);
     /// Update octree size.
     void UpdateOctreeSize() { SetSize(worldBoundingBox_, numLevels_); }
+    /// Reinsert the updated drawable objects one by one from the main thread.
+    void ReinsertDrawables();
+    /// Compute the reinsertion target octants in worker threads and apply them in per-octant batches.
+    void ReinsertDrawablesThreaded();
+    /// Rebuild the flat culling storage, or update the bounding boxes of the drawables that were updated if there were no structural changes.
+    void UpdateFlatStorage();
+    /// Return drawable objects by a query from the flat culling storage.
+    void GetDrawablesFlat(OctreeQuery& query) const;
+    /// Perform the raycasts of a range of rays of a batched ray query in packets.
+    void RaycastBatchRange(RayBatchOctreeQuery& query, unsigned start, unsigned end, PODVector<RayQueryResult>& hits) const;
 
     /// Drawable objects that require update.
     PODVector<Drawable*> drawableUpdates_;
@@ -214,8 +313,28 @@ private:
     Mutex octreeMutex_;
     /// Ray query temporary list of drawables.
     mutable PODVector<Drawable*> rayQueryDrawables_;
+    /// Batched ray query temporary hit lists per thread.
+    mutable Vector<PODVector<RayQueryResult> > rayBatchHits_;
     /// Subdivision level.
     unsigned numLevels_;
+    /// Culling box size relative to octant size.
+    float looseness_;
+    /// Threaded reinsertion enabled flag.
+    bool threadedReinsertion_;
+    /// Reinsertions computed by threaded reinsertion.
+    PODVector<OctreeReinsertion> reinsertions_;
+    /// Octants whose drawable counts need updating during threaded reinsertion.
+    PODVector<Octant*> movedOctants_;
+    /// Flat culling enabled flag.
+    bool flatCulling_;
+    /// Flat culling storage needs rebuild flag.
+    bool flatStorageDirty_;
+    /// Octants in depth-first order for flat culling.
+    PODVector<OctreeFlatNode> flatNodes_;
+    /// Drawables of the octants in depth-first order, each octant's padded with null pointers to a whole number of box groups.
+    PODVector<Drawable*> flatDrawables_;
+    /// Bounding boxes of the flat culling drawables.
+    PODVector<DrawableBoxGroup> flatBoxes_;
 };
 
 }
@@ -24,11 +24,25 @@
 
 #include "../Graphics/OctreeQuery.h"
 
+#ifdef URHO3D_SSE
+#include <xmmintrin.h>
+#endif
+
 #include "../DebugNew.h"
 
 namespace Urho3D
 {
 
+void OctreeQuery::TestDrawableBoxes(Drawable** start, Drawable** end, const DrawableBoxGroup* boxes, bool inside)
+{
+    // Skip the padding
+    while (end != start && !end[-1])
+        --end;
+
+    if (start != end)
+        TestDrawables(start, end, inside);
+}
+
 Intersection PointOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
 {
     if (inside)
@@ -117,6 +131,100 @@ void FrustumOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool in
     }
 }
 
+void FrustumOctreeQuery::TestDrawableBoxes(Drawable** start, Drawable** end, const DrawableBoxGroup* boxes, bool inside)
+{
+    if (inside)
+    {
+        OctreeQuery::TestDrawableBoxes(start, end, boxes, inside);
+        return;
+    }
+
+#ifdef URHO3D_SSE
+    __m128 normalX[NUM_FRUSTUM_PLANES];
+    __m128 normalY[NUM_FRUSTUM_PLANES];
+    __m128 normalZ[NUM_FRUSTUM_PLANES];
+    __m128 absNormalX[NUM_FRUSTUM_PLANES];
+    __m128 absNormalY[NUM_FRUSTUM_PLANES];
+    __m128 absNormalZ[NUM_FRUSTUM_PLANES];
+    __m128 planeD[NUM_FRUSTUM_PLANES];
+
+    for (unsigned i = 0; i < NUM_FRUSTUM_PLANES; ++i)
+    {
+        const Plane& plane = frustum_.planes_[i];
+        normalX[i] = _mm_set1_ps(plane.normal_.x_);
+        normalY[i] = _mm_set1_ps(plane.normal_.y_);
+        normalZ[i] = _mm_set1_ps(plane.normal_.z_);
+        absNormalX[i] = _mm_set1_ps(plane.absNormal_.x_);
+        absNormalY[i] = _mm_set1_ps(plane.absNormal_.y_);
+        absNormalZ[i] = _mm_set1_ps(plane.absNormal_.z_);
+        planeD[i] = _mm_set1_ps(plane.d_);
+    }
+#endif
+
+    for (; start != end; start += DRAWABLE_BOX_GROUP_SIZE, ++boxes)
+    {
+        // Find the boxes of the group which are not outside any plane, as in Frustum::IsInsideFast()
+#ifdef URHO3D_SSE
+        __m128 centerX = _mm_loadu_ps(boxes->centerX_);
+        __m128 centerY = _mm_loadu_ps(boxes->centerY_);
+        __m128 centerZ = _mm_loadu_ps(boxes->centerZ_);
+        __m128 halfSizeX = _mm_loadu_ps(boxes->halfSizeX_);
+        __m128 halfSizeY = _mm_loadu_ps(boxes->halfSizeY_);
+        __m128 halfSizeZ = _mm_loadu_ps(boxes->halfSizeZ_);
+        __m128 outside = _mm_setzero_ps();
+
+        for (unsigned i = 0; i < NUM_FRUSTUM_PLANES; ++i)
+        {
+            __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX[i], centerX), _mm_mul_ps(normalY[i], centerY)),
+                _mm_add_ps(_mm_mul_ps(normalZ[i], centerZ), planeD[i]));
+            __m128 absDist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absNormalX[i], halfSizeX), _mm_mul_ps(absNormalY[i], halfSizeY)),
+                _mm_mul_ps(absNormalZ[i], halfSizeZ));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, _mm_sub_ps(_mm_setzero_ps(), absDist)));
+        }
+
+        unsigned insideMask = ~(unsigned)_mm_movemask_ps(outside);
+#else
+        unsigned insideMask = 0;
+        for (unsigned j = 0; j < DRAWABLE_BOX_GROUP_SIZE; ++j)
+        {
+            Vector3 center(boxes->centerX_[j], boxes->centerY_[j], boxes->centerZ_[j]);
+            Vector3 halfSize(boxes->halfSizeX_[j], boxes->halfSizeY_[j], boxes->halfSizeZ_[j]);
+            bool outside = false;
+
+            for (const auto& plane : frustum_.planes_)
+            {
+                if (plane.normal_.DotProduct(center) + plane.d_ < -plane.absNormal_.DotProduct(halfSize))
+                {
+                    outside = true;
+                    break;
+                }
+            }
+
+            if (!outside)
+                insideMask |= 1u << j;
+        }
+#endif
+
+        // Pass runs of drawables inside the frustum to TestDrawables() for the remaining checks, which subclasses may extend
+        unsigned j = 0;
+        while (j < DRAWABLE_BOX_GROUP_SIZE)
+        {
+            if (!(insideMask & (1u << j)) || !start[j])
+            {
+                ++j;
+                continue;
+            }
+
+            unsigned runEnd = j + 1;
+            while (runEnd < DRAWABLE_BOX_GROUP_SIZE && (insideMask & (1u << runEnd)) && start[runEnd])
+                ++runEnd;
+
+            TestDrawables(start + j, start + runEnd, true);
+            j = runEnd;
+        }
+    }
+}
+
 
 Intersection AllContentOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
 {
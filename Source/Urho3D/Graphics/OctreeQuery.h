@@ -36,6 +36,26 @@ namespace Urho3D
 class Drawable;
 class Node;
 
+/// Number of drawable bounding boxes in a box group.
+static const unsigned DRAWABLE_BOX_GROUP_SIZE = 4;
+
+/// Bounding boxes of drawables in structure of arrays form, for testing them in one batch.
+struct DrawableBoxGroup
+{
+    /// Bounding box center X coordinates.
+    float centerX_[DRAWABLE_BOX_GROUP_SIZE];
+    /// Bounding box center Y coordinates.
+    float centerY_[DRAWABLE_BOX_GROUP_SIZE];
+    /// Bounding box center Z coordinates.
+    float centerZ_[DRAWABLE_BOX_GROUP_SIZE];
+    /// Bounding box half size X components.
+    float halfSizeX_[DRAWABLE_BOX_GROUP_SIZE];
+    /// Bounding box half size Y components.
+    float halfSizeY_[DRAWABLE_BOX_GROUP_SIZE];
+    /// Bounding box half size Z components.
+    float halfSizeZ_[DRAWABLE_BOX_GROUP_SIZE];
+};
+
 /// Base class for octree queries.
 class URHO3D_API OctreeQuery
 {
@@ -60,6 +80,8 @@ public:
     virtual Intersection TestOctant(const BoundingBox& box, bool inside) = 0;
     /// Intersection test for drawables.
     virtual void TestDrawables(Drawable** start, Drawable** end, bool inside) = 0;
+    /// Intersection test for drawables with bounding boxes in groups, one group per DRAWABLE_BOX_GROUP_SIZE drawables. The drawable range is padded with null pointers to a whole number of groups. By default calls TestDrawables().
+    virtual void TestDrawableBoxes(Drawable** start, Drawable** end, const DrawableBoxGroup* boxes, bool inside);
 
     /// Result vector reference.
     PODVector<Drawable*>& result_;
@@ -148,6 +170,8 @@ public:
     Intersection TestOctant(const BoundingBox& box, bool inside) override;
     /// Intersection test for drawables.
     void TestDrawables(Drawable** start, Drawable** end, bool inside) override;
+    /// Intersection test for drawables with bounding boxes in groups. Tests a whole group against the frustum at once, then calls TestDrawables() for the drawables inside.
+    void TestDrawableBoxes(Drawable** start, Drawable** end, const DrawableBoxGroup* boxes, bool inside) override;
 
     /// Frustum.
     Frustum frustum_;
@@ -254,6 +278,47 @@ public:
     RayQueryLevel level_;
 };
 
+/// Batched raycast octree query, which returns the closest hit for each of a number of rays.
+class URHO3D_API RayBatchOctreeQuery
+{
+public:
+    /// Construct with rays and query parameters. Per-ray maximum distances and view masks can be set afterward.
+    RayBatchOctreeQuery(PODVector<RayQueryResult>& result, const PODVector<Ray>& rays, RayQueryLevel level = RAY_TRIANGLE,
+        float maxDistance = M_INFINITY, unsigned char drawableFlags = DRAWABLE_ANY, unsigned viewMask = DEFAULT_VIEWMASK) :
+        result_(result),
+        rays_(rays),
+        maxDistances_(nullptr),
+        viewMasks_(nullptr),
+        drawableFlags_(drawableFlags),
+        viewMask_(viewMask),
+        maxDistance_(maxDistance),
+        level_(level)
+    {
+    }
+
+    /// Prevent copy construction.
+    RayBatchOctreeQuery(const RayBatchOctreeQuery& rhs) = delete;
+    /// Prevent assignment.
+    RayBatchOctreeQuery& operator =(const RayBatchOctreeQuery& rhs) = delete;
+
+    /// Result vector reference. Resized to the number of rays, with a null drawable and infinite distance for rays that hit nothing.
+    PODVector<RayQueryResult>& result_;
+    /// Rays.
+    const PODVector<Ray>& rays_;
+    /// Optional per-ray maximum distances. Null to use the common maximum distance.
+    const PODVector<float>* maxDistances_;
+    /// Optional per-ray view masks. Null to use the common view mask.
+    const PODVector<unsigned>* viewMasks_;
+    /// Drawable flags to include.
+    unsigned char drawableFlags_;
+    /// Drawable layers to include.
+    unsigned viewMask_;
+    /// Maximum ray distance.
+    float maxDistance_;
+    /// Raycast detail level.
+    RayQueryLevel level_;
+};
+
 class URHO3D_API AllContentOctreeQuery : public OctreeQuery
 {
 public:
@@ -55,6 +55,11 @@
 namespace Urho3D
 {
 
+/// Minimum number of drawables per work chunk when checking visibility.
+static const unsigned DRAWABLES_PER_VISIBILITY_CHUNK = 32;
+/// Minimum number of drawables per work chunk when updating geometries.
+static const unsigned DRAWABLES_PER_GEOMETRY_UPDATE_CHUNK = 16;
+
 /// %Frustum octree query for shadowcasters.
 class ShadowCasterOctreeQuery : public FrustumOctreeQuery
 {
@@ -157,11 +162,8 @@ public:
     OcclusionBuffer* buffer_;
 };
 
-void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex)
+void CheckVisibility(View* view, Drawable** start, Drawable** end, unsigned threadIndex)
 {
-    auto* view = reinterpret_cast<View*>(item->aux_);
-    auto** start = reinterpret_cast<Drawable**>(item->start_);
-    auto** end = reinterpret_cast<Drawable**>(item->end_);
     OcclusionBuffer* buffer = view->occlusionBuffer_;
     const Matrix3x4& viewMatrix = view->cullCamera_->GetView();
     Vector3 viewZ = Vector3(viewMatrix.m20_, viewMatrix.m21_, viewMatrix.m22_);
@@ -234,12 +236,8 @@ void ProcessLightWork(const WorkItem* item, unsigned threadIndex)
     view->ProcessLight(*query, threadIndex);
 }
 
-void UpdateDrawableGeometriesWork(const WorkItem* item, unsigned threadIndex)
+void UpdateDrawableGeometries(const FrameInfo& frame, Drawable** start, Drawable** end)
 {
-    const FrameInfo& frame = *(reinterpret_cast<FrameInfo*>(item->aux_));
-    auto** start = reinterpret_cast<Drawable**>(item->start_);
-    auto** end = reinterpret_cast<Drawable**>(item->end_);
-
     while (start != end)
     {
         Drawable* drawable = *start++;
@@ -886,30 +884,12 @@ void View::GetDrawables()
             result.maxZ_ = 0.0f;
         }
 
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = tempDrawables.Size() / numWorkItems;
-
-        PODVector<Drawable*>::Iterator start = tempDrawables.Begin();
-        // Create a work item for each thread
-        for (int i = 0; i < numWorkItems; ++i)
+        // Visibility check cost varies a lot between drawables, so let the work queue balance the chunks between threads
+        queue->ParallelFor(0, tempDrawables.Size(), DRAWABLES_PER_VISIBILITY_CHUNK,
+            [this, &tempDrawables](unsigned start, unsigned end, unsigned threadIndex)
         {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = CheckVisibilityWork;
-            item->aux_ = this;
-
-            PODVector<Drawable*>::Iterator end = tempDrawables.End();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
-
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
-
-            start = end;
-        }
-
-        queue->Complete(M_MAX_UNSIGNED);
+            CheckVisibility(this, &tempDrawables[start], &tempDrawables[0] + end, threadIndex);
+        });
     }
 
     // Combine lights, geometries & scene Z range from the threads
@@ -974,6 +954,9 @@ void View::ProcessLights()
     auto* queue = GetSubsystem<WorkQueue>();
     lightQueryResults_.Resize(lights_.Size());
 
+    SharedPtr<WorkItem> joinItem = queue->GetFreeItem();
+    joinItem->priority_ = M_MAX_UNSIGNED;
+
     for (unsigned i = 0; i < lightQueryResults_.Size(); ++i)
     {
         SharedPtr<WorkItem> item = queue->GetFreeItem();
@@ -985,11 +968,13 @@ void View::ProcessLights()
         query.light_ = lights_[i];
 
         item->start_ = &query;
+        queue->AddDependency(joinItem, item);
         queue->AddWorkItem(item);
     }
 
     // Ensure all lights have been processed before proceeding
-    queue->Complete(M_MAX_UNSIGNED);
+    queue->AddWorkItem(joinItem);
+    queue->WaitFor(joinItem);
 }
 
 void View::GetLightBatches()
@@ -1336,26 +1321,12 @@ void View::UpdateGeometries()
                 }
             }
 
-            int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-            int drawablesPerItem = threadedGeometries_.Size() / numWorkItems;
-
-            PODVector<Drawable*>::Iterator start = threadedGeometries_.Begin();
-            for (int i = 0; i < numWorkItems; ++i)
+            // Skinned and static geometries differ in cost, so let the work queue balance the chunks between threads
+            queue->AddParallelFor(0, threadedGeometries_.Size(), DRAWABLES_PER_GEOMETRY_UPDATE_CHUNK,
+                [this](unsigned start, unsigned end, unsigned threadIndex)
             {
-                PODVector<Drawable*>::Iterator end = threadedGeometries_.End();
-                if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                    end = start + drawablesPerItem;
-
-                SharedPtr<WorkItem> item = queue->GetFreeItem();
-                item->priority_ = M_MAX_UNSIGNED;
-                item->workFunction_ = UpdateDrawableGeometriesWork;
-                item->aux_ = const_cast<FrameInfo*>(&frame_);
-                item->start_ = &(*start);
-                item->end_ = &(*end);
-                queue->AddWorkItem(item);
-
-                start = end;
-            }
+                UpdateDrawableGeometries(frame_, &threadedGeometries_[start], &threadedGeometries_[0] + end);
+            });
         }
 
         // While the work queue is processed, update non-threaded geometries
@@ -2267,6 +2238,8 @@ void View::DrawOccluders(OcclusionBuffer* buffer, const PODVector<Drawable*>& oc
 
 void View::ProcessLight(LightQueryResult& query, unsigned threadIndex)
 {
+    URHO3D_PROFILE(ProcessLight);
+
     Light* light = query.light_;
     LightType type = light->GetLightType();
     unsigned lightMask = light->GetLightMask();
@@ -2899,7 +2872,7 @@ void View::AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, boo
     {
         BatchGroupKey key(batch);
 
-        HashMap<BatchGroupKey, BatchGroup>::Iterator i = queue.batchGroups_.Find(key);
+        FlatHashMap<BatchGroupKey, BatchGroup>::Iterator i = queue.batchGroups_.Find(key);
         if (i == queue.batchGroups_.End())
         {
             // Create a new group based on the batch
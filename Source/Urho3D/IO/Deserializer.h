@@ -50,6 +50,8 @@ public:
     virtual unsigned GetChecksum();
     /// Return whether the end of stream has been reached.
     virtual bool IsEof() const { return position_ >= size_; }
+    /// Return a pointer to the next bytes and advance past them if the stream holds them contiguously in memory, or null otherwise. The data stays valid while the stream is open and unmodified.
+    virtual const void* ReadSpan(unsigned size) { return nullptr; }
 
     /// Set position relative to current position. Return actual new position.
     unsigned SeekRelative(int delta);
@@ -63,7 +63,7 @@ static const char* openMode[] =
 const char* APK = "/apk/";
 static const unsigned READ_BUFFER_SIZE = 32768;
 #endif
-static const unsigned SKIP_BUFFER_SIZE = 1024;
+static const unsigned DEFAULT_BLOCK_CACHE_SIZE = 4;
 
 File::File(Context* context) :
     Object(context),
@@ -72,8 +72,18 @@ File::File(Context* context) :
 #ifdef __ANDROID__
     assetHandle_(0),
 #endif
+    mappingPosition_(0),
     readBufferOffset_(0),
     readBufferSize_(0),
+    blockSize_(0),
+    numBlocks_(0),
+    blockIndexOffset_(0),
+    blockDataOffset_(0),
+    currentBlock_(M_MAX_UNSIGNED),
+    currentSlot_(0),
+    nextBlock_(M_MAX_UNSIGNED),
+    blockUseCount_(0),
+    blockCacheSize_(DEFAULT_BLOCK_CACHE_SIZE),
     offset_(0),
     checksum_(0),
     compressed_(false),
@@ -89,8 +99,18 @@ File::File(Context* context, const String& fileName, FileMode mode) :
 #ifdef __ANDROID__
     assetHandle_(0),
 #endif
+    mappingPosition_(0),
     readBufferOffset_(0),
     readBufferSize_(0),
+    blockSize_(0),
+    numBlocks_(0),
+    blockIndexOffset_(0),
+    blockDataOffset_(0),
+    currentBlock_(M_MAX_UNSIGNED),
+    currentSlot_(0),
+    nextBlock_(M_MAX_UNSIGNED),
+    blockUseCount_(0),
+    blockCacheSize_(DEFAULT_BLOCK_CACHE_SIZE),
     offset_(0),
     checksum_(0),
     compressed_(false),
@@ -107,8 +127,18 @@ File::File(Context* context, PackageFile* package, const String& fileName) :
 #ifdef __ANDROID__
     assetHandle_(0),
 #endif
+    mappingPosition_(0),
     readBufferOffset_(0),
     readBufferSize_(0),
+    blockSize_(0),
+    numBlocks_(0),
+    blockIndexOffset_(0),
+    blockDataOffset_(0),
+    currentBlock_(M_MAX_UNSIGNED),
+    currentSlot_(0),
+    nextBlock_(M_MAX_UNSIGNED),
+    blockUseCount_(0),
+    blockCacheSize_(DEFAULT_BLOCK_CACHE_SIZE),
     offset_(0),
     checksum_(0),
     compressed_(false),
@@ -137,8 +167,18 @@ bool File::Open(PackageFile* package, const String& fileName)
     if (!entry)
         return false;
 
-    bool success = OpenInternal(package->GetName(), FILE_READ, true);
-    if (!success)
+    MemoryMappedFile* mapping = package->GetMapping();
+    if (mapping)
+    {
+        // Read from the package's memory mapping without opening a file handle
+        Close();
+        mapping_ = mapping;
+        mode_ = FILE_READ;
+        position_ = 0;
+        readSyncNeeded_ = false;
+        writeSyncNeeded_ = false;
+    }
+    else if (!OpenInternal(package->GetName(), FILE_READ, true))
     {
         URHO3D_LOGERROR("Could not open package file " + fileName);
         return false;
@@ -152,6 +192,28 @@ bool File::Open(PackageFile* package, const String& fileName)
 
     // Seek to beginning of package entry's file data
     SeekInternal(offset_);
+    blockDataOffset_ = offset_;
+    nextBlock_ = 0;
+
+    if (compressed_ && package->HasBlockIndex())
+    {
+        // The compressed data begins with the block size and the block offsets
+        unsigned char indexHeaderBytes[8];
+        if (!ReadInternal(indexHeaderBytes, sizeof indexHeaderBytes))
+        {
+            URHO3D_LOGERROR("Could not read block index of package file " + fileName);
+            Close();
+            return false;
+        }
+
+        MemoryBuffer indexHeader(&indexHeaderBytes[0], sizeof indexHeaderBytes);
+        blockSize_ = indexHeader.ReadUInt();
+        numBlocks_ = indexHeader.ReadUInt();
+        blockIndexOffset_ = offset_ + sizeof indexHeaderBytes;
+        blockDataOffset_ = blockIndexOffset_ + numBlocks_ * sizeof(unsigned);
+        SeekInternal(blockDataOffset_);
+    }
+
     return true;
 }
 
@@ -174,6 +236,13 @@ unsigned File::Read(void* dest, unsigned size)
     if (!size)
         return 0;
 
+    if (mapping_ && !compressed_)
+    {
+        memcpy(dest, mapping_->GetData() + offset_ + position_, size);
+        position_ += size;
+        return size;
+    }
+
 #ifdef __ANDROID__
     if (assetHandle_ && !compressed_)
     {
@@ -216,31 +285,12 @@ unsigned File::Read(void* dest, unsigned size)
 
         while (sizeLeft)
         {
-            if (!readBuffer_ || readBufferOffset_ >= readBufferSize_)
-            {
-                unsigned char blockHeaderBytes[4];
-                ReadInternal(blockHeaderBytes, sizeof blockHeaderBytes);
-
-                MemoryBuffer blockHeader(&blockHeaderBytes[0], sizeof blockHeaderBytes);
-                unsigned unpackedSize = blockHeader.ReadUShort();
-                unsigned packedSize = blockHeader.ReadUShort();
-
-                if (!readBuffer_)
-                {
-                    readBuffer_ = new unsigned char[unpackedSize];
-                    inputBuffer_ = new unsigned char[LZ4_compressBound(unpackedSize)];
-                }
-
-                /// \todo Handle errors
-                ReadInternal(inputBuffer_.Get(), packedSize);
-                LZ4_decompress_fast((const char*)inputBuffer_.Get(), (char*)readBuffer_.Get(), unpackedSize);
-
-                readBufferSize_ = unpackedSize;
-                readBufferOffset_ = 0;
-            }
+            // Move on to the next block. The block index wraps from M_MAX_UNSIGNED to 0 at the start
+            if (readBufferOffset_ >= readBufferSize_ && !LoadBlock(currentBlock_ + 1))
+                return size - sizeLeft;
 
             unsigned copySize = Min((readBufferSize_ - readBufferOffset_), sizeLeft);
-            memcpy(destPtr, readBuffer_.Get() + readBufferOffset_, copySize);
+            memcpy(destPtr, blockCache_[currentSlot_].data_.Buffer() + readBufferOffset_, copySize);
             destPtr += copySize;
             sizeLeft -= copySize;
             readBufferOffset_ += copySize;
@@ -284,24 +334,27 @@ unsigned File::Seek(unsigned position)
 
     if (compressed_)
     {
-        // Start over from the beginning
-        if (position == 0)
-        {
-            position_ = 0;
-            readBufferOffset_ = 0;
-            readBufferSize_ = 0;
-            SeekInternal(offset_);
-        }
-        // Skip bytes
-        else if (position >= position_)
+        if (position == position_)
+            return position_;
+
+        // At the end there is nothing to decompress
+        if (position >= size_)
         {
-            unsigned char skipBuffer[SKIP_BUFFER_SIZE];
-            while (position > position_)
-                Read(skipBuffer, Min(position - position_, SKIP_BUFFER_SIZE));
+            position_ = size_;
+            readBufferOffset_ = readBufferSize_;
+            return position_;
         }
-        else
-            URHO3D_LOGERROR("Seeking backward in a compressed file is not supported");
 
+        // Jump directly to the block containing the position. Its size is known from the block index or the first block
+        if (!blockSize_ && !LoadBlockIndex())
+            return position_;
+
+        unsigned block = position / blockSize_;
+        if (block != currentBlock_ && !LoadBlock(block))
+            return position_;
+
+        readBufferOffset_ = position - block * blockSize_;
+        position_ = position;
         return position_;
     }
 
@@ -312,6 +365,16 @@ unsigned File::Seek(unsigned position)
     return position_;
 }
 
+const void* File::ReadSpan(unsigned size)
+{
+    if (!mapping_ || compressed_ || size > size_ - position_)
+        return nullptr;
+
+    const unsigned char* data = mapping_->GetData() + offset_ + position_;
+    position_ += size;
+    return data;
+}
+
 unsigned File::Write(const void* data, unsigned size)
 {
     if (!IsOpen())
@@ -392,12 +455,27 @@ void File::Close()
 #endif
 
     readBuffer_.Reset();
-    inputBuffer_.Reset();
-
-    if (handle_)
+    inputBuffer_.Clear();
+    blockCache_.Clear();
+    blockOffsets_.Clear();
+    readBufferOffset_ = 0;
+    readBufferSize_ = 0;
+    blockSize_ = 0;
+    numBlocks_ = 0;
+    blockIndexOffset_ = 0;
+    blockDataOffset_ = 0;
+    currentBlock_ = M_MAX_UNSIGNED;
+    nextBlock_ = M_MAX_UNSIGNED;
+
+    if (handle_ || mapping_)
     {
-        fclose((FILE*)handle_);
-        handle_ = nullptr;
+        if (handle_)
+        {
+            fclose((FILE*)handle_);
+            handle_ = nullptr;
+        }
+        mapping_.Reset();
+        mappingPosition_ = 0;
         position_ = 0;
         size_ = 0;
         offset_ = 0;
@@ -416,12 +494,32 @@ void File::SetName(const String& name)
     fileName_ = name;
 }
 
+void File::SetBlockCacheSize(unsigned numBlocks)
+{
+    blockCacheSize_ = Max(numBlocks, 1U);
+
+    // Drop the least recently used blocks that no longer fit, keeping the current block
+    while (blockCache_.Size() > blockCacheSize_)
+    {
+        unsigned oldest = M_MAX_UNSIGNED;
+        for (unsigned i = 0; i < blockCache_.Size(); ++i)
+        {
+            if (blockCache_[i].index_ != currentBlock_ && (oldest == M_MAX_UNSIGNED || blockCache_[i].lastUse_ < blockCache_[oldest].lastUse_))
+                oldest = i;
+        }
+
+        blockCache_.Erase(oldest);
+        if (currentSlot_ > oldest)
+            --currentSlot_;
+    }
+}
+
 bool File::IsOpen() const
 {
 #ifdef __ANDROID__
-    return handle_ != 0 || assetHandle_ != 0;
+    return handle_ != 0 || assetHandle_ != 0 || mapping_;
 #else
-    return handle_ != nullptr;
+    return handle_ != nullptr || mapping_;
 #endif
 }
 
@@ -525,6 +623,15 @@ bool File::OpenInternal(const String& fileName, FileMode mode, bool fromPackage)
 
 bool File::ReadInternal(void* dest, unsigned size)
 {
+    if (mapping_)
+    {
+        if (mappingPosition_ + size > mapping_->GetSize())
+            return false;
+        memcpy(dest, mapping_->GetData() + mappingPosition_, size);
+        mappingPosition_ += size;
+        return true;
+    }
+
 #ifdef __ANDROID__
     if (assetHandle_)
     {
@@ -537,17 +644,200 @@ bool File::ReadInternal(void* dest, unsigned size)
 
 void File::SeekInternal(unsigned newPosition)
 {
+    if (mapping_)
+    {
+        mappingPosition_ = newPosition;
+        return;
+    }
+
 #ifdef __ANDROID__
     if (assetHandle_)
     {
         SDL_RWseek(assetHandle_, newPosition, SEEK_SET);
-        // Reset buffering after seek
-        readBufferOffset_ = 0;
-        readBufferSize_ = 0;
+        // Reset buffering after seek. Compressed files use the buffer state for the current block instead
+        if (!compressed_)
+        {
+            readBufferOffset_ = 0;
+            readBufferSize_ = 0;
+        }
     }
     else
 #endif
         fseek((FILE*)handle_, newPosition, SEEK_SET);
 }
 
+bool File::LoadBlock(unsigned block)
+{
+    // Use the decompressed block if it is still cached
+    for (unsigned i = 0; i < blockCache_.Size(); ++i)
+    {
+        if (blockCache_[i].index_ == block)
+        {
+            blockCache_[i].lastUse_ = ++blockUseCount_;
+            currentBlock_ = block;
+            currentSlot_ = i;
+            readBufferSize_ = blockCache_[i].data_.Size();
+            readBufferOffset_ = 0;
+            return true;
+        }
+    }
+
+    // Unless reading on sequentially, look up where the block starts
+    if (block != nextBlock_)
+    {
+        unsigned blockOffset = blockDataOffset_;
+        if (block)
+        {
+            if (!LoadBlockIndex())
+                return false;
+            if (block >= blockOffsets_.Size())
+            {
+                URHO3D_LOGERROR("Compressed block index out of range in " + GetName());
+                return false;
+            }
+            blockOffset = blockOffsets_[block];
+        }
+
+        SeekInternal(blockOffset);
+        nextBlock_ = block;
+    }
+
+    unsigned char blockHeaderBytes[4];
+    if (!ReadInternal(blockHeaderBytes, sizeof blockHeaderBytes))
+    {
+        URHO3D_LOGERROR("Could not read compressed block header in " + GetName());
+        nextBlock_ = M_MAX_UNSIGNED;
+        return false;
+    }
+
+    MemoryBuffer blockHeader(&blockHeaderBytes[0], sizeof blockHeaderBytes);
+    unsigned unpackedSize = blockHeader.ReadUShort();
+    unsigned packedSize = blockHeader.ReadUShort();
+
+    // Take a free cache slot, or the least recently used one
+    unsigned slot = blockCache_.Size();
+    if (slot < blockCacheSize_)
+        blockCache_.Resize(slot + 1);
+    else
+    {
+        slot = 0;
+        for (unsigned i = 1; i < blockCache_.Size(); ++i)
+        {
+            if (blockCache_[i].lastUse_ < blockCache_[slot].lastUse_)
+                slot = i;
+        }
+    }
+
+    DecompressedBlock& cached = blockCache_[slot];
+    cached.index_ = M_MAX_UNSIGNED;
+    cached.data_.Resize(unpackedSize);
+
+    const unsigned char* packedData;
+    if (mapping_)
+    {
+        // Decompress straight from the mapping
+        if (mappingPosition_ + packedSize > mapping_->GetSize())
+        {
+            URHO3D_LOGERROR("Compressed block outside package file in " + GetName());
+            nextBlock_ = M_MAX_UNSIGNED;
+            return false;
+        }
+        packedData = mapping_->GetData() + mappingPosition_;
+        mappingPosition_ += packedSize;
+    }
+    else
+    {
+        inputBuffer_.Resize(packedSize);
+        if (!ReadInternal(inputBuffer_.Buffer(), packedSize))
+        {
+            URHO3D_LOGERROR("Could not read compressed block in " + GetName());
+            nextBlock_ = M_MAX_UNSIGNED;
+            return false;
+        }
+        packedData = inputBuffer_.Buffer();
+    }
+
+    if (LZ4_decompress_safe((const char*)packedData, (char*)cached.data_.Buffer(), packedSize, unpackedSize) != (int)unpackedSize)
+    {
+        URHO3D_LOGERROR("Corrupt compressed block in " + GetName());
+        nextBlock_ = M_MAX_UNSIGNED;
+        return false;
+    }
+
+    // All blocks but the last have the same size, so the first block tells it if there is no index
+    if (!blockSize_ && !block)
+        blockSize_ = unpackedSize;
+
+    cached.index_ = block;
+    cached.lastUse_ = ++blockUseCount_;
+    nextBlock_ = block + 1;
+    currentBlock_ = block;
+    currentSlot_ = slot;
+    readBufferSize_ = unpackedSize;
+    readBufferOffset_ = 0;
+    return true;
+}
+
+bool File::LoadBlockIndex()
+{
+    if (!blockOffsets_.Empty())
+        return true;
+
+    // The internal read position moves while reading the index
+    nextBlock_ = M_MAX_UNSIGNED;
+
+    if (blockIndexOffset_)
+    {
+        blockOffsets_.Resize(numBlocks_);
+        SeekInternal(blockIndexOffset_);
+        if (numBlocks_ && !ReadInternal(blockOffsets_.Buffer(), numBlocks_ * sizeof(unsigned)))
+        {
+            URHO3D_LOGERROR("Could not read block index in " + GetName());
+            blockOffsets_.Clear();
+            return false;
+        }
+
+        // Offsets are stored relative to the start of the file entry
+        for (unsigned i = 0; i < numBlocks_; ++i)
+            blockOffsets_[i] += offset_;
+    }
+    else
+    {
+        // Packages without an index: walk the block headers without decompressing
+        URHO3D_PROFILE(BuildBlockIndex);
+
+        unsigned blockOffset = blockDataOffset_;
+        unsigned unpackedTotal = 0;
+        while (unpackedTotal < size_)
+        {
+            unsigned char blockHeaderBytes[4];
+            SeekInternal(blockOffset);
+            if (!ReadInternal(blockHeaderBytes, sizeof blockHeaderBytes))
+            {
+                URHO3D_LOGERROR("Could not read compressed block header in " + GetName());
+                blockOffsets_.Clear();
+                return false;
+            }
+
+            MemoryBuffer blockHeader(&blockHeaderBytes[0], sizeof blockHeaderBytes);
+            unsigned unpackedSize = blockHeader.ReadUShort();
+            unsigned packedSize = blockHeader.ReadUShort();
+            if (!unpackedSize)
+            {
+                URHO3D_LOGERROR("Corrupt compressed block header in " + GetName());
+                blockOffsets_.Clear();
+                return false;
+            }
+
+            if (!blockSize_)
+                blockSize_ = unpackedSize;
+            blockOffsets_.Push(blockOffset);
+            unpackedTotal += unpackedSize;
+            blockOffset += sizeof blockHeaderBytes + packedSize;
+        }
+    }
+
+    return true;
+}
+
 }
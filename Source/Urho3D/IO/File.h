@@ -27,6 +27,7 @@
 #include "../Container/ArrayPtr.h"
 #include "../Core/Object.h"
 #include "../IO/AbstractFile.h"
+#include "../IO/MemoryMappedFile.h"
 
 #ifdef __ANDROID__
 struct SDL_RWops;
@@ -58,6 +59,17 @@ enum FileMode
 
 class PackageFile;
 
+/// Decompressed block of a compressed package file.
+struct DecompressedBlock
+{
+    /// Block index, M_MAX_UNSIGNED if unused.
+    unsigned index_;
+    /// Last use stamp.
+    unsigned lastUse_;
+    /// Decompressed data.
+    PODVector<unsigned char> data_;
+};
+
 /// %File opened either through the filesystem or from within a package file.
 class URHO3D_API File : public Object, public AbstractFile
 {
@@ -79,6 +91,8 @@ public:
     unsigned Seek(unsigned position) override;
     /// Write bytes to the file. Return number of bytes actually written.
     unsigned Write(const void* data, unsigned size) override;
+    /// Return a pointer to the next bytes and advance past them if the file reads from an uncompressed memory mapped package, or null otherwise.
+    const void* ReadSpan(unsigned size) override;
 
     /// Return the file name.
     const String& GetName() const override { return fileName_; }
@@ -96,6 +110,8 @@ public:
     void Flush();
     /// Change the file name. Used by the resource system.
     void SetName(const String& name);
+    /// Set how many decompressed blocks of a compressed package file to keep for seeking back. Default 4.
+    void SetBlockCacheSize(unsigned numBlocks);
 
     /// Return the open mode.
     FileMode GetMode() const { return mode_; }
@@ -109,6 +125,12 @@ public:
     /// Return whether the file originates from a package.
     bool IsPackaged() const { return offset_ != 0; }
 
+    /// Return whether the file reads from a memory mapped package.
+    bool IsMemoryMapped() const { return mapping_.NotNull(); }
+
+    /// Return how many decompressed blocks are kept for seeking back.
+    unsigned GetBlockCacheSize() const { return blockCacheSize_; }
+
 private:
     /// Open file internally using either C standard IO functions or SDL RWops for Android asset files. Return true if successful.
     bool OpenInternal(const String& fileName, FileMode mode, bool fromPackage = false);
@@ -116,6 +138,10 @@ private:
     bool ReadInternal(void* dest, unsigned size);
     /// Seek in file internally using either C standard IO functions or SDL RWops for Android asset files.
     void SeekInternal(unsigned newPosition);
+    /// Make a block of a compressed package file current, decompressing it unless cached. Return true if successful.
+    bool LoadBlock(unsigned block);
+    /// Read or build the block offsets of a compressed package file. Return true if successful.
+    bool LoadBlockIndex();
 
     /// File name.
     String fileName_;
@@ -127,14 +153,40 @@ private:
     /// SDL RWops context for Android asset loading.
     SDL_RWops* assetHandle_;
 #endif
-    /// Read buffer for Android asset or compressed file loading.
+    /// Memory mapping of the package file when reading from a memory mapped package.
+    SharedPtr<MemoryMappedFile> mapping_;
+    /// Read position within the memory mapping.
+    unsigned mappingPosition_;
+    /// Read buffer for Android asset loading.
     SharedArrayPtr<unsigned char> readBuffer_;
     /// Decompression input buffer for compressed file loading.
-    SharedArrayPtr<unsigned char> inputBuffer_;
+    PODVector<unsigned char> inputBuffer_;
+    /// Recently decompressed blocks for compressed file loading.
+    Vector<DecompressedBlock> blockCache_;
+    /// Package offsets of the compressed blocks. Filled on the first seek that needs them.
+    PODVector<unsigned> blockOffsets_;
     /// Read buffer position.
     unsigned readBufferOffset_;
     /// Bytes in the current read buffer.
     unsigned readBufferSize_;
+    /// Uncompressed size of a full compressed block, 0 if not known yet.
+    unsigned blockSize_;
+    /// Number of compressed blocks if known from the block index, otherwise 0.
+    unsigned numBlocks_;
+    /// Package offset of the block index, 0 if the package has none.
+    unsigned blockIndexOffset_;
+    /// Package offset of the first compressed block.
+    unsigned blockDataOffset_;
+    /// Index of the current compressed block, M_MAX_UNSIGNED if none.
+    unsigned currentBlock_;
+    /// Block cache slot of the current compressed block.
+    unsigned currentSlot_;
+    /// Index of the compressed block at the internal read position, M_MAX_UNSIGNED if not known.
+    unsigned nextBlock_;
+    /// Block cache use counter.
+    unsigned blockUseCount_;
+    /// Maximum number of cached decompressed blocks.
+    unsigned blockCacheSize_;
     /// Start position within a package file, 0 for regular files.
     unsigned offset_;
     /// Content checksum.
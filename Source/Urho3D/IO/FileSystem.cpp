@@ -283,7 +283,8 @@ private:
 };
 
 FileSystem::FileSystem(Context* context) :
-    Object(context)
+    Object(context),
+    programDir_(GetProgramDirInternal())
 {
     SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(FileSystem, HandleBeginFrame));
 
@@ -690,6 +691,11 @@ void FileSystem::ScanDir(Vector<String>& result, const String& pathName, const S
 }
 
 String FileSystem::GetProgramDir() const
+{
+    return programDir_;
+}
+
+String FileSystem::GetProgramDirInternal() const
 {
 #if defined(__ANDROID__)
     // This is an internal directory specifier pointing to the assets in the .apk
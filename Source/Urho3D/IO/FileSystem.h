@@ -108,6 +108,8 @@ private:
     /// Scan directory, called internally.
     void ScanDirInternal
         (Vector<String>& result, String path, const String& startPath, const String& filter, unsigned flags, bool recursive) const;
+    /// Return the program's directory from the operating system, called internally on construction.
+    String GetProgramDirInternal() const;
     /// Handle begin frame event to check for completed async executions.
     void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
     /// Handle a console command event.
@@ -119,6 +121,8 @@ private:
     List<AsyncExecRequest*> asyncExecQueue_;
     /// Next async execution ID.
     unsigned nextAsyncExecID_{1};
+    /// Program's directory, resolved once on construction.
+    String programDir_;
     /// Flag for executing engine console commands as OS-specific system command. Default to true.
     bool executeConsoleCommands_{};
 };
@@ -75,6 +75,16 @@ unsigned MemoryBuffer::Read(void* dest, unsigned size)
     return size;
 }
 
+const void* MemoryBuffer::ReadSpan(unsigned size)
+{
+    if (size > size_ - position_)
+        return nullptr;
+
+    const unsigned char* data = buffer_ + position_;
+    position_ += size;
+    return data;
+}
+
 unsigned MemoryBuffer::Seek(unsigned position)
 {
     if (position > size_)
@@ -46,6 +46,8 @@ public:
     unsigned Seek(unsigned position) override;
     /// Write bytes to the memory area.
     unsigned Write(const void* data, unsigned size) override;
+    /// Return a pointer to the next bytes in the memory area and advance past them, or null if not enough bytes remain.
+    const void* ReadSpan(unsigned size) override;
 
     /// Return memory area.
     unsigned char* GetData() { return buffer_; }
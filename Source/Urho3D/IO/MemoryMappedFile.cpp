@@ -0,0 +1,153 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../IO/File.h"
+#include "../IO/FileSystem.h"
+#include "../IO/Log.h"
+#include "../IO/MemoryMappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+MemoryMappedFile::MemoryMappedFile() :
+    data_(nullptr),
+    size_(0),
+    refs_(0)
+{
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    Close();
+}
+
+bool MemoryMappedFile::Open(const String& fileName)
+{
+    Close();
+
+#ifdef __ANDROID__
+    if (URHO3D_IS_ASSET(fileName))
+    {
+        URHO3D_LOGERRORF("Could not memory map Android asset file %s", fileName.CString());
+        return false;
+    }
+#endif
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(GetWideNativePath(fileName).CString(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        URHO3D_LOGERRORF("Could not open file %s for memory mapping", fileName.CString());
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart > M_MAX_UNSIGNED || !fileSize.QuadPart)
+    {
+        URHO3D_LOGERRORF("Could not memory map file %s which is empty or larger than 4GB", fileName.CString());
+        CloseHandle(file);
+        return false;
+    }
+
+    // The view keeps the mapping object alive, so both handles can be closed right away
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+    {
+        URHO3D_LOGERRORF("Could not memory map file %s", fileName.CString());
+        return false;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data)
+    {
+        URHO3D_LOGERRORF("Could not memory map file %s", fileName.CString());
+        return false;
+    }
+
+    size_ = (unsigned)fileSize.QuadPart;
+#else
+    int file = open(GetNativePath(fileName).CString(), O_RDONLY);
+    if (file < 0)
+    {
+        URHO3D_LOGERRORF("Could not open file %s for memory mapping", fileName.CString());
+        return false;
+    }
+
+    struct stat fileStat{};
+    if (fstat(file, &fileStat) || (unsigned long long)fileStat.st_size > M_MAX_UNSIGNED || !fileStat.st_size)
+    {
+        URHO3D_LOGERRORF("Could not memory map file %s which is empty or larger than 4GB", fileName.CString());
+        close(file);
+        return false;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    void* data = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED)
+    {
+        URHO3D_LOGERRORF("Could not memory map file %s", fileName.CString());
+        return false;
+    }
+
+    size_ = (unsigned)fileStat.st_size;
+#endif
+
+    data_ = static_cast<unsigned char*>(data);
+    fileName_ = fileName;
+    return true;
+}
+
+void MemoryMappedFile::Close()
+{
+    if (!data_)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+#else
+    munmap(data_, size_);
+#endif
+
+    data_ = nullptr;
+    size_ = 0;
+    fileName_.Clear();
+}
+
+}
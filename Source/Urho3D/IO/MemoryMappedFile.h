@@ -0,0 +1,86 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/Str.h"
+
+#include <atomic>
+
+namespace Urho3D
+{
+
+/// Read-only memory mapping of a whole file. Reference counted atomically so that files read on worker threads can keep the mapping alive after its owner lets go of it. Use through SharedPtr; weak pointers are not supported.
+class URHO3D_API MemoryMappedFile
+{
+public:
+    /// Construct.
+    MemoryMappedFile();
+    /// Destruct. Unmap the file.
+    ~MemoryMappedFile();
+
+    /// Prevent copy construction.
+    MemoryMappedFile(const MemoryMappedFile& rhs) = delete;
+    /// Prevent assignment.
+    MemoryMappedFile& operator =(const MemoryMappedFile& rhs) = delete;
+
+    /// Map a file into memory. Return true if successful.
+    bool Open(const String& fileName);
+    /// Unmap the file.
+    void Close();
+    /// Increment reference count.
+    void AddRef() { refs_.fetch_add(1, std::memory_order_relaxed); }
+    /// Decrement reference count and delete self if no more references.
+    void ReleaseRef()
+    {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete this;
+    }
+
+    /// Return reference count.
+    int Refs() const { return refs_.load(std::memory_order_relaxed); }
+
+    /// Return the mapped contents, or null if not open.
+    const unsigned char* GetData() const { return data_; }
+
+    /// Return size of the mapped contents.
+    unsigned GetSize() const { return size_; }
+
+    /// Return the file name.
+    const String& GetName() const { return fileName_; }
+
+    /// Return whether a file is mapped.
+    bool IsOpen() const { return data_ != nullptr; }
+
+private:
+    /// Mapped contents.
+    unsigned char* data_;
+    /// Mapped size.
+    unsigned size_;
+    /// File name.
+    String fileName_;
+    /// Reference count.
+    std::atomic<int> refs_;
+};
+
+}
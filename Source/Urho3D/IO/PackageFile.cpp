@@ -34,7 +34,8 @@ PackageFile::PackageFile(Context* context) :
     totalSize_(0),
     totalDataSize_(0),
     checksum_(0),
-    compressed_(false)
+    compressed_(false),
+    blockIndex_(false)
 {
 }
 
@@ -43,7 +44,8 @@ PackageFile::PackageFile(Context* context, const String& fileName, unsigned star
     totalSize_(0),
     totalDataSize_(0),
     checksum_(0),
-    compressed_(false)
+    compressed_(false),
+    blockIndex_(false)
 {
     Open(fileName, startOffset);
 }
@@ -59,7 +61,7 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
     // Check ID, then read the directory
     file->Seek(startOffset);
     String id = file->ReadFileID();
-    if (id != "UPAK" && id != "ULZ4")
+    if (id != "UPAK" && id != "ULZ4" && id != "ULZI")
     {
         // If start offset has not been explicitly specified, also try to read package size from the end of file
         // to know how much we must rewind to find the package start
@@ -76,7 +78,7 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
             }
         }
 
-        if (id != "UPAK" && id != "ULZ4")
+        if (id != "UPAK" && id != "ULZ4" && id != "ULZI")
         {
             URHO3D_LOGERROR(fileName + " is not a valid package file");
             return false;
@@ -86,7 +88,8 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
     fileName_ = fileName;
     nameHash_ = fileName_;
     totalSize_ = file->GetSize();
-    compressed_ = id == "ULZ4";
+    compressed_ = id == "ULZ4" || id == "ULZI";
+    blockIndex_ = id == "ULZI";
 
     unsigned numFiles = file->ReadUInt();
     checksum_ = file->ReadUInt();
@@ -132,6 +135,38 @@ bool PackageFile::Exists(const String& fileName) const
     return found;
 }
 
+bool PackageFile::SetMemoryMapped(bool enable)
+{
+    if (!enable)
+    {
+        // Files still reading from the mapping hold a reference and keep it alive until they close
+        mapping_.Reset();
+        return true;
+    }
+
+    if (mapping_)
+        return true;
+
+    if (fileName_.Empty())
+    {
+        URHO3D_LOGERROR("Package file must be opened before memory mapping");
+        return false;
+    }
+
+    SharedPtr<MemoryMappedFile> mapping(new MemoryMappedFile());
+    if (!mapping->Open(fileName_))
+        return false;
+
+    if (mapping->GetSize() != totalSize_)
+    {
+        URHO3D_LOGERROR("Package file " + fileName_ + " changed size since it was opened, not memory mapping it");
+        return false;
+    }
+
+    mapping_ = mapping;
+    return true;
+}
+
 const PackageEntry* PackageFile::GetEntry(const String& fileName) const
 {
     HashMap<String, PackageEntry>::ConstIterator i = entries_.Find(fileName);
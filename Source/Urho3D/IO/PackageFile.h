@@ -23,6 +23,7 @@
 #pragma once
 
 #include "../Core/Object.h"
+#include "../IO/MemoryMappedFile.h"
 
 namespace Urho3D
 {
@@ -57,6 +58,8 @@ public:
     bool Exists(const String& fileName) const;
     /// Return the file entry corresponding to the name, or null if not found. This will be case-insensitive on Windows and case-sensitive on other platforms.
     const PackageEntry* GetEntry(const String& fileName) const;
+    /// Map the package file into memory or unmap it. Files opened from the package afterward read from the mapping instead of the file system. Return true if successful.
+    bool SetMemoryMapped(bool enable);
 
     /// Return all file entries.
     const HashMap<String, PackageEntry>& GetEntries() const { return entries_; }
@@ -82,9 +85,18 @@ public:
     /// Return whether the files are compressed.
     bool IsCompressed() const { return compressed_; }
 
+    /// Return whether each compressed file starts with an index of its blocks.
+    bool HasBlockIndex() const { return blockIndex_; }
+
     /// Return list of file names in the package.
     const Vector<String> GetEntryNames() const { return entries_.Keys(); }
 
+    /// Return whether the package file is mapped into memory.
+    bool IsMemoryMapped() const { return mapping_.NotNull(); }
+
+    /// Return the memory mapping of the package file, or null if not mapped.
+    MemoryMappedFile* GetMapping() const { return mapping_; }
+
 private:
     /// File entries.
     HashMap<String, PackageEntry> entries_;
@@ -100,6 +112,10 @@ private:
     unsigned checksum_;
     /// Compressed flag.
     bool compressed_;
+    /// Compressed block index flag.
+    bool blockIndex_;
+    /// Memory mapping of the package file.
+    SharedPtr<MemoryMappedFile> mapping_;
 };
 
 }
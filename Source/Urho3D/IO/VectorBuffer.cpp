@@ -60,6 +60,16 @@ unsigned VectorBuffer::Read(void* dest, unsigned size)
     return size;
 }
 
+const void* VectorBuffer::ReadSpan(unsigned size)
+{
+    if (size > size_ - position_)
+        return nullptr;
+
+    const unsigned char* data = buffer_.Buffer() + position_;
+    position_ += size;
+    return data;
+}
+
 unsigned VectorBuffer::Seek(unsigned position)
 {
     if (position > size_)
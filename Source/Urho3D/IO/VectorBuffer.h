@@ -46,6 +46,8 @@ public:
     unsigned Seek(unsigned position) override;
     /// Write bytes to the buffer. Return number of bytes actually written.
     unsigned Write(const void* data, unsigned size) override;
+    /// Return a pointer to the next bytes in the buffer and advance past them, or null if not enough bytes remain.
+    const void* ReadSpan(unsigned size) override;
 
     /// Set data from another buffer.
     void SetData(const PODVector<unsigned char>& data);
@@ -77,6 +77,8 @@ public:
     /// Return attribute descriptions, or null if none defined.
     const Vector<AttributeInfo>* GetAttributes() const override { return &attributeInfos_; }
 
+    /// Return false, as script object attributes are intercepted in OnSetAttribute() and OnGetAttribute().
+    bool AllowDirectAttributeAccess() const override { return false; }
     /// Apply attribute changes that can not be applied immediately. Called after scene load or a network update.
     void ApplyAttributes() override;
     /// Handle enabled/disabled state change.
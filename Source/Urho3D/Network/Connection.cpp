@@ -1169,6 +1169,9 @@ void Connection::ProcessNode(unsigned nodeID)
 
 void Connection::ProcessNewNode(Node* node)
 {
+    // Attribute values are encoded once per network update and shared with other connections
+    ReplicationSnapshot* snapshot = &scene_->GetReplicationSnapshot();
+
     // Process depended upon nodes first, if they are dirty
     const PODVector<Node*>& dependencyNodes = node->GetDependencyNodes();
     for (PODVector<Node*>::ConstIterator i = dependencyNodes.Begin(); i != dependencyNodes.End(); ++i)
@@ -1188,7 +1191,7 @@ void Connection::ProcessNewNode(Node* node)
     node->AddReplicationState(&nodeState);
 
     // Write node's attributes
-    node->WriteInitialDeltaUpdate(msg_, timeStamp_);
+    node->WriteInitialDeltaUpdate(msg_, timeStamp_, snapshot);
 
     // Write node's user variables
     const VariantMap& vars = node->GetVars();
@@ -1217,7 +1220,7 @@ void Connection::ProcessNewNode(Node* node)
 
         msg_.WriteStringHash(component->GetType());
         msg_.WriteNetID(component->GetID());
-        component->WriteInitialDeltaUpdate(msg_, timeStamp_);
+        component->WriteInitialDeltaUpdate(msg_, timeStamp_, snapshot);
     }
 
     SendMessage(MSG_CREATENODE, true, true, msg_);
@@ -1228,6 +1231,8 @@ void Connection::ProcessNewNode(Node* node)
 
 void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState)
 {
+    ReplicationSnapshot* snapshot = &scene_->GetReplicationSnapshot();
+
     // Process depended upon nodes first, if they are dirty
     const PODVector<Node*>& dependencyNodes = node->GetDependencyNodes();
     for (PODVector<Node*>::ConstIterator i = dependencyNodes.Begin(); i != dependencyNodes.End(); ++i)
@@ -1238,8 +1243,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
     }
 
     // Check from the interest management component, if exists, whether should update
-    /// \todo Searching for the component is a potential CPU hotspot. It should be cached
-    auto* priority = node->GetComponent<NetworkPriority>();
+    auto* priority = scene_->GetNodeComponent<NetworkPriority>(node);
     if (priority && (!priority->GetAlwaysUpdateOwner() || node->GetOwner() != this))
     {
         float distance = (node->GetWorldPosition() - position_).Length();
@@ -1268,7 +1272,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
         {
             msg_.Clear();
             msg_.WriteNetID(node->GetID());
-            node->WriteLatestDataUpdate(msg_, timeStamp_);
+            node->WriteLatestDataUpdate(msg_, timeStamp_, snapshot);
 
             SendMessage(MSG_NODELATESTDATA, true, false, msg_, node->GetID());
         }
@@ -1278,7 +1282,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
         {
             msg_.Clear();
             msg_.WriteNetID(node->GetID());
-            node->WriteDeltaUpdate(msg_, nodeState.dirtyAttributes_, timeStamp_);
+            node->WriteDeltaUpdate(msg_, nodeState.dirtyAttributes_, timeStamp_, snapshot);
 
             // Write changed variables
             msg_.WriteVLE(nodeState.dirtyVars_.Size());
@@ -1346,7 +1350,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 {
                     msg_.Clear();
                     msg_.WriteNetID(component->GetID());
-                    component->WriteLatestDataUpdate(msg_, timeStamp_);
+                    component->WriteLatestDataUpdate(msg_, timeStamp_, snapshot);
 
                     SendMessage(MSG_COMPONENTLATESTDATA, true, false, msg_, component->GetID());
                 }
@@ -1356,7 +1360,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 {
                     msg_.Clear();
                     msg_.WriteNetID(component->GetID());
-                    component->WriteDeltaUpdate(msg_, componentState.dirtyAttributes_, timeStamp_);
+                    component->WriteDeltaUpdate(msg_, componentState.dirtyAttributes_, timeStamp_, snapshot);
 
                     SendMessage(MSG_COMPONENTDELTAUPDATE, true, true, msg_);
 
@@ -1391,7 +1395,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 msg_.WriteNetID(node->GetID());
                 msg_.WriteStringHash(component->GetType());
                 msg_.WriteNetID(component->GetID());
-                component->WriteInitialDeltaUpdate(msg_, timeStamp_);
+                component->WriteInitialDeltaUpdate(msg_, timeStamp_, snapshot);
 
                 SendMessage(MSG_CREATECOMPONENT, true, true, msg_);
             }
@@ -27,6 +27,8 @@
 namespace Urho3D
 {
 
+class Component;
+
 /// Physics world is about to be stepped.
 URHO3D_EVENT(E_PHYSICSPRESTEP, PhysicsPreStep)
 {
@@ -41,6 +43,17 @@ URHO3D_EVENT(E_PHYSICSPOSTSTEP, PhysicsPostStep)
     URHO3D_PARAM(P_TIMESTEP, TimeStep);            // float
 }
 
+/// Typed payload of the physics pre-step and post-step events.
+struct PhysicsStepPayload
+{
+    URHO3D_EVENT_PAYLOAD(PhysicsStepPayload)
+
+    /// PhysicsWorld or PhysicsWorld2D.
+    Component* world_;
+    /// Timestep.
+    float timeStep_;
+};
+
 /// Physics collision started. Global event sent by the PhysicsWorld.
 URHO3D_EVENT(E_PHYSICSCOLLISIONSTART, PhysicsCollisionStart)
 {
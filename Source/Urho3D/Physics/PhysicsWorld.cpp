@@ -25,6 +25,8 @@
 #include "../Core/Context.h"
 #include "../Core/Mutex.h"
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/DebugRenderer.h"
 #include "../Graphics/Model.h"
 #include "../IO/Log.h"
@@ -58,6 +60,8 @@ extern const char* SUBSYSTEM_CATEGORY;
 
 static const int MAX_SOLVER_ITERATIONS = 256;
 static const Vector3 DEFAULT_GRAVITY = Vector3(0.0f, -9.81f, 0.0f);
+/// Maximum number of rays traversed together through the broadphase in a batched raycast.
+static const unsigned RAY_PACKET_SIZE = 32;
 
 PhysicsWorldConfig PhysicsWorld::config;
 
@@ -66,6 +70,90 @@ static bool CompareRaycastResults(const PhysicsRaycastResult& lhs, const Physics
     return lhs.distance_ < rhs.distance_;
 }
 
+/// Rays of a batched raycast traversed together through the broadphase trees.
+struct PhysicsRayPacket
+{
+    /// Number of rays.
+    unsigned numRays_;
+    /// Ray start points.
+    btVector3 from_[RAY_PACKET_SIZE];
+    /// Ray end points.
+    btVector3 to_[RAY_PACKET_SIZE];
+    /// Inverse ray directions.
+    btVector3 directionInverse_[RAY_PACKET_SIZE];
+    /// Ray direction signs.
+    unsigned signs_[RAY_PACKET_SIZE][3];
+    /// Ray lengths.
+    btScalar length_[RAY_PACKET_SIZE];
+    /// Collision masks.
+    short collisionMask_[RAY_PACKET_SIZE];
+    /// Closest hit fractions so far.
+    btScalar closestHitFraction_[RAY_PACKET_SIZE];
+    /// Closest hit objects so far.
+    const btCollisionObject* closestObject_[RAY_PACKET_SIZE];
+    /// Closest hit points.
+    btVector3 hitPoint_[RAY_PACKET_SIZE];
+    /// Closest hit normals.
+    btVector3 hitNormal_[RAY_PACKET_SIZE];
+};
+
+static void RaycastPacket(PhysicsRayPacket& packet, const btDbvtNode* node, unsigned mask)
+{
+    // Drop the rays that miss the node, or hit it beyond their closest hit so far
+    btVector3 bounds[2] = { node->volume.Mins(), node->volume.Maxs() };
+    for (unsigned i = 0; i < packet.numRays_; ++i)
+    {
+        if (!(mask & (1u << i)))
+            continue;
+
+        btScalar tMin = 1.0f;
+        if (!btRayAabb2(packet.from_[i], packet.directionInverse_[i], packet.signs_[i], bounds, tMin, 0.0f,
+            packet.length_[i] * packet.closestHitFraction_[i]))
+            mask &= ~(1u << i);
+    }
+
+    if (!mask)
+        return;
+
+    if (node->isinternal())
+    {
+        RaycastPacket(packet, node->childs[0], mask);
+        RaycastPacket(packet, node->childs[1], mask);
+        return;
+    }
+
+    auto* proxy = static_cast<btBroadphaseProxy*>(node->data);
+    auto* collisionObject = static_cast<btCollisionObject*>(proxy->m_clientObject);
+    btTransform fromTrans = btTransform::getIdentity();
+    btTransform toTrans = btTransform::getIdentity();
+
+    for (unsigned i = 0; i < packet.numRays_; ++i)
+    {
+        if (!(mask & (1u << i)))
+            continue;
+
+        btCollisionWorld::ClosestRayResultCallback rayCallback(packet.from_[i], packet.to_[i]);
+        rayCallback.m_collisionFilterGroup = (short)0xffff;
+        rayCallback.m_collisionFilterMask = packet.collisionMask_[i];
+        rayCallback.m_closestHitFraction = packet.closestHitFraction_[i];
+        if (!rayCallback.needsCollision(proxy))
+            continue;
+
+        fromTrans.setOrigin(packet.from_[i]);
+        toTrans.setOrigin(packet.to_[i]);
+        btCollisionWorld::rayTestSingle(fromTrans, toTrans, collisionObject, collisionObject->getCollisionShape(),
+            collisionObject->getWorldTransform(), rayCallback);
+
+        if (rayCallback.hasHit())
+        {
+            packet.closestHitFraction_[i] = rayCallback.m_closestHitFraction;
+            packet.closestObject_[i] = rayCallback.m_collisionObject;
+            packet.hitPoint_[i] = rayCallback.m_hitPointWorld;
+            packet.hitNormal_[i] = rayCallback.m_hitNormalWorld;
+        }
+    }
+}
+
 void InternalPreTickCallback(btDynamicsWorld* world, btScalar timeStep)
 {
     static_cast<PhysicsWorld*>(world->getWorldUserInfo())->PreStep(timeStep);
@@ -429,6 +517,33 @@ void PhysicsWorld::RaycastSingle(PhysicsRaycastResult& result, const Ray& ray, f
     }
 }
 
+void PhysicsWorld::RaycastSingleBatch(PODVector<PhysicsRaycastResult>& result, const PODVector<Ray>& rays, float maxDistance,
+    unsigned collisionMask, const PODVector<float>* maxDistances, const PODVector<unsigned>* collisionMasks)
+{
+    URHO3D_PROFILE(PhysicsRaycastSingleBatch);
+
+    if (!maxDistances && maxDistance >= M_INFINITY)
+        URHO3D_LOGWARNING("Infinite maxDistance in physics raycast is not supported");
+
+    result.Resize(rays.Size());
+    if (rays.Empty())
+        return;
+
+    // The broadphase's own ray test shares one traversal stack, so walk its trees directly. Collision shapes are only read,
+    // so the rays can be split between worker threads
+    auto* queue = GetSubsystem<WorkQueue>();
+    if (queue && Thread::IsMainThread())
+    {
+        queue->ParallelFor(0, rays.Size(), RAY_PACKET_SIZE,
+            [&](unsigned start, unsigned end, unsigned threadIndex)
+        {
+            RaycastBatchRange(result, rays, maxDistance, collisionMask, maxDistances, collisionMasks, start, end);
+        });
+    }
+    else
+        RaycastBatchRange(result, rays, maxDistance, collisionMask, maxDistances, collisionMasks, 0, rays.Size());
+}
+
 void PhysicsWorld::RaycastSingleSegmented(PhysicsRaycastResult& result, const Ray& ray, float maxDistance, float segmentDistance, unsigned collisionMask, float overlapDistance)
 {
     URHO3D_PROFILE(PhysicsRaycastSingleSegmented);
@@ -481,6 +596,68 @@ void PhysicsWorld::RaycastSingleSegmented(PhysicsRaycastResult& result, const Ra
     result.body_ = nullptr;
 }
 
+void PhysicsWorld::RaycastBatchRange(PODVector<PhysicsRaycastResult>& result, const PODVector<Ray>& rays, float maxDistance,
+    unsigned collisionMask, const PODVector<float>* maxDistances, const PODVector<unsigned>* collisionMasks, unsigned start,
+    unsigned end) const
+{
+    auto* broadphase = static_cast<btDbvtBroadphase*>(broadphase_.Get());
+    PhysicsRayPacket packet;
+
+    for (unsigned packetStart = start; packetStart < end; packetStart += RAY_PACKET_SIZE)
+    {
+        packet.numRays_ = Min(end - packetStart, RAY_PACKET_SIZE);
+
+        for (unsigned i = 0; i < packet.numRays_; ++i)
+        {
+            const Ray& ray = rays[packetStart + i];
+            float distance = maxDistances ? (*maxDistances)[packetStart + i] : maxDistance;
+            btVector3 direction = ToBtVector3(ray.direction_);
+
+            packet.from_[i] = ToBtVector3(ray.origin_);
+            packet.to_[i] = ToBtVector3(ray.origin_ + distance * ray.direction_);
+            packet.directionInverse_[i].setValue(
+                direction.x() == 0.0f ? BT_LARGE_FLOAT : 1.0f / direction.x(),
+                direction.y() == 0.0f ? BT_LARGE_FLOAT : 1.0f / direction.y(),
+                direction.z() == 0.0f ? BT_LARGE_FLOAT : 1.0f / direction.z());
+            packet.signs_[i][0] = packet.directionInverse_[i].x() < 0.0f;
+            packet.signs_[i][1] = packet.directionInverse_[i].y() < 0.0f;
+            packet.signs_[i][2] = packet.directionInverse_[i].z() < 0.0f;
+            packet.length_[i] = distance;
+            packet.collisionMask_[i] = (short)(collisionMasks ? (*collisionMasks)[packetStart + i] : collisionMask);
+            packet.closestHitFraction_[i] = 1.0f;
+            packet.closestObject_[i] = nullptr;
+        }
+
+        unsigned mask = packet.numRays_ < 32 ? (1u << packet.numRays_) - 1 : M_MAX_UNSIGNED;
+        for (auto& set : broadphase->m_sets)
+        {
+            if (set.m_root)
+                RaycastPacket(packet, set.m_root, mask);
+        }
+
+        for (unsigned i = 0; i < packet.numRays_; ++i)
+        {
+            PhysicsRaycastResult& rayResult = result[packetStart + i];
+            if (packet.closestObject_[i])
+            {
+                rayResult.position_ = ToVector3(packet.hitPoint_[i]);
+                rayResult.normal_ = ToVector3(packet.hitNormal_[i]);
+                rayResult.distance_ = (rayResult.position_ - rays[packetStart + i].origin_).Length();
+                rayResult.hitFraction_ = packet.closestHitFraction_[i];
+                rayResult.body_ = static_cast<RigidBody*>(packet.closestObject_[i]->getUserPointer());
+            }
+            else
+            {
+                rayResult.position_ = Vector3::ZERO;
+                rayResult.normal_ = Vector3::ZERO;
+                rayResult.distance_ = M_INFINITY;
+                rayResult.hitFraction_ = 0.0f;
+                rayResult.body_ = nullptr;
+            }
+        }
+    }
+}
+
 void PhysicsWorld::SphereCast(PhysicsRaycastResult& result, const Ray& ray, float radius, float maxDistance, unsigned collisionMask)
 {
     URHO3D_PROFILE(PhysicsSphereCast);
@@ -838,7 +1015,12 @@ void PhysicsWorld::PreStep(float timeStep)
     VariantMap& eventData = GetEventDataMap();
     eventData[P_WORLD] = this;
     eventData[P_TIMESTEP] = timeStep;
-    SendEvent(E_PHYSICSPRESTEP, eventData);
+    SendTypedEvent(E_PHYSICSPRESTEP, PhysicsStepPayload{this, timeStep}, eventData);
+
+    // Apply batched transform changes made by the handlers, so that the rigid bodies are stepped from their current transforms
+    Scene* scene = GetScene();
+    if (scene)
+        scene->UpdateTransforms();
 
     // Start profiling block for the actual simulation step
 #ifdef URHO3D_PROFILING
@@ -864,7 +1046,7 @@ void PhysicsWorld::PostStep(float timeStep)
     VariantMap& eventData = GetEventDataMap();
     eventData[P_WORLD] = this;
     eventData[P_TIMESTEP] = timeStep;
-    SendEvent(E_PHYSICSPOSTSTEP, eventData);
+    SendTypedEvent(E_PHYSICSPOSTSTEP, PhysicsStepPayload{this, timeStep}, eventData);
 }
 
 void PhysicsWorld::SendCollisionEvents()
@@ -188,6 +188,10 @@ public:
         (PODVector<PhysicsRaycastResult>& result, const Ray& ray, float maxDistance, unsigned collisionMask = M_MAX_UNSIGNED);
     /// Perform a physics world raycast and return the closest hit.
     void RaycastSingle(PhysicsRaycastResult& result, const Ray& ray, float maxDistance, unsigned collisionMask = M_MAX_UNSIGNED);
+    /// Perform physics world raycasts for a batch of rays and return the closest hit of each. The result vector is resized to the number of rays. Optional per-ray maximum distances and collision masks override the common ones. The rays are split between worker threads when called from the main thread.
+    void RaycastSingleBatch(PODVector<PhysicsRaycastResult>& result, const PODVector<Ray>& rays, float maxDistance,
+        unsigned collisionMask = M_MAX_UNSIGNED, const PODVector<float>* maxDistances = nullptr,
+        const PODVector<unsigned>* collisionMasks = nullptr);
     /// Perform a physics world segmented raycast and return the closest hit. Useful for big scenes with many bodies.
     /// overlapDistance is used to make sure there are no gap between segments, and must be smaller than segmentDistance.
     void RaycastSingleSegmented(PhysicsRaycastResult& result, const Ray& ray, float maxDistance, float segmentDistance, unsigned collisionMask = M_MAX_UNSIGNED, float overlapDistance = 0.1f);
@@ -301,6 +305,10 @@ private:
     void PostStep(float timeStep);
     /// Send accumulated collision events.
     void SendCollisionEvents();
+    /// Perform the batched raycasts of a range of rays in packets.
+    void RaycastBatchRange(PODVector<PhysicsRaycastResult>& result, const PODVector<Ray>& rays, float maxDistance,
+        unsigned collisionMask, const PODVector<float>* maxDistances, const PODVector<unsigned>* collisionMasks, unsigned start,
+        unsigned end) const;
 
     /// Bullet collision configuration.
     btCollisionConfiguration* collisionConfiguration_{};
@@ -24,104 +24,221 @@
 
 #include "../Precompiled.h"
 
+#include "../Core/Condition.h"
 #include "../Core/Context.h"
+#include "../Core/ProcessUtils.h"
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
 #include "../IO/Log.h"
 #include "../Resource/BackgroundLoader.h"
 #include "../Resource/ResourceCache.h"
 #include "../Resource/ResourceEvents.h"
 
+#include <algorithm>
+
 #include "../DebugNew.h"
 
 namespace Urho3D
 {
 
+/// Loader thread managed by the background loader.
+class BackgroundLoadThread : public Thread, public RefCounted
+{
+public:
+    /// Construct.
+    BackgroundLoadThread(BackgroundLoader* owner, Context* context, unsigned index) :
+        owner_(owner),
+        context_(context),
+        index_(index),
+        idle_(false)
+    {
+    }
+
+    /// Load queued resources until stopped, sleeping while the queue is empty.
+    void ThreadFunction() override
+    {
+#ifdef URHO3D_PROFILING
+        auto* profiler = context_->GetSubsystem<Profiler>();
+        if (profiler)
+            profiler->SetThreadName("Background loader " + String(index_));
+#endif
+
+        while (shouldRun_)
+        {
+            // No resources to load found. The thread was marked idle, so the next queued resource wakes it
+            if (!owner_->LoadNextResource(this))
+                wakeup_.Wait();
+        }
+    }
+
+    /// Wake the thread if it is waiting for resources to load.
+    void Wake() { wakeup_.Set(); }
+
+    /// Stop the thread, waking it first if it is waiting. The thread finishes the resource it is loading.
+    void StopLoading()
+    {
+        shouldRun_ = false;
+        wakeup_.Set();
+        Stop();
+    }
+
+    /// Set whether the thread is waiting for resources to load. Called with the queue mutex held.
+    void SetIdle(bool enable) { idle_ = enable; }
+
+    /// Return whether the thread is waiting for resources to load. Called with the queue mutex held.
+    bool IsIdle() const { return idle_; }
+
+private:
+    /// Background loader.
+    BackgroundLoader* owner_;
+    /// Execution context.
+    Context* context_;
+    /// Thread index.
+    unsigned index_;
+    /// Condition set when a resource is queued for the idle thread or the thread is stopped.
+    Condition wakeup_;
+    /// Idle flag.
+    bool idle_;
+};
+
 BackgroundLoader::BackgroundLoader(ResourceCache* owner) :
-    owner_(owner)
+    owner_(owner),
+    numThreads_(Max(GetNumPhysicalCPUs(), 2U) - 1),
+    nextSequence_(0),
+    recordTimings_(false)
 {
 }
 
 BackgroundLoader::~BackgroundLoader()
 {
+    // Stop the threads first, without holding the mutex they may be waiting for
+    for (unsigned i = 0; i < threads_.Size(); ++i)
+        threads_[i]->StopLoading();
+    threads_.Clear();
+
     MutexLock lock(backgroundLoadMutex_);
 
+    pendingItems_.Clear();
     backgroundLoadQueue_.Clear();
 }
 
-void BackgroundLoader::ThreadFunction()
+void BackgroundLoader::SetNumThreads(unsigned numThreads)
 {
-    while (shouldRun_)
+    Vector<SharedPtr<BackgroundLoadThread> > stoppedThreads;
+
     {
-        backgroundLoadMutex_.Acquire();
+        MutexLock lock(backgroundLoadMutex_);
 
-        // Search for a queued resource that has not been loaded yet
-        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Begin();
-        while (i != backgroundLoadQueue_.End())
-        {
-            if (i->second_.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
-                break;
-            else
-                ++i;
-        }
+        numThreads_ = Max(numThreads, 1U);
 
-        if (i == backgroundLoadQueue_.End())
+        // If loading has not started yet, the threads are created on the first queued resource
+        if (threads_.Empty())
+            return;
+
+        StartThreads();
+        while (threads_.Size() > numThreads_)
         {
-            // No resources to load found
-            backgroundLoadMutex_.Release();
-            Time::Sleep(5);
+            stoppedThreads.Push(threads_.Back());
+            threads_.Pop();
         }
-        else
-        {
-            BackgroundLoadItem& item = i->second_;
-            Resource* resource = item.resource_;
-            // We can be sure that the item is not removed from the queue as long as it is in the
-            // "queued" or "loading" state
-            backgroundLoadMutex_.Release();
-
-            bool success = false;
-            SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
-            if (file)
-            {
-                resource->SetAsyncLoadState(ASYNC_LOADING);
-                success = resource->BeginLoad(*file);
-            }
+    }
 
-            // Process dependencies now
-            // Need to lock the queue again when manipulating other entries
-            Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
-            backgroundLoadMutex_.Acquire();
-            if (item.dependents_.Size())
-            {
-                for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependents_.Begin();
-                     i != item.dependents_.End(); ++i)
-                {
-                    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(*i);
-                    if (j != backgroundLoadQueue_.End())
-                        j->second_.dependencies_.Erase(key);
-                }
+    // The stopped threads finish the resource they are loading first
+    for (unsigned i = 0; i < stoppedThreads.Size(); ++i)
+        stoppedThreads[i]->StopLoading();
+}
 
-                item.dependents_.Clear();
-            }
+bool BackgroundLoader::LoadNextResource(BackgroundLoadThread* thread)
+{
+    backgroundLoadMutex_.Acquire();
 
-            resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
-            backgroundLoadMutex_.Release();
+    // Take the highest priority resource. Of equal priorities, take the one queued first
+    BackgroundLoadItem* next = nullptr;
+    while (!next && !pendingItems_.Empty())
+    {
+        BackgroundLoadPendingItem* heap = &pendingItems_[0];
+        std::pop_heap(heap, heap + pendingItems_.Size());
+        BackgroundLoadPendingItem entry = pendingItems_.Back();
+        pendingItems_.Pop();
+
+        // Skip entries left behind by a priority raise, or by a resource already loaded or requeued since
+        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(entry.key_);
+        if (i != backgroundLoadQueue_.End() && i->second_.priority_ == entry.priority_ &&
+            i->second_.sequence_ == entry.sequence_ && i->second_.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
+            next = &i->second_;
+    }
+
+    if (!next)
+    {
+        thread->SetIdle(true);
+        backgroundLoadMutex_.Release();
+        return false;
+    }
+
+    BackgroundLoadItem& item = *next;
+    Resource* resource = item.resource_;
+    // Mark the resource loading so that no other thread takes it. We can be sure that the item is not removed from
+    // the queue as long as it is in the "queued" or "loading" state
+    resource->SetAsyncLoadState(ASYNC_LOADING);
+    item.queueUSec_ = item.timer_.GetUSec(false);
+    backgroundLoadMutex_.Release();
+
+    bool success = false;
+    {
+#ifdef URHO3D_PROFILING
+        AutoProfileBlock profileBlock(owner_->GetSubsystem<Profiler>(), "BackgroundLoadResource");
+#endif
+
+        SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
+        if (file)
+            success = resource->BeginLoad(*file);
+    }
+
+    // Process dependencies now
+    // Need to lock the queue again when manipulating other entries
+    Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
+    backgroundLoadMutex_.Acquire();
+    if (item.dependents_.Size())
+    {
+        for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependents_.Begin();
+             i != item.dependents_.End(); ++i)
+        {
+            HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(*i);
+            if (j != backgroundLoadQueue_.End())
+                j->second_.dependencies_.Erase(key);
         }
+
+        item.dependents_.Clear();
     }
+
+    item.beginLoadEndUSec_ = item.timer_.GetUSec(false);
+    resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
+    backgroundLoadMutex_.Release();
+
+    return true;
 }
 
-bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller)
+bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller, unsigned priority)
 {
     StringHash nameHash(name);
     Pair<StringHash, StringHash> key = MakePair(type, nameHash);
 
     MutexLock lock(backgroundLoadMutex_);
 
-    // Check if already exists in the queue
-    if (backgroundLoadQueue_.Find(key) != backgroundLoadQueue_.End())
+    // Check if already exists in the queue. If it is now needed sooner, move it ahead
+    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(key);
+    if (i != backgroundLoadQueue_.End())
+    {
+        RaisePriority(i->second_, priority);
         return false;
+    }
 
     BackgroundLoadItem& item = backgroundLoadQueue_[key];
     item.sendEventOnFailure_ = sendEventOnFailure;
+    item.priority_ = priority;
+    item.sequence_ = nextSequence_++;
+    item.queueUSec_ = 0;
+    item.beginLoadEndUSec_ = 0;
 
     // Make sure the pointer is non-null and is a Resource subclass
     item.resource_ = DynamicCast<Resource>(owner_->GetContext()->CreateObject(type));
@@ -157,15 +274,19 @@ bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool s
             BackgroundLoadItem& callerItem = j->second_;
             item.dependents_.Insert(callerKey);
             callerItem.dependencies_.Insert(key);
+            // The caller can not finish before its dependencies, so they are loaded at least at its priority
+            item.priority_ = Max(item.priority_, callerItem.priority_);
         }
         else
             URHO3D_LOGWARNING("Resource " + caller->GetName() +
                        " requested for a background loaded resource but was not in the background load queue");
     }
 
-    // Start the background loader thread now
-    if (!IsStarted())
-        Run();
+    // Start the background loader threads now
+    if (threads_.Empty())
+        StartThreads();
+
+    PushPendingItem(item);
 
     return true;
 }
@@ -179,6 +300,8 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
     HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(key);
     if (i != backgroundLoadQueue_.End())
     {
+        // The resource is needed now, so load it and its dependencies before anything else
+        RaisePriority(i->second_, M_MAX_UNSIGNED);
         backgroundLoadMutex_.Release();
 
         {
@@ -217,7 +340,7 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
 
 void BackgroundLoader::FinishResources(int maxMs)
 {
-    if (IsStarted())
+    if (!threads_.Empty())
     {
         HiresTimer timer;
 
@@ -250,15 +373,81 @@ void BackgroundLoader::FinishResources(int maxMs)
     }
 }
 
+void BackgroundLoader::SetRecordTimings(bool enable)
+{
+    MutexLock lock(backgroundLoadMutex_);
+    recordTimings_ = enable;
+}
+
+void BackgroundLoader::ClearTimings()
+{
+    MutexLock lock(backgroundLoadMutex_);
+    timings_.Clear();
+}
+
 unsigned BackgroundLoader::GetNumQueuedResources() const
 {
     MutexLock lock(backgroundLoadMutex_);
     return backgroundLoadQueue_.Size();
 }
 
+Vector<BackgroundLoadTiming> BackgroundLoader::GetTimings() const
+{
+    MutexLock lock(backgroundLoadMutex_);
+    return timings_;
+}
+
+void BackgroundLoader::StartThreads()
+{
+    while (threads_.Size() < numThreads_)
+    {
+        SharedPtr<BackgroundLoadThread> thread(new BackgroundLoadThread(this, owner_->GetContext(), threads_.Size()));
+        thread->Run();
+        threads_.Push(thread);
+    }
+}
+
+void BackgroundLoader::RaisePriority(BackgroundLoadItem& item, unsigned priority)
+{
+    if (item.priority_ >= priority)
+        return;
+
+    item.priority_ = priority;
+    if (item.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
+        PushPendingItem(item);
+
+    for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependencies_.Begin(); i != item.dependencies_.End(); ++i)
+    {
+        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(*i);
+        if (j != backgroundLoadQueue_.End())
+            RaisePriority(j->second_, priority);
+    }
+}
+
+void BackgroundLoader::PushPendingItem(BackgroundLoadItem& item)
+{
+    Resource* resource = item.resource_;
+    pendingItems_.Push(BackgroundLoadPendingItem(MakePair(resource->GetType(), resource->GetNameHash()), item.priority_,
+        item.sequence_));
+    BackgroundLoadPendingItem* heap = &pendingItems_[0];
+    std::push_heap(heap, heap + pendingItems_.Size());
+
+    // Threads that are not idle check the heap again before waiting, so waking one idle thread is enough
+    for (unsigned i = 0; i < threads_.Size(); ++i)
+    {
+        if (threads_[i]->IsIdle())
+        {
+            threads_[i]->SetIdle(false);
+            threads_[i]->Wake();
+            break;
+        }
+    }
+}
+
 void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
 {
     Resource* resource = item.resource_;
+    long long endLoadStartUSec = item.timer_.GetUSec(false);
 
     bool success = resource->GetAsyncLoadState() == ASYNC_SUCCESS;
     // If BeginLoad() phase was successful, call EndLoad() and get the final success/failure result
@@ -281,6 +470,22 @@ void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
     }
     resource->SetAsyncLoadState(ASYNC_DONE);
 
+    if (recordTimings_)
+    {
+        BackgroundLoadTiming timing;
+        timing.type_ = resource->GetType();
+        timing.name_ = resource->GetName();
+        timing.priority_ = item.priority_;
+        timing.queueUSec_ = item.queueUSec_;
+        timing.beginLoadUSec_ = item.beginLoadEndUSec_ - item.queueUSec_;
+        timing.finishWaitUSec_ = endLoadStartUSec - item.beginLoadEndUSec_;
+        timing.endLoadUSec_ = item.timer_.GetUSec(false) - endLoadStartUSec;
+        timing.success_ = success;
+
+        MutexLock lock(backgroundLoadMutex_);
+        timings_.Push(timing);
+    }
+
     if (!success && item.sendEventOnFailure_)
     {
         using namespace LoadFailed;
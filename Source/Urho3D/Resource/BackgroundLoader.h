@@ -27,14 +27,15 @@
 #include "../Core/Mutex.h"
 #include "../Container/Ptr.h"
 #include "../Container/RefCounted.h"
-#include "../Core/Thread.h"
+#include "../Core/Timer.h"
 #include "../Math/StringHash.h"
+#include "../Resource/ResourceCache.h"
 
 namespace Urho3D
 {
 
+class BackgroundLoadThread;
 class Resource;
-class ResourceCache;
 
 /// Queue item for background loading of a resource.
 struct BackgroundLoadItem
@@ -45,34 +46,89 @@ struct BackgroundLoadItem
     HashSet<Pair<StringHash, StringHash> > dependencies_;
     /// Resources that depend on this resource's loading.
     HashSet<Pair<StringHash, StringHash> > dependents_;
+    /// Load priority. Higher priority resources are loaded first.
+    unsigned priority_;
+    /// Queueing order, used to load resources of equal priority in the order they were queued.
+    unsigned sequence_;
+    /// Timer started when the resource was queued.
+    HiresTimer timer_;
+    /// Microseconds from queueing until loading started.
+    long long queueUSec_;
+    /// Microseconds from queueing until BeginLoad() finished.
+    long long beginLoadEndUSec_;
     /// Whether to send failure event.
     bool sendEventOnFailure_;
 };
 
-/// Background loader of resources. Owned by the ResourceCache.
-class BackgroundLoader : public RefCounted, public Thread
+/// Entry in the heap of queued resources that no loader thread has taken yet. Raising the priority of a resource pushes a new entry, leaving the old one stale.
+struct BackgroundLoadPendingItem
+{
+    /// Construct.
+    BackgroundLoadPendingItem(const Pair<StringHash, StringHash>& key, unsigned priority, unsigned sequence) :
+        key_(key),
+        priority_(priority),
+        sequence_(sequence)
+    {
+    }
+
+    /// Test for heap ordering. The highest priority and then the earliest queued entry is at the top.
+    bool operator <(const BackgroundLoadPendingItem& rhs) const
+    {
+        return priority_ != rhs.priority_ ? priority_ < rhs.priority_ : sequence_ > rhs.sequence_;
+    }
+
+    /// Resource type and name hash.
+    Pair<StringHash, StringHash> key_;
+    /// Load priority when the entry was pushed.
+    unsigned priority_;
+    /// Queueing order of the resource.
+    unsigned sequence_;
+};
+
+/// Background loader of resources. Owned by the ResourceCache. Runs BeginLoad() of queued resources on a pool of loader threads.
+class BackgroundLoader : public RefCounted
 {
 public:
     /// Construct.
     explicit BackgroundLoader(ResourceCache* owner);
 
-    /// Destruct. Forcibly clear the load queue.
+    /// Destruct. Stop the loader threads and forcibly clear the load queue.
     ~BackgroundLoader() override;
 
-    /// Resource background loading loop.
-    void ThreadFunction() override;
-
-    /// Queue loading of a resource. The name must be sanitated to ensure consistent format. Return true if queued (not a duplicate and resource was a known type).
-    bool QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller);
+    /// Set number of loader threads. The threads are started on the first queued resource.
+    void SetNumThreads(unsigned numThreads);
+    /// Queue loading of a resource. The name must be sanitated to ensure consistent format. Return true if queued (not a duplicate and resource was a known type). A duplicate has its priority raised if the new priority is higher.
+    bool QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller, unsigned priority);
     /// Wait and finish possible loading of a resource when being requested from the cache.
     void WaitForResource(StringHash type, StringHash nameHash);
     /// Process resources that are ready to finish.
     void FinishResources(int maxMs);
+    /// Enable or disable recording the load timing of each finished resource.
+    void SetRecordTimings(bool enable);
+    /// Clear the recorded load timings.
+    void ClearTimings();
+    /// Load the highest priority queued resource on the calling loader thread. Return false and mark the thread idle if none were queued.
+    bool LoadNextResource(BackgroundLoadThread* thread);
+
+    /// Return number of loader threads.
+    unsigned GetNumThreads() const { return numThreads_; }
 
     /// Return amount of resources in the load queue.
     unsigned GetNumQueuedResources() const;
 
+    /// Return whether load timings are recorded.
+    bool GetRecordTimings() const { return recordTimings_; }
+
+    /// Return the recorded load timings in the order the resources were finished.
+    Vector<BackgroundLoadTiming> GetTimings() const;
+
 private:
+    /// Start the loader threads that are not running yet.
+    void StartThreads();
+    /// Raise the priority of a queued resource and the resources it depends on. Called with the queue mutex held.
+    void RaisePriority(BackgroundLoadItem& item, unsigned priority);
+    /// Push a pending heap entry for a resource not yet taken by a loader thread and wake an idle thread. Called with the queue mutex held.
+    void PushPendingItem(BackgroundLoadItem& item);
     /// Finish one background loaded resource.
     void FinishBackgroundLoading(BackgroundLoadItem& item);
 
@@ -82,6 +138,18 @@ private:
     mutable Mutex backgroundLoadMutex_;
     /// Resources that are queued for background loading.
     HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem> backgroundLoadQueue_;
+    /// Max-heap of queued resources that no loader thread has taken yet. May hold stale entries, which are skipped when popped.
+    PODVector<BackgroundLoadPendingItem> pendingItems_;
+    /// Loader threads.
+    Vector<SharedPtr<BackgroundLoadThread> > threads_;
+    /// Recorded load timings.
+    Vector<BackgroundLoadTiming> timings_;
+    /// Number of loader threads.
+    unsigned numThreads_;
+    /// Queueing order of the next queued resource.
+    unsigned nextSequence_;
+    /// Load timing recording flag.
+    bool recordTimings_;
 };
 
 }
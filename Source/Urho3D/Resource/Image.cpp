@@ -2322,6 +2322,11 @@ unsigned char* Image::GetImageData(Deserializer& source, int& width, int& height
 {
     unsigned dataSize = source.GetSize();
 
+    // Decode in place if the source already holds the data in memory
+    const void* data = source.ReadSpan(dataSize);
+    if (data)
+        return stbi_load_from_memory((const unsigned char*)data, dataSize, &width, &height, (int*)&components, 0);
+
     SharedArrayPtr<unsigned char> buffer(new unsigned char[dataSize]);
     source.Read(buffer.Get(), dataSize);
     return stbi_load_from_memory(buffer.Get(), dataSize, &width, &height, (int*)&components, 0);
@@ -34,6 +34,7 @@ namespace Urho3D
 Resource::Resource(Context* context) :
     Object(context),
     memoryUse_(0),
+    lastUseFrame_(0),
     asyncLoadState_(ASYNC_DONE)
 {
 }
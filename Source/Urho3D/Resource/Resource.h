@@ -79,6 +79,8 @@ public:
     void SetMemoryUse(unsigned size);
     /// Reset last used timer.
     void ResetUseTimer();
+    /// Set the frame number of last use. Called by ResourceCache.
+    void SetLastUseFrame(unsigned frameNumber) { lastUseFrame_ = frameNumber; }
     /// Set the asynchronous loading state. Called by ResourceCache. Resources in the middle of asynchronous loading are not normally returned to user.
     void SetAsyncLoadState(AsyncLoadState newState);
 
@@ -94,6 +96,9 @@ public:
     /// Return time since last use in milliseconds. If referred to elsewhere than in the resource cache, returns always zero.
     unsigned GetUseTimer();
 
+    /// Return the frame number when the resource was last requested from the resource cache, or found referred to elsewhere by it.
+    unsigned GetLastUseFrame() const { return lastUseFrame_; }
+
     /// Return the asynchronous loading state.
     AsyncLoadState GetAsyncLoadState() const { return asyncLoadState_; }
 
@@ -106,6 +111,8 @@ private:
     Timer useTimer_;
     /// Memory use in bytes.
     unsigned memoryUse_;
+    /// Frame number of last use.
+    unsigned lastUseFrame_;
     /// Asynchronous loading state.
     AsyncLoadState asyncLoadState_;
 };
@@ -67,13 +67,34 @@ static const char* checkDirs[] =
 
 static const SharedPtr<Resource> noResource;
 
+/// Resource directory lookup result for a file that exists only as an absolute path.
+static const unsigned LOOKUP_ABSOLUTE_PATH = M_MAX_UNSIGNED - 1;
+/// Resource directory lookup result for a file that was not found.
+static const unsigned LOOKUP_NOT_FOUND = M_MAX_UNSIGNED;
+
+/// Return the package index key for a file name.
+static StringHash GetPackageIndexKey(const String& name)
+{
+#ifdef _WIN32
+    // Package files are matched case-insensitively as a fallback on Windows
+    return StringHash(name.ToLower());
+#else
+    return StringHash(name);
+#endif
+}
+
 ResourceCache::ResourceCache(Context* context) :
     Object(context),
     autoReloadResources_(false),
     returnFailedResources_(false),
     searchPackagesFirst_(true),
+    memoryMapPackages_(false),
+    cacheResourceDirLookups_(false),
     isRouting_(false),
-    finishBackgroundResourcesMs_(5)
+    finishBackgroundResourcesMs_(5),
+    totalMemoryBudget_(0),
+    frameNumber_(0),
+    releaseFailedFrame_(M_MAX_UNSIGNED)
 {
     // Register Resource library object factories
     RegisterResourceLibrary(context_);
@@ -120,6 +141,7 @@ bool ResourceCache::AddResourceDir(const String& pathName, unsigned priority)
         resourceDirs_.Insert(priority, fixedPath);
     else
         resourceDirs_.Push(fixedPath);
+    resourceDirLookups_.Clear();
 
     // If resource auto-reloading active, create a file watcher for the directory
     if (autoReloadResources_)
@@ -144,10 +166,15 @@ bool ResourceCache::AddPackageFile(PackageFile* package, unsigned priority)
         return false;
     }
 
+    // A package that can not be mapped is still usable through regular file reads
+    if (memoryMapPackages_)
+        package->SetMemoryMapped(true);
+
     if (priority < packages_.Size())
         packages_.Insert(priority, SharedPtr<PackageFile>(package));
     else
         packages_.Push(SharedPtr<PackageFile>(package));
+    RebuildPackageIndex();
 
     URHO3D_LOGINFO("Added resource package " + package->GetName());
     return true;
@@ -175,6 +202,7 @@ bool ResourceCache::AddManualResource(Resource* resource)
     }
 
     resource->ResetUseTimer();
+    resource->SetLastUseFrame(frameNumber_);
     resourceGroups_[resource->GetType()].resources_[resource->GetNameHash()] = resource;
     UpdateResourceGroup(resource->GetType());
     return true;
@@ -191,6 +219,7 @@ void ResourceCache::RemoveResourceDir(const String& pathName)
         if (!resourceDirs_[i].Compare(fixedPath, false))
         {
             resourceDirs_.Erase(i);
+            resourceDirLookups_.Clear();
             // Remove the filewatcher with the matching path
             for (unsigned j = 0; j < fileWatchers_.Size(); ++j)
             {
@@ -218,6 +247,7 @@ void ResourceCache::RemovePackageFile(PackageFile* package, bool releaseResource
                 ReleasePackageResources(*i, forceRelease);
             URHO3D_LOGINFO("Removed resource package " + (*i)->GetName());
             packages_.Erase(i);
+            RebuildPackageIndex();
             return;
         }
     }
@@ -238,6 +268,7 @@ void ResourceCache::RemovePackageFile(const String& fileName, bool releaseResour
                 ReleasePackageResources(*i, forceRelease);
             URHO3D_LOGINFO("Removed resource package " + (*i)->GetName());
             packages_.Erase(i);
+            RebuildPackageIndex();
             return;
         }
     }
@@ -384,6 +415,7 @@ bool ResourceCache::ReloadResource(Resource* resource)
     if (success)
     {
         resource->ResetUseTimer();
+        resource->SetLastUseFrame(frameNumber_);
         UpdateResourceGroup(resource->GetType());
         resource->SendEvent(E_RELOADFINISHED);
         return true;
@@ -435,7 +467,61 @@ void ResourceCache::ReloadResourceWithDependencies(const String& fileName)
 
 void ResourceCache::SetMemoryBudget(StringHash type, unsigned long long budget)
 {
-    resourceGroups_[type].memoryBudget_ = budget;
+    ResourceGroup& group = resourceGroups_[type];
+    group.memoryBudget_ = budget;
+    group.releaseFailedFrame_ = M_MAX_UNSIGNED;
+    UpdateResourceGroup(type);
+}
+
+void ResourceCache::SetTotalMemoryBudget(unsigned long long budget)
+{
+    totalMemoryBudget_ = budget;
+    releaseFailedFrame_ = M_MAX_UNSIGNED;
+    CheckTotalMemoryBudget();
+}
+
+void ResourceCache::ResetStats()
+{
+    for (HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+        i->second_.stats_ = ResourceCacheStats();
+}
+
+void ResourceCache::SetMemoryMapPackages(bool enable)
+{
+    MutexLock lock(resourceMutex_);
+
+    memoryMapPackages_ = enable;
+    for (unsigned i = 0; i < packages_.Size(); ++i)
+        packages_[i]->SetMemoryMapped(enable);
+}
+
+void ResourceCache::SetNumBackgroundLoadThreads(unsigned numThreads)
+{
+#ifdef URHO3D_THREADING
+    backgroundLoader_->SetNumThreads(numThreads);
+#endif
+}
+
+void ResourceCache::SetRecordBackgroundLoadTimings(bool enable)
+{
+#ifdef URHO3D_THREADING
+    backgroundLoader_->SetRecordTimings(enable);
+#endif
+}
+
+void ResourceCache::ClearBackgroundLoadTimings()
+{
+#ifdef URHO3D_THREADING
+    backgroundLoader_->ClearTimings();
+#endif
+}
+
+void ResourceCache::SetCacheResourceDirLookups(bool enable)
+{
+    MutexLock lock(resourceMutex_);
+
+    cacheResourceDirLookups_ = enable;
+    resourceDirLookups_.Clear();
 }
 
 void ResourceCache::SetAutoReloadResources(bool enable)
@@ -556,6 +642,8 @@ Resource* ResourceCache::GetExistingResource(StringHash type, const String& name
     StringHash nameHash(sanitatedName);
 
     const SharedPtr<Resource>& existing = FindResource(type, nameHash);
+    if (existing)
+        existing->SetLastUseFrame(frameNumber_);
     return existing;
 }
 
@@ -582,7 +670,11 @@ Resource* ResourceCache::GetResource(StringHash type, const String& name, bool s
 
     const SharedPtr<Resource>& existing = FindResource(type, nameHash);
     if (existing)
+    {
+        existing->SetLastUseFrame(frameNumber_);
+        ++resourceGroups_[type].stats_.hits_;
         return existing;
+    }
 
     SharedPtr<Resource> resource;
     // Make sure the pointer is non-null and is a Resource subclass
@@ -603,6 +695,9 @@ Resource* ResourceCache::GetResource(StringHash type, const String& name, bool s
         return nullptr;
     }
 
+    // Count the miss only for a known resource type, so that requests for unknown types do not create empty groups
+    ++resourceGroups_[type].stats_.misses_;
+
     // Attempt to load the resource
     SharedPtr<File> file = GetFile(sanitatedName, sendEventOnFailure);
     if (!file)
@@ -629,13 +724,14 @@ Resource* ResourceCache::GetResource(StringHash type, const String& name, bool s
 
     // Store to cache
     resource->ResetUseTimer();
+    resource->SetLastUseFrame(frameNumber_);
     resourceGroups_[type].resources_[nameHash] = resource;
     UpdateResourceGroup(type);
 
     return resource;
 }
 
-bool ResourceCache::BackgroundLoadResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller)
+bool ResourceCache::BackgroundLoadResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller, unsigned priority)
 {
 #ifdef URHO3D_THREADING
     // If empty name, fail immediately
@@ -648,7 +744,7 @@ bool ResourceCache::BackgroundLoadResource(StringHash type, const String& name,
     if (FindResource(type, nameHash) != noResource)
         return false;
 
-    return backgroundLoader_->QueueResource(type, sanitatedName, sendEventOnFailure, caller);
+    return backgroundLoader_->QueueResource(type, sanitatedName, sendEventOnFailure, caller, priority);
 #else
     // When threading not supported, fall back to synchronous loading
     return GetResource(type, name, sendEventOnFailure);
@@ -717,6 +813,33 @@ unsigned ResourceCache::GetNumBackgroundLoadResources() const
 #endif
 }
 
+unsigned ResourceCache::GetNumBackgroundLoadThreads() const
+{
+#ifdef URHO3D_THREADING
+    return backgroundLoader_->GetNumThreads();
+#else
+    return 0;
+#endif
+}
+
+bool ResourceCache::GetRecordBackgroundLoadTimings() const
+{
+#ifdef URHO3D_THREADING
+    return backgroundLoader_->GetRecordTimings();
+#else
+    return false;
+#endif
+}
+
+Vector<BackgroundLoadTiming> ResourceCache::GetBackgroundLoadTimings() const
+{
+#ifdef URHO3D_THREADING
+    return backgroundLoader_->GetTimings();
+#else
+    return Vector<BackgroundLoadTiming>();
+#endif
+}
+
 void ResourceCache::GetResources(PODVector<Resource*>& result, StringHash type) const
 {
     result.Clear();
@@ -745,21 +868,7 @@ bool ResourceCache::Exists(const String& name) const
     if (sanitatedName.Empty())
         return false;
 
-    for (unsigned i = 0; i < packages_.Size(); ++i)
-    {
-        if (packages_[i]->Exists(sanitatedName))
-            return true;
-    }
-
-    auto* fileSystem = GetSubsystem<FileSystem>();
-    for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
-    {
-        if (fileSystem->FileExists(resourceDirs_[i] + sanitatedName))
-            return true;
-    }
-
-    // Fallback using absolute path
-    return fileSystem->FileExists(sanitatedName);
+    return FindPackage(sanitatedName) || FindResourceDir(sanitatedName) != LOOKUP_NOT_FOUND;
 }
 
 unsigned long long ResourceCache::GetMemoryBudget(StringHash type) const
@@ -782,6 +891,26 @@ unsigned long long ResourceCache::GetTotalMemoryUse() const
     return total;
 }
 
+ResourceCacheStats ResourceCache::GetStats(StringHash type) const
+{
+    HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Find(type);
+    return i != resourceGroups_.End() ? i->second_.stats_ : ResourceCacheStats();
+}
+
+ResourceCacheStats ResourceCache::GetTotalStats() const
+{
+    ResourceCacheStats total;
+    for (HashMap<StringHash, ResourceGroup>::ConstIterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+    {
+        const ResourceCacheStats& stats = i->second_.stats_;
+        total.hits_ += stats.hits_;
+        total.misses_ += stats.misses_;
+        total.evictions_ += stats.evictions_;
+        total.evictedBytes_ += stats.evictedBytes_;
+    }
+    return total;
+}
+
 String ResourceCache::GetResourceFileName(const String& name) const
 {
     auto* fileSystem = GetSubsystem<FileSystem>();
@@ -966,7 +1095,8 @@ String ResourceCache::PrintMemoryUsage() const
 
     memset(outputLine, ' ', 256);
     outputLine[255] = 0;
-    sprintf(outputLine, "%-28s %4s %9s %9s %9s %9s\n", "All", countString.CString(), memUseString.CString(), memMaxString.CString(), "-", memTotalString.CString());
+    const String memBudgetString = totalMemoryBudget_ ? GetFileSizeString(totalMemoryBudget_) : String("-");
+    sprintf(outputLine, "%-28s %4s %9s %9s %9s %9s\n", "All", countString.CString(), memUseString.CString(), memMaxString.CString(), memBudgetString.CString(), memTotalString.CString());
     output += ((const char*)outputLine);
 
     return output;
@@ -1036,47 +1166,130 @@ void ResourceCache::UpdateResourceGroup(StringHash type)
     if (i == resourceGroups_.End())
         return;
 
-    for (;;)
+    ResourceGroup& group = i->second_;
+    unsigned long long totalSize = 0;
+    for (HashMap<StringHash, SharedPtr<Resource> >::ConstIterator j = group.resources_.Begin(); j != group.resources_.End(); ++j)
+        totalSize += j->second_->GetMemoryUse();
+    group.memoryUse_ = totalSize;
+
+    // If memory budget defined and is exceeded, release the least recently used resources
+    if (group.memoryBudget_ && group.memoryUse_ > group.memoryBudget_ && group.releaseFailedFrame_ != frameNumber_)
     {
-        unsigned totalSize = 0;
-        unsigned oldestTimer = 0;
-        HashMap<StringHash, SharedPtr<Resource> >::Iterator oldestResource = i->second_.resources_.End();
+        ReleaseLeastRecentlyUsed(&group, group.memoryUse_ - group.memoryBudget_);
+        if (group.memoryUse_ > group.memoryBudget_)
+            group.releaseFailedFrame_ = frameNumber_;
+    }
 
-        for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
+    CheckTotalMemoryBudget();
+}
+
+void ResourceCache::CheckTotalMemoryBudget()
+{
+    if (!totalMemoryBudget_ || releaseFailedFrame_ == frameNumber_)
+        return;
+
+    unsigned long long totalUse = GetTotalMemoryUse();
+    if (totalUse <= totalMemoryBudget_)
+        return;
+
+    ReleaseLeastRecentlyUsed(nullptr, totalUse - totalMemoryBudget_);
+    if (GetTotalMemoryUse() > totalMemoryBudget_)
+        releaseFailedFrame_ = frameNumber_;
+}
+
+/// Resource that may be released to stay within a memory budget.
+struct ReleaseCandidate
+{
+    /// Resource group.
+    ResourceGroup* group_;
+    /// Resource.
+    Resource* resource_;
+    /// Frame number of last use.
+    unsigned lastUseFrame_;
+};
+
+/// Compare release candidates by last use, least recent first.
+static bool CompareReleaseCandidates(const ReleaseCandidate& lhs, const ReleaseCandidate& rhs)
+{
+    return lhs.lastUseFrame_ < rhs.lastUseFrame_;
+}
+
+void ResourceCache::ReleaseLeastRecentlyUsed(ResourceGroup* group, unsigned long long bytes)
+{
+    PODVector<ReleaseCandidate> candidates;
+
+    for (HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+    {
+        if (group && &i->second_ != group)
+            continue;
+
+        for (HashMap<StringHash, SharedPtr<Resource> >::ConstIterator j = i->second_.resources_.Begin();
              j != i->second_.resources_.End(); ++j)
         {
-            totalSize += j->second_->GetMemoryUse();
-            unsigned useTimer = j->second_->GetUseTimer();
-            if (useTimer > oldestTimer)
+            Resource* resource = j->second_;
+            // Resources referred to elsewhere are in use now
+            if (j->second_.Refs() > 1 || j->second_.WeakRefs() > 0)
             {
-                oldestTimer = useTimer;
-                oldestResource = j;
+                resource->SetLastUseFrame(frameNumber_);
+                continue;
             }
+            // Keep the resources used during this frame, so that a budget smaller than one frame's working set does not
+            // cause the same resources to be released and loaded again
+            if (resource->GetLastUseFrame() == frameNumber_)
+                continue;
+
+            ReleaseCandidate candidate;
+            candidate.group_ = &i->second_;
+            candidate.resource_ = resource;
+            candidate.lastUseFrame_ = resource->GetLastUseFrame();
+            candidates.Push(candidate);
         }
+    }
 
-        i->second_.memoryUse_ = totalSize;
+    Sort(candidates.Begin(), candidates.End(), CompareReleaseCandidates);
 
-        // If memory budget defined and is exceeded, remove the oldest resource and loop again
-        // (resources in use always return a zero timer and can not be removed)
-        if (i->second_.memoryBudget_ && i->second_.memoryUse_ > i->second_.memoryBudget_ &&
-            oldestResource != i->second_.resources_.End())
-        {
-            URHO3D_LOGDEBUG("Resource group " + oldestResource->second_->GetTypeName() + " over memory budget, releasing resource " +
-                     oldestResource->second_->GetName());
-            i->second_.resources_.Erase(oldestResource);
-        }
-        else
-            break;
+    unsigned long long released = 0;
+    for (unsigned i = 0; i < candidates.Size() && released < bytes; ++i)
+    {
+        ResourceGroup* candidateGroup = candidates[i].group_;
+        Resource* resource = candidates[i].resource_;
+        unsigned memoryUse = resource->GetMemoryUse();
+
+        URHO3D_LOGDEBUG("Over memory budget, releasing resource " + resource->GetName());
+
+        released += memoryUse;
+        candidateGroup->memoryUse_ -= memoryUse;
+        ++candidateGroup->stats_.evictions_;
+        candidateGroup->stats_.evictedBytes_ += memoryUse;
+        // Destroys the resource
+        candidateGroup->resources_.Erase(resource->GetNameHash());
     }
 }
 
 void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
 {
+    using namespace BeginFrame;
+
+    // Release resources that the previous frame left over budget, now that they may be unused
+    frameNumber_ = eventData[P_FRAMENUMBER].GetUInt();
+    for (HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+    {
+        if (i->second_.memoryBudget_ && i->second_.memoryUse_ > i->second_.memoryBudget_)
+            UpdateResourceGroup(i->first_);
+    }
+    CheckTotalMemoryBudget();
+
     for (unsigned i = 0; i < fileWatchers_.Size(); ++i)
     {
         String fileName;
         while (fileWatchers_[i]->GetNextChange(fileName))
         {
+            // Files may have been added or removed, so forget the cached lookups before reloading
+            {
+                MutexLock lock(resourceMutex_);
+                resourceDirLookups_.Clear();
+            }
+
             ReloadResourceWithDependencies(fileName);
 
             // Finally send a general file changed event even if the file was not a tracked resource
@@ -1100,21 +1313,18 @@ void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData
 
 File* ResourceCache::SearchResourceDirs(const String& name)
 {
-    auto* fileSystem = GetSubsystem<FileSystem>();
-    for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
+    unsigned dirIndex = FindResourceDir(name);
+    if (dirIndex < resourceDirs_.Size())
     {
-        if (fileSystem->FileExists(resourceDirs_[i] + name))
-        {
-            // Construct the file first with full path, then rename it to not contain the resource path,
-            // so that the file's sanitatedName can be used in further GetFile() calls (for example over the network)
-            File* file(new File(context_, resourceDirs_[i] + name));
-            file->SetName(name);
-            return file;
-        }
+        // Construct the file first with full path, then rename it to not contain the resource path,
+        // so that the file's sanitatedName can be used in further GetFile() calls (for example over the network)
+        File* file(new File(context_, resourceDirs_[dirIndex] + name));
+        file->SetName(name);
+        return file;
     }
 
     // Fallback using absolute path
-    if (fileSystem->FileExists(name))
+    if (dirIndex == LOOKUP_ABSOLUTE_PATH)
         return new File(context_, name);
 
     return nullptr;
@@ -1122,15 +1332,73 @@ File* ResourceCache::SearchResourceDirs(const String& name)
 
 File* ResourceCache::SearchPackages(const String& name)
 {
-    for (unsigned i = 0; i < packages_.Size(); ++i)
+    PackageFile* package = FindPackage(name);
+    return package ? new File(context_, package, name) : nullptr;
+}
+
+PackageFile* ResourceCache::FindPackage(const String& name) const
+{
+    HashMap<StringHash, PackageFile*>::ConstIterator i = packageIndex_.Find(GetPackageIndexKey(name));
+    if (i == packageIndex_.End())
+        return nullptr;
+    if (i->second_->Exists(name))
+        return i->second_;
+
+    // Another file has the same hash, so search the packages in order
+    for (unsigned j = 0; j < packages_.Size(); ++j)
     {
-        if (packages_[i]->Exists(name))
-            return new File(context_, packages_[i], name);
+        if (packages_[j]->Exists(name))
+            return packages_[j];
     }
 
     return nullptr;
 }
 
+unsigned ResourceCache::FindResourceDir(const String& name) const
+{
+    if (cacheResourceDirLookups_)
+    {
+        HashMap<String, unsigned>::ConstIterator i = resourceDirLookups_.Find(name);
+        if (i != resourceDirLookups_.End())
+            return i->second_;
+    }
+
+    unsigned dirIndex = LOOKUP_NOT_FOUND;
+    auto* fileSystem = GetSubsystem<FileSystem>();
+    for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
+    {
+        if (fileSystem->FileExists(resourceDirs_[i] + name))
+        {
+            dirIndex = i;
+            break;
+        }
+    }
+
+    // Fallback using absolute path
+    if (dirIndex == LOOKUP_NOT_FOUND && fileSystem->FileExists(name))
+        dirIndex = LOOKUP_ABSOLUTE_PATH;
+
+    if (cacheResourceDirLookups_)
+        resourceDirLookups_[name] = dirIndex;
+
+    return dirIndex;
+}
+
+void ResourceCache::RebuildPackageIndex()
+{
+    URHO3D_PROFILE(RebuildPackageIndex);
+
+    packageIndex_.Clear();
+
+    // Go from the lowest priority package up, so that files in higher priority packages override
+    for (unsigned i = packages_.Size() - 1; i < packages_.Size(); --i)
+    {
+        const HashMap<String, PackageEntry>& entries = packages_[i]->GetEntries();
+        for (HashMap<String, PackageEntry>::ConstIterator j = entries.Begin(); j != entries.End(); ++j)
+            packageIndex_[GetPackageIndexKey(j->first_)] = packages_[i];
+    }
+}
+
 void RegisterResourceLibrary(Context* context)
 {
     Image::RegisterObject(context);
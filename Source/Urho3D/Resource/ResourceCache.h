@@ -40,13 +40,27 @@ class PackageFile;
 /// Sets to priority so that a package or file is pushed to the end of the vector.
 static const unsigned PRIORITY_LAST = 0xffffffff;
 
+/// Resource cache statistics.
+struct ResourceCacheStats
+{
+    /// GetResource() calls that returned an already loaded resource.
+    unsigned long long hits_{};
+    /// GetResource() calls that had to load the resource.
+    unsigned long long misses_{};
+    /// Resources released to stay within the memory budgets.
+    unsigned long long evictions_{};
+    /// Memory use of the released resources in bytes.
+    unsigned long long evictedBytes_{};
+};
+
 /// Container of resources with specific type.
 struct ResourceGroup
 {
     /// Construct with defaults.
     ResourceGroup() :
         memoryBudget_(0),
-        memoryUse_(0)
+        memoryUse_(0),
+        releaseFailedFrame_(M_MAX_UNSIGNED)
     {
     }
 
@@ -54,10 +68,35 @@ struct ResourceGroup
     unsigned long long memoryBudget_;
     /// Current memory use.
     unsigned long long memoryUse_;
+    /// Statistics.
+    ResourceCacheStats stats_;
+    /// Frame number when releasing resources last failed to get under the budget. Releasing is not tried again during the same frame.
+    unsigned releaseFailedFrame_;
     /// Resources.
     HashMap<StringHash, SharedPtr<Resource> > resources_;
 };
 
+/// Load timing of a background loaded resource.
+struct BackgroundLoadTiming
+{
+    /// Resource type.
+    StringHash type_;
+    /// Resource name.
+    String name_;
+    /// Load priority.
+    unsigned priority_;
+    /// Microseconds spent in the queue before a loader thread took the resource.
+    long long queueUSec_;
+    /// Microseconds spent opening the file and in BeginLoad() on the loader thread.
+    long long beginLoadUSec_;
+    /// Microseconds from the end of BeginLoad() until EndLoad() started on the main thread, including the wait for dependencies.
+    long long finishWaitUSec_;
+    /// Microseconds spent in EndLoad() on the main thread.
+    long long endLoadUSec_;
+    /// Whether loading succeeded.
+    bool success_;
+};
+
 /// Resource request types.
 enum ResourceRequest
 {
@@ -118,8 +157,12 @@ public:
     bool ReloadResource(Resource* resource);
     /// Reload a resource based on filename. Causes also reload of dependent resources if necessary.
     void ReloadResourceWithDependencies(const String& fileName);
-    /// Set memory budget for a specific resource type, default 0 is unlimited.
+    /// Set memory budget for a specific resource type, default 0 is unlimited. When over budget, the least recently used resources that are not referred to elsewhere are released, except those used during the current frame.
     void SetMemoryBudget(StringHash type, unsigned long long budget);
+    /// Set memory budget for all resource types together, default 0 is unlimited. The per-type budgets apply as well.
+    void SetTotalMemoryBudget(unsigned long long budget);
+    /// Reset the statistics of all resource types.
+    void ResetStats();
     /// Enable or disable automatic reloading of resources as files are modified. Default false.
     void SetAutoReloadResources(bool enable);
     /// Enable or disable returning resources that failed to load. Default false. This may be useful in editing to not lose resource ref attributes.
@@ -127,9 +170,19 @@ public:
 
     /// Define whether when getting resources should check package files or directories first. True for packages, false for directories.
     void SetSearchPackagesFirst(bool value) { searchPackagesFirst_ = value; }
+    /// Enable or disable memory mapping of package files, including the ones already added. Default false. Files from mapped packages read without file system calls and expose their data through Deserializer::ReadSpan() when uncompressed.
+    void SetMemoryMapPackages(bool enable);
+    /// Enable or disable remembering where files were found in the resource directories, including files that were not found. Default false. Only suitable when the resource directories do not change while running, except for changes seen by automatic resource reloading.
+    void SetCacheResourceDirLookups(bool enable);
 
     /// Set how many milliseconds maximum per frame to spend on finishing background loaded resources.
     void SetFinishBackgroundResourcesMs(int ms) { finishBackgroundResourcesMs_ = Max(ms, 1); }
+    /// Set number of threads that run BeginLoad() of background loaded resources. Default is one less than the number of physical CPU cores, at least one.
+    void SetNumBackgroundLoadThreads(unsigned numThreads);
+    /// Enable or disable recording the load timing of each background loaded resource. Default false.
+    void SetRecordBackgroundLoadTimings(bool enable);
+    /// Clear the recorded background load timings.
+    void ClearBackgroundLoadTimings();
 
     /// Add a resource router object. By default there is none, so the routing process is skipped.
     void AddResourceRouter(ResourceRouter* router, bool addAsFirst = false);
@@ -142,10 +195,16 @@ public:
     Resource* GetResource(StringHash type, const String& name, bool sendEventOnFailure = true);
     /// Load a resource without storing it in the resource cache. Return null if not found or if fails. Can be called from outside the main thread if the resource itself is safe to load completely (it does not possess for example GPU data.)
     SharedPtr<Resource> GetTempResource(StringHash type, const String& name, bool sendEventOnFailure = true);
-    /// Background load a resource. An event will be sent when complete. Return true if successfully stored to the load queue, false if eg. already exists. Can be called from outside the main thread.
-    bool BackgroundLoadResource(StringHash type, const String& name, bool sendEventOnFailure = true, Resource* caller = nullptr);
+    /// Background load a resource. An event will be sent when complete. Return true if successfully stored to the load queue, false if eg. already exists. Higher priority resources are loaded first; queueing an already queued resource with a higher priority moves it ahead. Can be called from outside the main thread.
+    bool BackgroundLoadResource(StringHash type, const String& name, bool sendEventOnFailure = true, Resource* caller = nullptr, unsigned priority = 0);
     /// Return number of pending background-loaded resources.
     unsigned GetNumBackgroundLoadResources() const;
+    /// Return number of background loader threads.
+    unsigned GetNumBackgroundLoadThreads() const;
+    /// Return whether background load timings are recorded.
+    bool GetRecordBackgroundLoadTimings() const;
+    /// Return the recorded background load timings in the order the resources were finished.
+    Vector<BackgroundLoadTiming> GetBackgroundLoadTimings() const;
     /// Return all loaded resources of a specific type.
     void GetResources(PODVector<Resource*>& result, StringHash type) const;
     /// Return an already loaded resource of specific type & name, or null if not found. Will not load if does not exist.
@@ -169,17 +228,23 @@ public:
     /// Template version of releasing a resource by name.
     template <class T> void ReleaseResource(const String& name, bool force = false);
     /// Template version of queueing a resource background load.
-    template <class T> bool BackgroundLoadResource(const String& name, bool sendEventOnFailure = true, Resource* caller = nullptr);
+    template <class T> bool BackgroundLoadResource(const String& name, bool sendEventOnFailure = true, Resource* caller = nullptr, unsigned priority = 0);
     /// Template version of returning loaded resources of a specific type.
     template <class T> void GetResources(PODVector<T*>& result) const;
     /// Return whether a file exists in the resource directories or package files. Does not check manually added in-memory resources.
     bool Exists(const String& name) const;
     /// Return memory budget for a resource type.
     unsigned long long GetMemoryBudget(StringHash type) const;
+    /// Return memory budget for all resource types together.
+    unsigned long long GetTotalMemoryBudget() const { return totalMemoryBudget_; }
     /// Return total memory use for a resource type.
     unsigned long long GetMemoryUse(StringHash type) const;
     /// Return total memory use for all resources.
     unsigned long long GetTotalMemoryUse() const;
+    /// Return statistics for a resource type.
+    ResourceCacheStats GetStats(StringHash type) const;
+    /// Return statistics summed over all resource types.
+    ResourceCacheStats GetTotalStats() const;
     /// Return full absolute file name of resource if possible, or empty if not found.
     String GetResourceFileName(const String& name) const;
 
@@ -192,6 +257,12 @@ public:
     /// Return whether when getting resources should check package files or directories first.
     bool GetSearchPackagesFirst() const { return searchPackagesFirst_; }
 
+    /// Return whether package files are memory mapped.
+    bool GetMemoryMapPackages() const { return memoryMapPackages_; }
+
+    /// Return whether resource directory lookups are cached.
+    bool GetCacheResourceDirLookups() const { return cacheResourceDirLookups_; }
+
     /// Return how many milliseconds maximum to spend on finishing background loaded resources.
     int GetFinishBackgroundResourcesMs() const { return finishBackgroundResourcesMs_; }
 
@@ -221,12 +292,22 @@ private:
     void ReleasePackageResources(PackageFile* package, bool force = false);
     /// Update a resource group. Recalculate memory use and release resources if over memory budget.
     void UpdateResourceGroup(StringHash type);
+    /// Release resources if over the total memory budget.
+    void CheckTotalMemoryBudget();
+    /// Release the least recently used unreferenced resources of one group, or of all groups if null, until the given amount of memory is freed or no more can be released.
+    void ReleaseLeastRecentlyUsed(ResourceGroup* group, unsigned long long bytes);
     /// Handle begin frame event. Automatic resource reloads and the finalization of background loaded resources are processed here.
     void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
     /// Search FileSystem for file.
     File* SearchResourceDirs(const String& name);
     /// Search resource packages for file.
     File* SearchPackages(const String& name);
+    /// Return the highest priority package containing a file, or null if not found.
+    PackageFile* FindPackage(const String& name) const;
+    /// Return the index of the first resource directory containing a file, or one of the special values for an absolute path or a file that was not found.
+    unsigned FindResourceDir(const String& name) const;
+    /// Rebuild the package file index after packages have been added or removed.
+    void RebuildPackageIndex();
 
     /// Mutex for thread-safe access to the resource directories, resource packages and resource dependencies.
     mutable Mutex resourceMutex_;
@@ -238,6 +319,10 @@ private:
     Vector<SharedPtr<FileWatcher> > fileWatchers_;
     /// Package files.
     Vector<SharedPtr<PackageFile> > packages_;
+    /// Highest priority package for each file name hash.
+    HashMap<StringHash, PackageFile*> packageIndex_;
+    /// Cached resource directory lookup results by file name.
+    mutable HashMap<String, unsigned> resourceDirLookups_;
     /// Dependent resources. Only used with automatic reload to eg. trigger reload of a cube texture when any of its faces change.
     HashMap<StringHash, HashSet<StringHash> > dependentResources_;
     /// Resource background loader.
@@ -250,10 +335,20 @@ private:
     bool returnFailedResources_;
     /// Search priority flag.
     bool searchPackagesFirst_;
+    /// Package memory mapping flag.
+    bool memoryMapPackages_;
+    /// Resource directory lookup caching flag.
+    bool cacheResourceDirLookups_;
     /// Resource routing flag to prevent endless recursion.
     mutable bool isRouting_;
     /// How many milliseconds maximum per frame to spend on finishing background loaded resources.
     int finishBackgroundResourcesMs_;
+    /// Memory budget for all resource types together.
+    unsigned long long totalMemoryBudget_;
+    /// Current frame number for the last use of resources.
+    unsigned frameNumber_;
+    /// Frame number when releasing resources last failed to get under the total budget. Releasing is not tried again during the same frame.
+    unsigned releaseFailedFrame_;
 };
 
 template <class T> T* ResourceCache::GetExistingResource(const String& name)
@@ -280,10 +375,10 @@ template <class T> SharedPtr<T> ResourceCache::GetTempResource(const String& nam
     return StaticCast<T>(GetTempResource(type, name, sendEventOnFailure));
 }
 
-template <class T> bool ResourceCache::BackgroundLoadResource(const String& name, bool sendEventOnFailure, Resource* caller)
+template <class T> bool ResourceCache::BackgroundLoadResource(const String& name, bool sendEventOnFailure, Resource* caller, unsigned priority)
 {
     StringHash type = T::GetTypeStatic();
-    return BackgroundLoadResource(type, name, sendEventOnFailure, caller);
+    return BackgroundLoadResource(type, name, sendEventOnFailure, caller, priority);
 }
 
 template <class T> void ResourceCache::GetResources(PODVector<T*>& result) const
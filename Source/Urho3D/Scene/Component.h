@@ -142,6 +142,10 @@ protected:
     bool networkUpdate_;
     /// Enabled flag.
     bool enabled_;
+
+private:
+    /// Index in the scene's component array of the same type, or M_MAX_UNSIGNED if not registered.
+    unsigned typeIndex_;
 };
 
 template <class T> T* Component::GetComponent() const { return static_cast<T*>(GetComponent(T::GetTypeStatic())); }
@@ -185,8 +185,9 @@ void LogicComponent::HandleSceneUpdate(StringHash eventType, VariantMap& eventDa
         }
     }
 
-    // Then execute user-defined update function
-    Update(eventData[P_TIMESTEP].GetFloat());
+    // Then execute user-defined update function. Prefer the typed payload sent by the scene over the event data map
+    const SceneUpdatePayload* payload = GetEventPayload<SceneUpdatePayload>();
+    Update(payload ? payload->timeStep_ : eventData[P_TIMESTEP].GetFloat());
 }
 
 void LogicComponent::HandleScenePostUpdate(StringHash eventType, VariantMap& eventData)
@@ -194,7 +195,8 @@ void LogicComponent::HandleScenePostUpdate(StringHash eventType, VariantMap& eve
     using namespace ScenePostUpdate;
 
     // Execute user-defined post-update function
-    PostUpdate(eventData[P_TIMESTEP].GetFloat());
+    const SceneUpdatePayload* payload = GetEventPayload<SceneUpdatePayload>();
+    PostUpdate(payload ? payload->timeStep_ : eventData[P_TIMESTEP].GetFloat());
 }
 
 #if defined(URHO3D_PHYSICS) || defined(URHO3D_URHO2D)
@@ -211,7 +213,8 @@ void LogicComponent::HandlePhysicsPreStep(StringHash eventType, VariantMap& even
     }
 
     // Execute user-defined fixed update function
-    FixedUpdate(eventData[P_TIMESTEP].GetFloat());
+    const PhysicsStepPayload* payload = GetEventPayload<PhysicsStepPayload>();
+    FixedUpdate(payload ? payload->timeStep_ : eventData[P_TIMESTEP].GetFloat());
 }
 
 void LogicComponent::HandlePhysicsPostStep(StringHash eventType, VariantMap& eventData)
@@ -219,7 +222,8 @@ void LogicComponent::HandlePhysicsPostStep(StringHash eventType, VariantMap& eve
     using namespace PhysicsPostStep;
 
     // Execute user-defined fixed post-update function
-    FixedPostUpdate(eventData[P_TIMESTEP].GetFloat());
+    const PhysicsStepPayload* payload = GetEventPayload<PhysicsStepPayload>();
+    FixedPostUpdate(payload ? payload->timeStep_ : eventData[P_TIMESTEP].GetFloat());
 }
 
 #endif
@@ -24,6 +24,7 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
 #include "../IO/Log.h"
 #include "../IO/MemoryBuffer.h"
 #include "../Resource/XMLFile.h"
@@ -49,11 +50,14 @@ Node::Node(Context* context) :
     Animatable(context),
     worldTransform_(Matrix3x4::IDENTITY),
     dirty_(false),
+    transformQueued_(false),
     enabled_(true),
     enabledPrev_(true),
     networkUpdate_(false),
     parent_(nullptr),
     scene_(nullptr),
+    sceneTransformState_(nullptr),
+    transformVersion_(0),
     id_(0),
     position_(Vector3::ZERO),
     rotation_(Quaternion::IDENTITY),
@@ -643,6 +647,15 @@ void Node::SetOwner(Connection* owner)
 
 void Node::MarkDirty()
 {
+    // When the scene batches transform changes, only flag and queue this node. The scene recalculates the whole subtree and
+    // notifies the listener components in its next transform update
+    if (scene_ && scene_->IsTransformBatching() && !scene_->IsThreadedUpdate() && Thread::IsMainThread())
+    {
+        dirty_ = true;
+        scene_->QueueTransformUpdate(this);
+        return;
+    }
+
     Node *cur = this;
     for (;;)
     {
@@ -658,21 +671,7 @@ void Node::MarkDirty()
         cur->dirty_ = true;
 
         // Notify listener components first, then mark child nodes
-        for (Vector<WeakPtr<Component> >::Iterator i = cur->listeners_.Begin(); i != cur->listeners_.End();)
-        {
-            Component *c = *i;
-            if (c)
-            {
-                c->OnMarkedDirty(cur);
-                ++i;
-            }
-            // If listener has expired, erase from list (swap with the last element to avoid O(n^2) behavior)
-            else
-            {
-                *i = cur->listeners_.Back();
-                cur->listeners_.Pop();
-            }
-        }
+        cur->NotifyListeners();
 
         // Tail call optimization: Don't recurse to mark the first child dirty, but
         // instead process it in the context of the current function. If there are more
@@ -994,6 +993,8 @@ void Node::ReorderComponent(Component* component, unsigned index)
             SharedPtr<Component> componentShared(component);
             components_.Erase(i);
             components_.Insert(index, componentShared);
+            if (scene_)
+                scene_->ComponentReordered(component);
             return;
         }
     }
@@ -1305,6 +1306,7 @@ void Node::SetID(unsigned id)
 void Node::SetScene(Scene* scene)
 {
     scene_ = scene;
+    sceneTransformState_ = scene ? &scene->GetTransformState() : nullptr;
 }
 
 void Node::ResetScene()
@@ -1924,6 +1926,24 @@ Component* Node::SafeCreateComponent(const String& typeName, StringHash type, Cr
 
 void Node::UpdateWorldTransform() const
 {
+    // The descendants of nodes queued for a batched transform update are not flagged dirty. Find the topmost out of date
+    // ancestor and recalculate the chain from there
+    if (sceneTransformState_ && sceneTransformState_->numQueued_)
+    {
+        const Node* top = dirty_ ? this : nullptr;
+        for (const Node* cur = parent_; cur && cur != scene_; cur = cur->parent_)
+        {
+            if (cur->dirty_ || cur->transformQueued_)
+                top = cur;
+        }
+
+        if (top)
+            UpdateWorldTransformFrom(top);
+        else
+            transformVersion_ = sceneTransformState_->version_;
+        return;
+    }
+
     Matrix3x4 transform = GetTransform();
 
     // Assume the root node (scene) has identity transform
@@ -1941,6 +1961,54 @@ void Node::UpdateWorldTransform() const
     dirty_ = false;
 }
 
+void Node::UpdateWorldTransformFrom(const Node* top) const
+{
+    if (this != top)
+        parent_->UpdateWorldTransformFrom(top);
+
+    CalculateWorldTransform();
+    // The chain is up to date until the next batched change, so repeated getters need not walk it again
+    transformVersion_ = sceneTransformState_->version_;
+}
+
+void Node::CalculateWorldTransform() const
+{
+    Matrix3x4 transform = GetTransform();
+
+    // Assume the root node (scene) has identity transform
+    if (parent_ == scene_ || !parent_)
+    {
+        worldTransform_ = transform;
+        worldRotation_ = rotation_;
+    }
+    else
+    {
+        worldTransform_ = parent_->worldTransform_ * transform;
+        worldRotation_ = parent_->worldRotation_ * rotation_;
+    }
+
+    dirty_ = false;
+}
+
+void Node::NotifyListeners()
+{
+    for (Vector<WeakPtr<Component> >::Iterator i = listeners_.Begin(); i != listeners_.End();)
+    {
+        Component *c = *i;
+        if (c)
+        {
+            c->OnMarkedDirty(this);
+            ++i;
+        }
+        // If listener has expired, erase from list (swap with the last element to avoid O(n^2) behavior)
+        else
+        {
+            *i = listeners_.Back();
+            listeners_.Pop();
+        }
+    }
+}
+
 void Node::RemoveChild(Vector<SharedPtr<Node> >::Iterator i)
 {
     // Keep a shared pointer to the child about to be removed, to make sure the erase from container completes first. Otherwise
@@ -71,12 +71,22 @@ struct URHO3D_API NodeImpl
 	MANAGED_OBJECT(NodeImpl);
 };
 
+/// Batched transform update state of a scene, read by the world transform getters of the scene's nodes.
+struct SceneTransformState
+{
+    /// Number of nodes queued for the batched transform update. While nonzero, the world transform getters also check the ancestors.
+    unsigned numQueued_;
+    /// Version incremented on each batched transform change. World transforms calculated at the current version are up to date.
+    unsigned version_;
+};
+
 /// %Scene node that may contain components and child nodes.
 class URHO3D_API Node : public Animatable
 {
     URHO3D_OBJECT(Node, Animatable);
 
     friend class Connection;
+    friend class Scene;
 
 public:
     /// Construct.
@@ -387,7 +397,7 @@ public:
     /// Return position in world space.
     Vector3 GetWorldPosition() const
     {
-        if (dirty_)
+        if (IsWorldTransformStale())
             UpdateWorldTransform();
 
         return worldTransform_.Translation();
@@ -403,7 +413,7 @@ public:
     /// Return rotation in world space.
     Quaternion GetWorldRotation() const
     {
-        if (dirty_)
+        if (IsWorldTransformStale())
             UpdateWorldTransform();
 
         return worldRotation_;
@@ -418,7 +428,7 @@ public:
     /// Return direction in world space.
     Vector3 GetWorldDirection() const
     {
-        if (dirty_)
+        if (IsWorldTransformStale())
             UpdateWorldTransform();
 
         return worldRotation_ * Vector3::FORWARD;
@@ -427,7 +437,7 @@ public:
     /// Return node's up vector in world space.
     Vector3 GetWorldUp() const
     {
-        if (dirty_)
+        if (IsWorldTransformStale())
             UpdateWorldTransform();
 
         return worldRotation_ * Vector3::UP;
@@ -436,7 +446,7 @@ public:
     /// Return node's right vector in world space.
     Vector3 GetWorldRight() const
     {
-        if (dirty_)
+        if (IsWorldTransformStale())
             UpdateWorldTransform();
 
         return worldRotation_ * Vector3::RIGHT;
@@ -445,7 +455,7 @@ public:
     /// Return scale in world space.
     Vector3 GetWorldScale() const
     {
-        if (dirty_)
+        if (IsWorldTransformStale())
             UpdateWorldTransform();
 
         return worldTransform_.Scale();
@@ -464,7 +474,7 @@ public:
     /// Return world space transform matrix.
     const Matrix3x4& GetWorldTransform() const
     {
-        if (dirty_)
+        if (IsWorldTransformStale())
             UpdateWorldTransform();
 
         return worldTransform_;
@@ -617,8 +627,20 @@ private:
     void SetEnabled(bool enable, bool recursive, bool storeSelf);
     /// Create component, allowing UnknownComponent if actual type is not supported. Leave typeName empty if not known.
     Component* SafeCreateComponent(const String& typeName, StringHash type, CreateMode mode, unsigned id);
+    /// Return whether the world transform needs recalculation, either because of dirty marking or batched changes in the ancestors.
+    bool IsWorldTransformStale() const
+    {
+        return dirty_ || (sceneTransformState_ && sceneTransformState_->numQueued_ &&
+            transformVersion_ != sceneTransformState_->version_);
+    }
     /// Recalculate the world transform.
     void UpdateWorldTransform() const;
+    /// Recalculate the world transforms from an out of date ancestor down to this node.
+    void UpdateWorldTransformFrom(const Node* top) const;
+    /// Recalculate the world transform from the parent's up to date world transform.
+    void CalculateWorldTransform() const;
+    /// Notify listener components of the node being marked dirty. Erase expired listeners.
+    void NotifyListeners();
     /// Remove child node by iterator.
     void RemoveChild(Vector<SharedPtr<Node> >::Iterator i);
     /// Return child nodes recursively.
@@ -638,6 +660,8 @@ private:
     mutable Matrix3x4 worldTransform_;
     /// World transform needs update flag.
     mutable bool dirty_;
+    /// Queued for the scene's batched transform update flag.
+    bool transformQueued_;
     /// Enabled flag.
     bool enabled_;
     /// Last SetEnabled flag before any SetDeepEnabled.
@@ -652,6 +676,10 @@ private:
     Node* parent_;
     /// Scene (root node.)
     Scene* scene_;
+    /// Batched transform update state of the scene, or null if not in a scene.
+    const SceneTransformState* sceneTransformState_;
+    /// Batched transform version at which the world transform was last calculated while nodes were queued.
+    mutable unsigned transformVersion_;
     /// Unique ID within the scene.
     unsigned id_;
     /// Position.
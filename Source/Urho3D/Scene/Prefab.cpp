@@ -0,0 +1,431 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Core/Context.h"
+#include "../Core/Profiler.h"
+#include "../IO/FileSystem.h"
+#include "../IO/Log.h"
+#include "../Resource/JSONFile.h"
+#include "../Resource/XMLFile.h"
+#include "../Scene/Component.h"
+#include "../Scene/Prefab.h"
+#include "../Scene/Scene.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Store the file-serialized attributes of an object, optionally separating node and component ID attributes.
+static void CompilePrefabAttributes(Serializable* source, Vector<PrefabAttribute>& attributes, Vector<PrefabAttribute>* idAttributes)
+{
+    const Vector<AttributeInfo>* sourceAttributes = source->GetAttributes();
+    if (!sourceAttributes)
+        return;
+
+    for (unsigned i = 0; i < sourceAttributes->Size(); ++i)
+    {
+        const AttributeInfo& attr = sourceAttributes->At(i);
+        // Do not copy network-only attributes, as they may have unintended side effects
+        if (!(attr.mode_ & AM_FILE))
+            continue;
+
+        PrefabAttribute prefabAttr;
+        prefabAttr.index_ = i;
+        prefabAttr.mode_ = attr.mode_;
+        source->OnGetAttribute(attr, prefabAttr.value_);
+
+        if (idAttributes && (attr.mode_ & (AM_NODEID | AM_COMPONENTID | AM_NODEIDVECTOR)))
+            idAttributes->Push(prefabAttr);
+        else
+            attributes.Push(prefabAttr);
+    }
+}
+
+/// Set stored attribute values to an object.
+static void SetPrefabAttributes(Serializable* dest, const Vector<PrefabAttribute>& attributes)
+{
+    const Vector<AttributeInfo>* destAttributes = dest->GetAttributes();
+    if (!destAttributes)
+        return;
+
+    for (unsigned i = 0; i < attributes.Size(); ++i)
+    {
+        const PrefabAttribute& attr = attributes[i];
+        // The attribute list may grow while attributes are set, for example when a script object class is assigned
+        if (attr.index_ < destAttributes->Size())
+            dest->OnSetAttribute(destAttributes->At(attr.index_), attr.value_);
+    }
+}
+
+Prefab::Prefab(Context* context) :
+    Resource(context),
+    poolMode_(REPLICATED)
+{
+}
+
+Prefab::~Prefab()
+{
+    ClearPool();
+}
+
+void Prefab::RegisterObject(Context* context)
+{
+    context->RegisterFactory<Prefab>();
+}
+
+bool Prefab::BeginLoad(Deserializer& source)
+{
+    // Parse the data here, but create the nodes in EndLoad() as components may only be created in the main thread
+    String extension = GetExtension(source.GetName());
+    if (extension == ".xml")
+    {
+        loadXMLFile_ = new XMLFile(context_);
+        if (!loadXMLFile_->Load(source))
+        {
+            loadXMLFile_.Reset();
+            return false;
+        }
+    }
+    else if (extension == ".json")
+    {
+        loadJSONFile_ = new JSONFile(context_);
+        if (!loadJSONFile_->Load(source))
+        {
+            loadJSONFile_.Reset();
+            return false;
+        }
+    }
+    else
+        loadBuffer_.SetData(source, source.GetSize() - source.GetPosition());
+
+    SetMemoryUse(source.GetSize());
+    return true;
+}
+
+bool Prefab::EndLoad()
+{
+    // Instantiate into a scratch scene with the normal loading code, then compile from there
+    SharedPtr<Scene> scene(new Scene(context_));
+    Node* root;
+    if (loadXMLFile_)
+        root = scene->InstantiateXML(loadXMLFile_->GetRoot(), Vector3::ZERO, Quaternion::IDENTITY);
+    else if (loadJSONFile_)
+        root = scene->InstantiateJSON(loadJSONFile_->GetRoot(), Vector3::ZERO, Quaternion::IDENTITY);
+    else
+        root = scene->Instantiate(loadBuffer_, Vector3::ZERO, Quaternion::IDENTITY);
+
+    loadXMLFile_.Reset();
+    loadJSONFile_.Reset();
+    loadBuffer_.Clear();
+
+    if (!root)
+    {
+        URHO3D_LOGERROR("Could not load node data of prefab " + GetName());
+        return false;
+    }
+
+    return Compile(root);
+}
+
+bool Prefab::Compile(Node* source)
+{
+    if (!source)
+    {
+        URHO3D_LOGERROR("Null source node given for prefab");
+        return false;
+    }
+    if (source->IsInstanceOf<Scene>())
+    {
+        URHO3D_LOGERROR("Can not compile a scene into a prefab");
+        return false;
+    }
+
+    URHO3D_PROFILE(CompilePrefab);
+
+    ClearPool();
+    nodes_.Clear();
+    components_.Clear();
+
+    HashMap<unsigned, unsigned> nodeIndices;
+    HashMap<unsigned, unsigned> componentIndices;
+    CompileNode(source, M_MAX_UNSIGNED, nodeIndices, componentIndices);
+
+    // Resolve ID attributes to node and component indices, so that instantiation does not need to look up the IDs
+    unsigned numAttributes = 0;
+    for (unsigned i = 0; i < components_.Size(); ++i)
+    {
+        Vector<PrefabAttribute>& idAttributes = components_[i].idAttributes_;
+        numAttributes += components_[i].attributes_.Size() + idAttributes.Size();
+
+        for (unsigned j = 0; j < idAttributes.Size(); ++j)
+        {
+            PrefabAttribute& attr = idAttributes[j];
+            if (attr.mode_ & AM_NODEIDVECTOR)
+            {
+                // The first index stores the number of IDs redundantly
+                const VariantVector& oldNodeIDs = attr.value_.GetVariantVector();
+                for (unsigned k = 1; k < oldNodeIDs.Size(); ++k)
+                {
+                    unsigned oldNodeID = oldNodeIDs[k].GetUInt();
+                    HashMap<unsigned, unsigned>::ConstIterator l = nodeIndices.Find(oldNodeID);
+                    if (l != nodeIndices.End())
+                        attr.targets_.Push(l->second_);
+                    else
+                    {
+                        attr.targets_.Push(M_MAX_UNSIGNED);
+                        URHO3D_LOGWARNING("Could not resolve node ID " + String(oldNodeID) + " in prefab " + GetName());
+                    }
+                }
+            }
+            else
+            {
+                const HashMap<unsigned, unsigned>& indices = (attr.mode_ & AM_NODEID) ? nodeIndices : componentIndices;
+                unsigned oldID = attr.value_.GetUInt();
+                HashMap<unsigned, unsigned>::ConstIterator k = indices.Find(oldID);
+                if (k != indices.End())
+                    attr.targets_.Push(k->second_);
+                else
+                {
+                    attr.targets_.Push(M_MAX_UNSIGNED);
+                    if (oldID)
+                        URHO3D_LOGWARNING("Could not resolve " + String((attr.mode_ & AM_NODEID) ? "node" : "component") + " ID " +
+                            String(oldID) + " in prefab " + GetName());
+                }
+            }
+        }
+    }
+    for (unsigned i = 0; i < nodes_.Size(); ++i)
+        numAttributes += nodes_[i].attributes_.Size();
+
+    SetMemoryUse(sizeof(Prefab) + nodes_.Size() * sizeof(PrefabNode) + components_.Size() * sizeof(PrefabComponent) +
+        numAttributes * sizeof(PrefabAttribute));
+    return true;
+}
+
+Node* Prefab::Instantiate(Node* parent, const Vector3& position, const Quaternion& rotation, CreateMode mode)
+{
+    if (!parent)
+    {
+        URHO3D_LOGERROR("Null parent node given for prefab instance");
+        return nullptr;
+    }
+    if (nodes_.Empty())
+    {
+        URHO3D_LOGERROR("Prefab " + GetName() + " has no content to instantiate");
+        return nullptr;
+    }
+
+    URHO3D_PROFILE(InstantiatePrefab);
+
+    // Take a pooled instance if available. Skip instances that have been removed from the scene meanwhile
+    Scene* scene = parent->GetScene();
+    if (scene && scene == poolScene_ && mode == poolMode_)
+    {
+        while (!pool_.Empty())
+        {
+            SharedPtr<Node> node = pool_.Back();
+            pool_.Pop();
+            if (node->GetScene() != scene)
+                continue;
+
+            if (node->GetParent() != parent)
+                parent->AddChild(node);
+            node->SetTemporary(false);
+            node->SetTransform(position, rotation);
+            node->ResetDeepEnabled();
+            return node;
+        }
+    }
+
+    Node* node = CreateInstance(parent, mode);
+    node->SetTransform(position, rotation);
+    node->ApplyAttributes();
+    return node;
+}
+
+void Prefab::FillPool(Scene* scene, unsigned count, CreateMode mode)
+{
+    if (!scene)
+    {
+        URHO3D_LOGERROR("Null scene given for prefab pool");
+        return;
+    }
+    if (nodes_.Empty())
+    {
+        URHO3D_LOGERROR("Prefab " + GetName() + " has no content to instantiate");
+        return;
+    }
+
+    URHO3D_PROFILE(FillPrefabPool);
+
+    if (scene != poolScene_ || mode != poolMode_)
+    {
+        ClearPool();
+        poolScene_ = scene;
+        poolMode_ = mode;
+    }
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        SharedPtr<Node> node(CreateInstance(scene, mode));
+        node->ApplyAttributes();
+        // Keep the instance out of scene saves and inactive until used
+        node->SetTemporary(true);
+        node->SetDeepEnabled(false);
+        pool_.Push(node);
+    }
+}
+
+void Prefab::ClearPool()
+{
+    for (unsigned i = 0; i < pool_.Size(); ++i)
+    {
+        Node* node = pool_[i];
+        if (node->GetScene() && node->GetScene() == poolScene_)
+            node->Remove();
+    }
+
+    pool_.Clear();
+}
+
+void Prefab::CompileNode(Node* source, unsigned parentIndex, HashMap<unsigned, unsigned>& nodeIndices,
+    HashMap<unsigned, unsigned>& componentIndices)
+{
+    const HashMap<StringHash, SharedPtr<ObjectFactory> >& factories = context_->GetObjectFactories();
+
+    unsigned nodeIndex = nodes_.Size();
+    nodeIndices[source->GetID()] = nodeIndex;
+    nodes_.Resize(nodeIndex + 1);
+
+    PrefabNode& nodeTemplate = nodes_.Back();
+    nodeTemplate.parentIndex_ = parentIndex;
+    nodeTemplate.replicated_ = source->IsReplicated();
+    CompilePrefabAttributes(source, nodeTemplate.attributes_, nullptr);
+    nodeTemplate.firstComponent_ = components_.Size();
+
+    const Vector<SharedPtr<Component> >& components = source->GetComponents();
+    for (unsigned i = 0; i < components.Size(); ++i)
+    {
+        Component* component = components[i];
+        if (component->IsTemporary())
+            continue;
+
+        HashMap<StringHash, SharedPtr<ObjectFactory> >::ConstIterator factory = factories.Find(component->GetType());
+        if (factory == factories.End())
+        {
+            URHO3D_LOGWARNING("Component type " + component->GetTypeName() + " not known, leaving it out of prefab " + GetName());
+            continue;
+        }
+
+        componentIndices[component->GetID()] = components_.Size();
+        components_.Resize(components_.Size() + 1);
+
+        PrefabComponent& componentTemplate = components_.Back();
+        componentTemplate.factory_ = factory->second_;
+        componentTemplate.replicated_ = component->IsReplicated();
+        CompilePrefabAttributes(component, componentTemplate.attributes_, &componentTemplate.idAttributes_);
+    }
+
+    nodeTemplate.numComponents_ = components_.Size() - nodeTemplate.firstComponent_;
+
+    const Vector<SharedPtr<Node> >& children = source->GetChildren();
+    for (unsigned i = 0; i < children.Size(); ++i)
+    {
+        Node* child = children[i];
+        if (!child->IsTemporary())
+            CompileNode(child, nodeIndex, nodeIndices, componentIndices);
+    }
+}
+
+Node* Prefab::CreateInstance(Node* parent, CreateMode mode) const
+{
+    PODVector<Node*> nodes(nodes_.Size());
+    PODVector<Component*> components(components_.Size());
+
+    for (unsigned i = 0; i < nodes_.Size(); ++i)
+    {
+        const PrefabNode& nodeTemplate = nodes_[i];
+        Node* nodeParent = i ? nodes[nodeTemplate.parentIndex_] : parent;
+        Node* node = nodeParent->CreateChild(0, (mode == REPLICATED && nodeTemplate.replicated_) ? REPLICATED : LOCAL);
+        SetPrefabAttributes(node, nodeTemplate.attributes_);
+        nodes[i] = node;
+
+        for (unsigned j = nodeTemplate.firstComponent_; j < nodeTemplate.firstComponent_ + nodeTemplate.numComponents_; ++j)
+        {
+            const PrefabComponent& componentTemplate = components_[j];
+            // Do not create replicated components to local nodes, same as Node::CreateComponent()
+            CreateMode componentMode = (mode == REPLICATED && componentTemplate.replicated_ && node->IsReplicated()) ? REPLICATED :
+                LOCAL;
+            SharedPtr<Object> object = componentTemplate.factory_->CreateObject();
+            auto* component = static_cast<Component*>(object.Get());
+            node->AddComponent(component, 0, componentMode);
+            SetPrefabAttributes(component, componentTemplate.attributes_);
+            components[j] = component;
+        }
+    }
+
+    // Set ID attributes once all nodes and components exist, as SceneResolver would
+    for (unsigned i = 0; i < components_.Size(); ++i)
+    {
+        const Vector<PrefabAttribute>& idAttributes = components_[i].idAttributes_;
+        if (idAttributes.Empty())
+            continue;
+
+        Component* component = components[i];
+        const Vector<AttributeInfo>* attributes = component->GetAttributes();
+
+        for (unsigned j = 0; j < idAttributes.Size(); ++j)
+        {
+            const PrefabAttribute& attr = idAttributes[j];
+            if (attr.index_ >= attributes->Size())
+                continue;
+
+            if ((attr.mode_ & AM_NODEIDVECTOR) && !attr.targets_.Empty())
+            {
+                VariantVector newIDs;
+                newIDs.Push(attr.value_.GetVariantVector()[0]);
+                for (unsigned k = 0; k < attr.targets_.Size(); ++k)
+                {
+                    unsigned target = attr.targets_[k];
+                    newIDs.Push(target != M_MAX_UNSIGNED ? nodes[target]->GetID() : 0);
+                }
+                component->OnSetAttribute(attributes->At(attr.index_), newIDs);
+            }
+            else if (!attr.targets_.Empty() && attr.targets_[0] != M_MAX_UNSIGNED)
+            {
+                unsigned target = attr.targets_[0];
+                unsigned newID = (attr.mode_ & AM_NODEID) ? nodes[target]->GetID() : components[target]->GetID();
+                component->OnSetAttribute(attributes->At(attr.index_), newID);
+            }
+            else
+                component->OnSetAttribute(attributes->At(attr.index_), attr.value_);
+        }
+    }
+
+    return nodes[0];
+}
+
+}
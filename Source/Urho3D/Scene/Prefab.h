@@ -0,0 +1,137 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../IO/VectorBuffer.h"
+#include "../Resource/Resource.h"
+#include "../Scene/Node.h"
+
+namespace Urho3D
+{
+
+class JSONFile;
+class ObjectFactory;
+class Scene;
+class XMLFile;
+
+/// Attribute value stored in a prefab.
+struct PrefabAttribute
+{
+    /// Attribute index.
+    unsigned index_;
+    /// Attribute mode.
+    AttributeModeFlags mode_;
+    /// Attribute value. For node and component ID attributes, the value that is kept when a reference can not be resolved.
+    Variant value_;
+    /// Node or component indices referred to by an ID attribute, M_MAX_UNSIGNED if outside the prefab. Empty for other attributes.
+    PODVector<unsigned> targets_;
+};
+
+/// Component stored in a prefab.
+struct PrefabComponent
+{
+    /// Factory for creating the component.
+    SharedPtr<ObjectFactory> factory_;
+    /// Replicated flag of the source component.
+    bool replicated_;
+    /// Attribute values, excluding node and component ID attributes.
+    Vector<PrefabAttribute> attributes_;
+    /// Node and component ID attributes, which are set after the whole instance has been created.
+    Vector<PrefabAttribute> idAttributes_;
+};
+
+/// Node stored in a prefab.
+struct PrefabNode
+{
+    /// Index of the parent node, M_MAX_UNSIGNED for the root node.
+    unsigned parentIndex_;
+    /// Replicated flag of the source node.
+    bool replicated_;
+    /// Attribute values.
+    Vector<PrefabAttribute> attributes_;
+    /// Index of the first component.
+    unsigned firstComponent_;
+    /// Number of components.
+    unsigned numComponents_;
+};
+
+/// Node hierarchy compiled once into attribute values and component factories, for instantiating many times without parsing. Can keep a pool of pre-created inactive instances.
+class URHO3D_API Prefab : public Resource
+{
+    URHO3D_OBJECT(Prefab, Resource);
+
+public:
+    /// Construct.
+    explicit Prefab(Context* context);
+    /// Destruct. Remove pooled instances from their scene.
+    ~Prefab() override;
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Load resource from stream. May be called from a worker thread. Return true if successful.
+    bool BeginLoad(Deserializer& source) override;
+    /// Finish resource loading. Always called from the main thread. Return true if successful.
+    bool EndLoad() override;
+
+    /// Compile from a node with its components and child nodes, same as what Node::Clone() copies. Return true if successful.
+    bool Compile(Node* source);
+    /// Instantiate as a child of a node, taking a pooled instance if one exists in the same scene and create mode. Position and rotation are in parent space. Return the root node of the instance, or null if failed.
+    Node* Instantiate(Node* parent, const Vector3& position, const Quaternion& rotation, CreateMode mode = REPLICATED);
+    /// Pre-create inactive temporary instances as children of the scene, to be used by later calls to Instantiate(). An existing pool in another scene or create mode is cleared first.
+    void FillPool(Scene* scene, unsigned count, CreateMode mode = REPLICATED);
+    /// Remove pooled instances from their scene.
+    void ClearPool();
+
+    /// Return number of nodes in the prefab.
+    unsigned GetNumNodes() const { return nodes_.Size(); }
+    /// Return number of components in the prefab.
+    unsigned GetNumComponents() const { return components_.Size(); }
+    /// Return number of pooled instances.
+    unsigned GetPoolSize() const { return pool_.Size(); }
+
+private:
+    /// Compile a node and its children recursively.
+    void CompileNode(Node* source, unsigned parentIndex, HashMap<unsigned, unsigned>& nodeIndices, HashMap<unsigned, unsigned>& componentIndices);
+    /// Create a new instance as a child of a node. Return the root node.
+    Node* CreateInstance(Node* parent, CreateMode mode) const;
+
+    /// Nodes in depth-first order, starting from the root.
+    Vector<PrefabNode> nodes_;
+    /// Components of all nodes in node order.
+    Vector<PrefabComponent> components_;
+    /// Pooled instances.
+    Vector<SharedPtr<Node> > pool_;
+    /// Scene of the pooled instances.
+    WeakPtr<Scene> poolScene_;
+    /// Create mode of the pooled instances.
+    CreateMode poolMode_;
+    /// XML file used while loading.
+    SharedPtr<XMLFile> loadXMLFile_;
+    /// JSON file used while loading.
+    SharedPtr<JSONFile> loadJSONFile_;
+    /// Binary node data used while loading.
+    VectorBuffer loadBuffer_;
+};
+
+}
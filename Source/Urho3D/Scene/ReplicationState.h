@@ -26,6 +26,7 @@
 #include "../Container/HashMap.h"
 #include "../Container/HashSet.h"
 #include "../Container/Ptr.h"
+#include "../IO/VectorBuffer.h"
 #include "../Math/StringHash.h"
 
 #include <cstring>
@@ -40,6 +41,7 @@ class Connection;
 class Node;
 class Scene;
 
+struct ReplicationSnapshot;
 struct ReplicationState;
 struct ComponentReplicationState;
 struct NodeReplicationState;
@@ -132,6 +134,32 @@ struct URHO3D_API NetworkState
     VariantMap previousVars_;
     /// Bitmask for intercepting network messages. Used on the client only.
     unsigned long long interceptMask_{};
+    /// Replication snapshot the encoded value ranges belong to.
+    const ReplicationSnapshot* snapshot_{};
+    /// Snapshot frame number the encoded value ranges are valid for.
+    unsigned snapshotFrame_{};
+    /// Index of the first encoded value range in the snapshot.
+    unsigned snapshotIndex_{};
+};
+
+/// Network attribute values of a scene encoded once per network update and shared by all connections.
+struct URHO3D_API ReplicationSnapshot
+{
+    /// Start a new network update, invalidating all encoded values.
+    void Clear()
+    {
+        data_.Clear();
+        ranges_.Clear();
+        if (++frameNumber_ == 0)
+            frameNumber_ = 1;
+    }
+
+    /// Encoded attribute data.
+    VectorBuffer data_;
+    /// Start and end offsets into the encoded data. Per object there is one range per network attribute, followed by the initial delta and latest data ranges.
+    PODVector<unsigned> ranges_;
+    /// Current frame number, never zero.
+    unsigned frameNumber_{1};
 };
 
 /// Base class for per-user network replication states.
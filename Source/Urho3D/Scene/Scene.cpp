@@ -35,6 +35,7 @@
 #include "../Resource/JSONFile.h"
 #include "../Scene/Component.h"
 #include "../Scene/ObjectAnimation.h"
+#include "../Scene/Prefab.h"
 #include "../Scene/ReplicationState.h"
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
@@ -54,6 +55,17 @@ const char* SUBSYSTEM_CATEGORY = "Subsystem";
 
 static const float DEFAULT_SMOOTHING_CONSTANT = 50.0f;
 static const float DEFAULT_SNAP_THRESHOLD = 5.0f;
+static const unsigned TRANSFORMS_PER_CHUNK = 256;
+static const PODVector<Component*> noComponents;
+
+static void ParseAsyncSceneFileWork(const WorkItem* item, unsigned threadIndex)
+{
+    auto* resource = reinterpret_cast<Resource*>(item->start_);
+    auto* file = reinterpret_cast<File*>(item->end_);
+    *reinterpret_cast<bool*>(item->aux_) = resource->BeginLoad(*file);
+    // Also calculate the checksum stored when loading finishes, as that reads the whole file again
+    file->GetChecksum();
+}
 
 Scene::Scene(Context* context) :
     Node(context),
@@ -69,8 +81,13 @@ Scene::Scene(Context* context) :
     snapThreshold_(DEFAULT_SNAP_THRESHOLD),
     updateEnabled_(true),
     asyncLoading_(false),
-    threadedUpdate_(false)
+    threadedUpdate_(false),
+    transformBatching_(false),
+    updatingTransforms_(false)
 {
+    transformState_.numQueued_ = 0;
+    transformState_.version_ = 0;
+
     // Assign an ID to self so that nodes can refer to this node as a parent
     SetID(GetFreeNodeID(REPLICATED));
     NodeAdded(this);
@@ -81,6 +98,17 @@ Scene::Scene(Context* context) :
 
 Scene::~Scene()
 {
+    StopAsyncLoading();
+
+    // Discard pending batched transform updates
+    for (Vector<WeakPtr<Node> >::ConstIterator i = queuedTransforms_.Begin(); i != queuedTransforms_.End(); ++i)
+    {
+        if (Node* node = *i)
+            node->transformQueued_ = false;
+    }
+    transformState_.numQueued_ -= queuedTransforms_.Size();
+    queuedTransforms_.Clear();
+
     // Remove root-level components first, so that scene subsystems such as the octree destroy themselves. This will speed up
     // the removal of child nodes' components
     RemoveAllComponents();
@@ -366,6 +394,8 @@ bool Scene::LoadAsync(File* file, LoadMode mode)
 
         // Then prepare to load child nodes in the async updates
         asyncProgress_.totalNodes_ = file->ReadVLE();
+        asyncProgress_.levels_.Resize(1);
+        asyncProgress_.levels_[0].childrenLeft_ = asyncProgress_.totalNodes_;
     }
     else
     {
@@ -389,62 +419,13 @@ bool Scene::LoadAsyncXML(File* file, LoadMode mode)
     StopAsyncLoading();
 
     SharedPtr<XMLFile> xml(new XMLFile(context_));
+    if (StartAsyncParsing(file, xml, mode))
+        return true;
+
     if (!xml->Load(*file))
         return false;
 
-    if (mode > LOAD_RESOURCES_ONLY)
-    {
-        URHO3D_LOGINFO("Loading scene from " + file->GetName());
-        Clear();
-    }
-
-    asyncLoading_ = true;
-    asyncProgress_.xmlFile_ = xml;
-    asyncProgress_.file_ = file;
-    asyncProgress_.mode_ = mode;
-    asyncProgress_.loadedNodes_ = asyncProgress_.totalNodes_ = asyncProgress_.loadedResources_ = asyncProgress_.totalResources_ = 0;
-    asyncProgress_.resources_.Clear();
-
-    if (mode > LOAD_RESOURCES_ONLY)
-    {
-        XMLElement rootElement = xml->GetRoot();
-
-        // Preload resources if appropriate
-        if (mode != LOAD_SCENE)
-        {
-            URHO3D_PROFILE(FindResourcesToPreload);
-
-            PreloadResourcesXML(rootElement);
-        }
-
-        // Store own old ID for resolving possible root node references
-        unsigned nodeID = rootElement.GetUInt("id");
-        resolver_.AddNode(nodeID, this);
-
-        // Load the root level components first
-        if (!Node::LoadXML(rootElement, resolver_, false))
-            return false;
-
-        // Then prepare for loading all root level child nodes in the async update
-        XMLElement childNodeElement = rootElement.GetChild("node");
-        asyncProgress_.xmlElement_ = childNodeElement;
-
-        // Count the amount of child nodes
-        while (childNodeElement)
-        {
-            ++asyncProgress_.totalNodes_;
-            childNodeElement = childNodeElement.GetNext("node");
-        }
-    }
-    else
-    {
-        URHO3D_PROFILE(FindResourcesToPreload);
-
-        URHO3D_LOGINFO("Preloading resources from " + file->GetName());
-        PreloadResourcesXML(xml->GetRoot());
-    }
-
-    return true;
+    return BeginAsyncLoadingXML(file, xml, mode);
 }
 
 bool Scene::LoadAsyncJSON(File* file, LoadMode mode)
@@ -458,68 +439,31 @@ bool Scene::LoadAsyncJSON(File* file, LoadMode mode)
     StopAsyncLoading();
 
     SharedPtr<JSONFile> json(new JSONFile(context_));
+    if (StartAsyncParsing(file, json, mode))
+        return true;
+
     if (!json->Load(*file))
         return false;
 
-    if (mode > LOAD_RESOURCES_ONLY)
-    {
-        URHO3D_LOGINFO("Loading scene from " + file->GetName());
-        Clear();
-    }
-
-    asyncLoading_ = true;
-    asyncProgress_.jsonFile_ = json;
-    asyncProgress_.file_ = file;
-    asyncProgress_.mode_ = mode;
-    asyncProgress_.loadedNodes_ = asyncProgress_.totalNodes_ = asyncProgress_.loadedResources_ = asyncProgress_.totalResources_ = 0;
-    asyncProgress_.resources_.Clear();
-
-    if (mode > LOAD_RESOURCES_ONLY)
-    {
-        JSONValue rootVal = json->GetRoot();
-
-        // Preload resources if appropriate
-        if (mode != LOAD_SCENE)
-        {
-            URHO3D_PROFILE(FindResourcesToPreload);
-
-            PreloadResourcesJSON(rootVal);
-        }
-
-        // Store own old ID for resolving possible root node references
-        unsigned nodeID = rootVal.Get("id").GetUInt();
-        resolver_.AddNode(nodeID, this);
-
-        // Load the root level components first
-        if (!Node::LoadJSON(rootVal, resolver_, false))
-            return false;
-
-        // Then prepare for loading all root level child nodes in the async update
-        JSONArray childrenArray = rootVal.Get("children").GetArray();
-        asyncProgress_.jsonIndex_ = 0;
-
-        // Count the amount of child nodes
-        asyncProgress_.totalNodes_ = childrenArray.Size();
-    }
-    else
-    {
-        URHO3D_PROFILE(FindResourcesToPreload);
-
-        URHO3D_LOGINFO("Preloading resources from " + file->GetName());
-        PreloadResourcesJSON(json->GetRoot());
-    }
-
-    return true;
+    return BeginAsyncLoadingJSON(file, json, mode);
 }
 
 void Scene::StopAsyncLoading()
 {
+    // The worker thread must not be left parsing a file that is about to be released
+    if (asyncProgress_.parseItem_)
+    {
+        auto* queue = GetSubsystem<WorkQueue>();
+        if (!queue->RemoveWorkItem(asyncProgress_.parseItem_))
+            queue->WaitFor(asyncProgress_.parseItem_);
+        asyncProgress_.parseItem_.Reset();
+    }
+
     asyncLoading_ = false;
     asyncProgress_.file_.Reset();
     asyncProgress_.xmlFile_.Reset();
     asyncProgress_.jsonFile_.Reset();
-    asyncProgress_.xmlElement_ = XMLElement::EMPTY;
-    asyncProgress_.jsonIndex_ = 0;
+    asyncProgress_.levels_.Clear();
     asyncProgress_.resources_.Clear();
     resolver_.Reset();
 }
@@ -668,6 +612,16 @@ void Scene::SetAsyncLoadingMs(int ms)
     asyncLoadingMs_ = Max(ms, 1);
 }
 
+void Scene::SetTransformBatching(bool enable)
+{
+    if (enable == transformBatching_)
+        return;
+
+    transformBatching_ = enable;
+    if (!enable)
+        UpdateTransforms();
+}
+
 void Scene::SetElapsedTime(float time)
 {
     elapsedTime_ = time;
@@ -730,8 +684,28 @@ Component* Scene::GetComponent(unsigned id) const
     }
 }
 
+const PODVector<Component*>& Scene::GetComponentsByType(StringHash type) const
+{
+    HashMap<StringHash, ComponentTypeIndex>::ConstIterator i = componentIndices_.Find(type);
+    return i != componentIndices_.End() ? i->second_.components_ : noComponents;
+}
+
+Component* Scene::GetNodeComponent(const Node* node, StringHash type) const
+{
+    HashMap<StringHash, ComponentTypeIndex>::ConstIterator i = componentIndices_.Find(type);
+    if (i == componentIndices_.End())
+        return nullptr;
+
+    FlatHashMap<const Node*, Component*>::ConstIterator j = i->second_.nodeComponents_.Find(node);
+    return j != i->second_.nodeComponents_.End() ? j->second_ : nullptr;
+}
+
 float Scene::GetAsyncProgress() const
 {
+    // Nothing is known of the content while the file is still being parsed
+    if (asyncProgress_.parseItem_)
+        return 0.0f;
+
     return !asyncLoading_ || asyncProgress_.totalNodes_ + asyncProgress_.totalResources_ == 0 ? 1.0f :
         (float)(asyncProgress_.loadedNodes_ + asyncProgress_.loadedResources_) /
         (float)(asyncProgress_.totalNodes_ + asyncProgress_.totalResources_);
@@ -762,15 +736,19 @@ void Scene::Update(float timeStep)
     VariantMap& eventData = GetEventDataMap();
     eventData[P_SCENE] = this;
     eventData[P_TIMESTEP] = timeStep;
+    SceneUpdatePayload payload{this, timeStep};
 
     // Update variable timestep logic
-    SendEvent(E_SCENEUPDATE, eventData);
+    SendTypedEvent(E_SCENEUPDATE, payload, eventData);
 
     // Update scene attribute animation.
-    SendEvent(E_ATTRIBUTEANIMATIONUPDATE, eventData);
+    SendTypedEvent(E_ATTRIBUTEANIMATIONUPDATE, payload, eventData);
+
+    // Apply batched transform changes, so that the subsystems see the moved nodes
+    UpdateTransforms();
 
     // Update scene subsystems. If a physics world is present, it will be updated, triggering fixed timestep logic updates
-    SendEvent(E_SCENESUBSYSTEMUPDATE, eventData);
+    SendTypedEvent(E_SCENESUBSYSTEMUPDATE, payload, eventData);
 
     // Update transform smoothing
     {
@@ -783,11 +761,14 @@ void Scene::Update(float timeStep)
 
         smoothingData_[P_CONSTANT] = constant;
         smoothingData_[P_SQUAREDSNAPTHRESHOLD] = squaredSnapThreshold;
-        SendEvent(E_UPDATESMOOTHING, smoothingData_);
+        UpdateSmoothingPayload smoothingPayload{constant, squaredSnapThreshold};
+        SendTypedEvent(E_UPDATESMOOTHING, smoothingPayload, smoothingData_);
     }
 
     // Post-update variable timestep logic
-    SendEvent(E_SCENEPOSTUPDATE, eventData);
+    SendTypedEvent(E_SCENEPOSTUPDATE, payload, eventData);
+
+    UpdateTransforms();
 
     // Note: using a float for elapsed time accumulation is inherently inaccurate. The purpose of this value is
     // primarily to update material animation effects, as it is available to shaders. It can be reset by calling
@@ -797,6 +778,9 @@ void Scene::Update(float timeStep)
 
 void Scene::BeginThreadedUpdate()
 {
+    // Worker threads read the world transforms, and the listener components must be notified from the main thread
+    UpdateTransforms();
+
     // Check the work queue subsystem whether it actually has created worker threads. If not, do not enter threaded mode.
     if (GetSubsystem<WorkQueue>()->GetNumThreads())
         threadedUpdate_ = true;
@@ -825,6 +809,120 @@ void Scene::DelayedMarkedDirty(Component* component)
     delayedDirtyComponents_.Push(component);
 }
 
+void Scene::UpdateTransforms()
+{
+    if (queuedTransforms_.Empty() || updatingTransforms_)
+        return;
+
+    URHO3D_PROFILE(UpdateTransforms);
+
+    updatingTransforms_ = true;
+    auto* queue = GetSubsystem<WorkQueue>();
+
+    // Notifying the listeners may move nodes again, which queues them for another round
+    while (!queuedTransforms_.Empty())
+    {
+        processedTransforms_.Swap(queuedTransforms_);
+        if (transformLevels_.Empty())
+            transformLevels_.Resize(1);
+
+        // Nodes with a queued ancestor are recalculated as part of the ancestor's subtree
+        PODVector<Node*>& roots = transformLevels_[0];
+        roots.Clear();
+        for (Vector<WeakPtr<Node> >::ConstIterator i = processedTransforms_.Begin(); i != processedTransforms_.End(); ++i)
+        {
+            Node* node = *i;
+            if (!node || node->scene_ != this)
+                continue;
+
+            Node* parent = node->parent_;
+            while (parent && !parent->transformQueued_)
+                parent = parent->parent_;
+            if (!parent)
+                roots.Push(node);
+        }
+
+        for (Vector<WeakPtr<Node> >::ConstIterator i = processedTransforms_.Begin(); i != processedTransforms_.End(); ++i)
+        {
+            Node* node = *i;
+            if (!node)
+                continue;
+
+            node->transformQueued_ = false;
+            // A node that left the scene while queued is marked dirty again in its current hierarchy
+            if (node->scene_ != this)
+            {
+                node->dirty_ = false;
+                node->MarkDirty();
+            }
+        }
+        transformState_.numQueued_ -= processedTransforms_.Size();
+        processedTransforms_.Clear();
+
+        // Collect the subtrees level by level. Nodes on the same level only depend on the already calculated previous level
+        unsigned numLevels = 1;
+        for (;;)
+        {
+            if (transformLevels_.Size() <= numLevels)
+                transformLevels_.Resize(numLevels + 1);
+
+            const PODVector<Node*>& parents = transformLevels_[numLevels - 1];
+            PODVector<Node*>& children = transformLevels_[numLevels];
+            children.Clear();
+            for (PODVector<Node*>::ConstIterator i = parents.Begin(); i != parents.End(); ++i)
+            {
+                const Vector<SharedPtr<Node> >& nodeChildren = (*i)->children_;
+                for (Vector<SharedPtr<Node> >::ConstIterator j = nodeChildren.Begin(); j != nodeChildren.End(); ++j)
+                    children.Push(*j);
+            }
+
+            if (children.Empty())
+                break;
+            ++numLevels;
+        }
+
+        // Adding levels may have reallocated the root level
+        const PODVector<Node*>& subtreeRoots = transformLevels_[0];
+        for (PODVector<Node*>::ConstIterator i = subtreeRoots.Begin(); i != subtreeRoots.End(); ++i)
+        {
+            (*i)->dirty_ = true;
+            (*i)->UpdateWorldTransform();
+        }
+
+        for (unsigned level = 1; level < numLevels; ++level)
+        {
+            const PODVector<Node*>& nodes = transformLevels_[level];
+            queue->ParallelFor(0, nodes.Size(), TRANSFORMS_PER_CHUNK, [&nodes](unsigned start, unsigned end, unsigned threadIndex)
+            {
+                for (unsigned i = start; i < end; ++i)
+                    nodes[i]->CalculateWorldTransform();
+            });
+        }
+
+        // Notify the listeners in hierarchy order from the main thread, like immediate dirty marking would
+        for (unsigned level = 0; level < numLevels; ++level)
+        {
+            const PODVector<Node*>& nodes = transformLevels_[level];
+            for (PODVector<Node*>::ConstIterator i = nodes.Begin(); i != nodes.End(); ++i)
+                (*i)->NotifyListeners();
+        }
+    }
+
+    updatingTransforms_ = false;
+}
+
+void Scene::QueueTransformUpdate(Node* node)
+{
+    // Any change invalidates the world transforms calculated through queued ancestors, even if the node was queued already
+    ++transformState_.version_;
+    if (node->transformQueued_)
+        return;
+
+    node->transformQueued_ = true;
+    queuedTransforms_.Push(WeakPtr<Node>(node));
+    ++transformState_.numQueued_;
+}
+
 unsigned Scene::GetFreeNodeID(CreateMode mode)
 {
     if (mode == REPLICATED)
@@ -1006,6 +1104,18 @@ void Scene::ComponentAdded(Component* component)
         localComponents_[id] = component;
     }
 
+    if (component->typeIndex_ == M_MAX_UNSIGNED)
+    {
+        ComponentTypeIndex& index = componentIndices_[component->GetType()];
+        component->typeIndex_ = index.components_.Size();
+        index.components_.Push(component);
+
+        // Node::GetComponent() returns the first component of the type, so keep an already registered one
+        Node* node = component->GetNode();
+        if (node && !index.nodeComponents_.Contains(node))
+            index.nodeComponents_[node] = component;
+    }
+
     component->OnSceneSet(this);
 }
 
@@ -1020,10 +1130,67 @@ void Scene::ComponentRemoved(Component* component)
     else
         localComponents_.Erase(id);
 
+    if (component->typeIndex_ != M_MAX_UNSIGNED)
+    {
+        HashMap<StringHash, ComponentTypeIndex>::Iterator i = componentIndices_.Find(component->GetType());
+        if (i != componentIndices_.End())
+        {
+            // Move the last component of the type into the vacated slot
+            ComponentTypeIndex& index = i->second_;
+            Component* last = index.components_.Back();
+            index.components_[component->typeIndex_] = last;
+            last->typeIndex_ = component->typeIndex_;
+            index.components_.Pop();
+            component->typeIndex_ = M_MAX_UNSIGNED;
+
+            Node* node = component->GetNode();
+            FlatHashMap<const Node*, Component*>::Iterator j = index.nodeComponents_.Find(node);
+            if (j != index.nodeComponents_.End() && j->second_ == component)
+            {
+                index.nodeComponents_.Erase(j);
+                UpdateNodeComponent(index, node, component->GetType());
+            }
+        }
+        else
+            component->typeIndex_ = M_MAX_UNSIGNED;
+    }
+
     component->SetID(0);
     component->OnSceneSet(nullptr);
 }
 
+void Scene::ComponentReordered(Component* component)
+{
+    if (!component || component->typeIndex_ == M_MAX_UNSIGNED)
+        return;
+
+    HashMap<StringHash, ComponentTypeIndex>::Iterator i = componentIndices_.Find(component->GetType());
+    if (i != componentIndices_.End())
+    {
+        Node* node = component->GetNode();
+        i->second_.nodeComponents_.Erase(node);
+        UpdateNodeComponent(i->second_, node, component->GetType());
+    }
+}
+
+void Scene::UpdateNodeComponent(ComponentTypeIndex& index, Node* node, StringHash type)
+{
+    if (!node)
+        return;
+
+    // Only components still registered in the scene qualify, as a removed node unregisters its components one by one
+    const Vector<SharedPtr<Component> >& components = node->GetComponents();
+    for (Vector<SharedPtr<Component> >::ConstIterator i = components.Begin(); i != components.End(); ++i)
+    {
+        Component* component = *i;
+        if (component->typeIndex_ != M_MAX_UNSIGNED && component->GetType() == type)
+        {
+            index.nodeComponents_[node] = component;
+            return;
+        }
+    }
+}
+
 void Scene::SetVarNamesAttr(const String& value)
 {
     Vector<String> varNames = value.Split(';');
@@ -1050,6 +1217,9 @@ String Scene::GetVarNamesAttr() const
 
 void Scene::PrepareNetworkUpdate()
 {
+    // Attribute values may change below, so previously encoded values can no longer be shared
+    replicationSnapshot_.Clear();
+
     for (HashSet<unsigned>::Iterator i = networkUpdateNodes_.Begin(); i != networkUpdateNodes_.End(); ++i)
     {
         Node* node = GetNode(*i);
@@ -1145,10 +1315,245 @@ void Scene::HandleResourceBackgroundLoaded(StringHash eventType, VariantMap& eve
     }
 }
 
+bool Scene::StartAsyncParsing(File* file, Resource* resource, LoadMode mode)
+{
+    auto* queue = GetSubsystem<WorkQueue>();
+    if (!queue || !queue->GetNumThreads())
+        return false;
+
+    asyncLoading_ = true;
+    asyncProgress_.file_ = file;
+    asyncProgress_.mode_ = mode;
+    asyncProgress_.loadedNodes_ = asyncProgress_.totalNodes_ = asyncProgress_.loadedResources_ = asyncProgress_.totalResources_ = 0;
+    asyncProgress_.resources_.Clear();
+    if (resource->GetType() == XMLFile::GetTypeStatic())
+        asyncProgress_.xmlFile_ = static_cast<XMLFile*>(resource);
+    else
+        asyncProgress_.jsonFile_ = static_cast<JSONFile*>(resource);
+
+    // Parse at the lowest priority, so that frame-critical work is not delayed. The scene keeps its old content until the file
+    // has been parsed. The item is polled across frames, so it must not come from the pool: the queue would reset and reuse
+    // a pooled item as soon as it purges it after completion
+    SharedPtr<WorkItem> item(new WorkItem());
+    item->workFunction_ = ParseAsyncSceneFileWork;
+    item->start_ = resource;
+    item->end_ = file;
+    item->aux_ = &asyncProgress_.parseSuccess_;
+    item->priority_ = 0;
+    asyncProgress_.parseItem_ = item;
+    resource->SetAsyncLoadState(ASYNC_LOADING);
+    queue->AddWorkItem(item);
+
+    return true;
+}
+
+void Scene::FinishAsyncParsing()
+{
+    // Beginning the load clears the scene and the async progress, so hold on to the parsed file
+    SharedPtr<File> file = asyncProgress_.file_;
+    SharedPtr<XMLFile> xml = asyncProgress_.xmlFile_;
+    SharedPtr<JSONFile> json = asyncProgress_.jsonFile_;
+    Resource* resource = xml ? static_cast<Resource*>(xml) : static_cast<Resource*>(json);
+    LoadMode mode = asyncProgress_.mode_;
+    asyncProgress_.parseItem_.Reset();
+
+    bool success = asyncProgress_.parseSuccess_;
+    resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
+    if (success)
+        success = resource->EndLoad();
+    resource->SetAsyncLoadState(ASYNC_DONE);
+
+    if (success)
+        success = xml ? BeginAsyncLoadingXML(file, xml, mode) : BeginAsyncLoadingJSON(file, json, mode);
+
+    if (!success)
+    {
+        URHO3D_LOGERROR("Failed to load scene from " + file->GetName());
+        StopAsyncLoading();
+    }
+}
+
+bool Scene::BeginAsyncLoadingXML(File* file, XMLFile* xml, LoadMode mode)
+{
+    if (mode > LOAD_RESOURCES_ONLY)
+    {
+        URHO3D_LOGINFO("Loading scene from " + file->GetName());
+        Clear();
+    }
+
+    asyncLoading_ = true;
+    asyncProgress_.xmlFile_ = xml;
+    asyncProgress_.file_ = file;
+    asyncProgress_.mode_ = mode;
+    asyncProgress_.loadedNodes_ = asyncProgress_.totalNodes_ = asyncProgress_.loadedResources_ = asyncProgress_.totalResources_ = 0;
+    asyncProgress_.resources_.Clear();
+
+    if (mode > LOAD_RESOURCES_ONLY)
+    {
+        XMLElement rootElement = xml->GetRoot();
+
+        // Preload resources if appropriate
+        if (mode != LOAD_SCENE)
+        {
+            URHO3D_PROFILE(FindResourcesToPreload);
+
+            PreloadResourcesXML(rootElement);
+        }
+
+        // Store own old ID for resolving possible root node references
+        unsigned nodeID = rootElement.GetUInt("id");
+        resolver_.AddNode(nodeID, this);
+
+        // Load the root level components first
+        if (!Node::LoadXML(rootElement, resolver_, false))
+            return false;
+
+        // Then prepare for loading all root level child nodes in the async update
+        XMLElement childNodeElement = rootElement.GetChild("node");
+        asyncProgress_.levels_.Resize(1);
+        asyncProgress_.levels_[0].xmlElement_ = childNodeElement;
+
+        // Count the amount of child nodes
+        while (childNodeElement)
+        {
+            ++asyncProgress_.totalNodes_;
+            childNodeElement = childNodeElement.GetNext("node");
+        }
+    }
+    else
+    {
+        URHO3D_PROFILE(FindResourcesToPreload);
+
+        URHO3D_LOGINFO("Preloading resources from " + file->GetName());
+        PreloadResourcesXML(xml->GetRoot());
+    }
+
+    return true;
+}
+
+bool Scene::BeginAsyncLoadingJSON(File* file, JSONFile* json, LoadMode mode)
+{
+    if (mode > LOAD_RESOURCES_ONLY)
+    {
+        URHO3D_LOGINFO("Loading scene from " + file->GetName());
+        Clear();
+    }
+
+    asyncLoading_ = true;
+    asyncProgress_.jsonFile_ = json;
+    asyncProgress_.file_ = file;
+    asyncProgress_.mode_ = mode;
+    asyncProgress_.loadedNodes_ = asyncProgress_.totalNodes_ = asyncProgress_.loadedResources_ = asyncProgress_.totalResources_ = 0;
+    asyncProgress_.resources_.Clear();
+
+    if (mode > LOAD_RESOURCES_ONLY)
+    {
+        const JSONValue& rootVal = json->GetRoot();
+
+        // Preload resources if appropriate
+        if (mode != LOAD_SCENE)
+        {
+            URHO3D_PROFILE(FindResourcesToPreload);
+
+            PreloadResourcesJSON(rootVal);
+        }
+
+        // Store own old ID for resolving possible root node references
+        unsigned nodeID = rootVal.Get("id").GetUInt();
+        resolver_.AddNode(nodeID, this);
+
+        // Load the root level components first
+        if (!Node::LoadJSON(rootVal, resolver_, false))
+            return false;
+
+        // Then prepare for loading all root level child nodes in the async update
+        const JSONArray& childrenArray = rootVal.Get("children").GetArray();
+        asyncProgress_.levels_.Resize(1);
+        asyncProgress_.levels_[0].jsonArray_ = &childrenArray;
+        asyncProgress_.levels_[0].jsonIndex_ = 0;
+
+        // Count the amount of child nodes
+        asyncProgress_.totalNodes_ = childrenArray.Size();
+    }
+    else
+    {
+        URHO3D_PROFILE(FindResourcesToPreload);
+
+        URHO3D_LOGINFO("Preloading resources from " + file->GetName());
+        PreloadResourcesJSON(json->GetRoot());
+    }
+
+    return true;
+}
+
+bool Scene::LoadAsyncChildNode(AsyncLoadLevel& level)
+{
+    Node* parent = level.node_ ? level.node_.Get() : this;
+
+    AsyncLoadLevel childLevel;
+    childLevel.childrenLeft_ = 0;
+    childLevel.jsonArray_ = nullptr;
+    childLevel.jsonIndex_ = 0;
+
+    // Load the node itself and queue its child nodes, so that the time limit can be checked inside deep hierarchies
+    if (asyncProgress_.xmlFile_)
+    {
+        XMLElement element = level.xmlElement_;
+        if (!element)
+            return false;
+        level.xmlElement_ = element.GetNext("node");
+
+        unsigned nodeID = element.GetUInt("id");
+        Node* newNode = parent->CreateChild(nodeID, IsReplicatedID(nodeID) ? REPLICATED : LOCAL);
+        resolver_.AddNode(nodeID, newNode);
+        newNode->LoadXML(element, resolver_, false);
+        childLevel.node_ = newNode;
+        childLevel.xmlElement_ = element.GetChild("node");
+    }
+    else if (asyncProgress_.jsonFile_)
+    {
+        if (level.jsonIndex_ >= level.jsonArray_->Size())
+            return false;
+        const JSONValue& value = level.jsonArray_->At(level.jsonIndex_++);
+
+        unsigned nodeID = value.Get("id").GetUInt();
+        Node* newNode = parent->CreateChild(nodeID, IsReplicatedID(nodeID) ? REPLICATED : LOCAL);
+        resolver_.AddNode(nodeID, newNode);
+        newNode->LoadJSON(value, resolver_, false);
+        childLevel.node_ = newNode;
+        childLevel.jsonArray_ = &value.Get("children").GetArray();
+    }
+    else
+    {
+        if (!level.childrenLeft_)
+            return false;
+        --level.childrenLeft_;
+
+        unsigned nodeID = asyncProgress_.file_->ReadUInt();
+        Node* newNode = parent->CreateChild(nodeID, IsReplicatedID(nodeID) ? REPLICATED : LOCAL);
+        resolver_.AddNode(nodeID, newNode);
+        newNode->Load(*asyncProgress_.file_, resolver_, false);
+        childLevel.node_ = newNode;
+        childLevel.childrenLeft_ = asyncProgress_.file_->ReadVLE();
+    }
+
+    // Note: invalidates the level reference
+    asyncProgress_.levels_.Push(childLevel);
+    return true;
+}
+
 void Scene::UpdateAsyncLoading()
 {
     URHO3D_PROFILE(UpdateAsyncLoading);
 
+    // Wait for the file to be parsed in a worker thread
+    if (asyncProgress_.parseItem_)
+    {
+        if (asyncProgress_.parseItem_->completed_)
+            FinishAsyncParsing();
+        return;
+    }
+
     // If resources left to load, do not load nodes yet
     if (asyncProgress_.loadedResources_ < asyncProgress_.totalResources_)
         return;
@@ -1157,43 +1562,22 @@ void Scene::UpdateAsyncLoading()
 
     for (;;)
     {
-        if (asyncProgress_.loadedNodes_ >= asyncProgress_.totalNodes_)
+        if (asyncProgress_.levels_.Empty())
         {
             FinishAsyncLoading();
             return;
         }
 
-
-        // Read one child node with its full sub-hierarchy either from binary, JSON, or XML
-        /// \todo Works poorly in scenes where one root-level child node contains all content
-        if (asyncProgress_.xmlFile_)
-        {
-            unsigned nodeID = asyncProgress_.xmlElement_.GetUInt("id");
-            Node* newNode = CreateChild(nodeID, IsReplicatedID(nodeID) ? REPLICATED : LOCAL);
-            resolver_.AddNode(nodeID, newNode);
-            newNode->LoadXML(asyncProgress_.xmlElement_, resolver_);
-            asyncProgress_.xmlElement_ = asyncProgress_.xmlElement_.GetNext("node");
-        }
-        else if (asyncProgress_.jsonFile_) // Load from JSON
+        // Load child nodes one at a time either from binary, JSON, or XML, depth first
+        if (!LoadAsyncChildNode(asyncProgress_.levels_.Back()))
         {
-            const JSONValue& childValue = asyncProgress_.jsonFile_->GetRoot().Get("children").GetArray().At(asyncProgress_.jsonIndex_);
-
-            unsigned nodeID =childValue.Get("id").GetUInt();
-            Node* newNode = CreateChild(nodeID, IsReplicatedID(nodeID) ? REPLICATED : LOCAL);
-            resolver_.AddNode(nodeID, newNode);
-            newNode->LoadJSON(childValue, resolver_);
-            ++asyncProgress_.jsonIndex_;
-        }
-        else // Load from binary
-        {
-            unsigned nodeID = asyncProgress_.file_->ReadUInt();
-            Node* newNode = CreateChild(nodeID, IsReplicatedID(nodeID) ? REPLICATED : LOCAL);
-            resolver_.AddNode(nodeID, newNode);
-            newNode->Load(*asyncProgress_.file_, resolver_);
+            asyncProgress_.levels_.Pop();
+            // Progress is reported in root level child nodes with their full sub-hierarchy
+            if (asyncProgress_.levels_.Size() == 1)
+                ++asyncProgress_.loadedNodes_;
+            continue;
         }
 
-        ++asyncProgress_.loadedNodes_;
-
         // Break if time limit exceeded, so that we keep sufficient FPS
         if (asyncLoadTimer.GetUSec(false) >= asyncLoadingMs_ * 1000LL)
             break;
@@ -1491,6 +1875,7 @@ void RegisterSceneLibrary(Context* context)
 {
     ValueAnimation::RegisterObject(context);
     ObjectAnimation::RegisterObject(context);
+    Prefab::RegisterObject(context);
     Node::RegisterObject(context);
     Scene::RegisterObject(context);
     SmoothedTransform::RegisterObject(context);
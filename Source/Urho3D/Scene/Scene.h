@@ -24,11 +24,14 @@
 
 #pragma once
 
+#include "../Container/FlatHashMap.h"
 #include "../Container/HashSet.h"
 #include "../Core/Mutex.h"
+#include "../Core/WorkQueue.h"
 #include "../Resource/XMLElement.h"
 #include "../Resource/JSONFile.h"
 #include "../Scene/Node.h"
+#include "../Scene/ReplicationState.h"
 #include "../Scene/SceneResolver.h"
 
 namespace Urho3D
@@ -53,6 +56,21 @@ enum LoadMode
     LOAD_SCENE_AND_RESOURCES
 };
 
+/// Node whose child nodes are being loaded asynchronously.
+struct AsyncLoadLevel
+{
+    /// Parent node, or null for the scene itself. Held so that a node removed during loading still consumes its child node data.
+    SharedPtr<Node> node_;
+    /// Child nodes left to load for binary mode.
+    unsigned childrenLeft_;
+    /// Next child node element for XML mode.
+    XMLElement xmlElement_;
+    /// Child node array for JSON mode.
+    const JSONArray* jsonArray_;
+    /// Next child node index for JSON mode.
+    unsigned jsonIndex_;
+};
+
 /// Asynchronous loading progress of a scene.
 struct AsyncProgress
 {
@@ -63,11 +81,13 @@ struct AsyncProgress
     /// JSON file for JSON mode
     SharedPtr<JSONFile> jsonFile_;
 
-    /// Current XML element for XML mode.
-    XMLElement xmlElement_;
+    /// Work item parsing the XML or JSON file in a worker thread.
+    SharedPtr<WorkItem> parseItem_;
+    /// Worker thread parse result.
+    bool parseSuccess_;
 
-    /// Current JSON child array and for JSON mode
-    unsigned jsonIndex_;
+    /// Nodes whose child nodes are being loaded, innermost last.
+    Vector<AsyncLoadLevel> levels_;
 
     /// Current load mode.
     LoadMode mode_;
@@ -83,6 +103,15 @@ struct AsyncProgress
     unsigned totalNodes_;
 };
 
+/// Components of one type in a scene.
+struct ComponentTypeIndex
+{
+    /// Components in no particular order.
+    PODVector<Component*> components_;
+    /// First component of the type by node.
+    FlatHashMap<const Node*, Component*> nodeComponents_;
+};
+
 /// Root scene node, represents the whole scene.
 class URHO3D_API Scene : public Node
 {
@@ -156,6 +185,8 @@ public:
     void SetSnapThreshold(float threshold);
     /// Set maximum milliseconds per frame to spend on async scene loading.
     void SetAsyncLoadingMs(int ms);
+    /// Set whether node transform changes are batched. When enabled, moving a node only queues it, and the world transforms of the queued subtrees are recalculated level by level, in worker threads if available, by UpdateTransforms(). Disabling performs any pending update.
+    void SetTransformBatching(bool enable);
     /// Add a required package file for networking. To be called on the server.
     void AddRequiredPackageFile(PackageFile* package);
     /// Clear required package files.
@@ -171,6 +202,14 @@ public:
     Node* GetNode(unsigned id) const;
     /// Return component from the whole scene by ID, or null if not found.
     Component* GetComponent(unsigned id) const;
+    /// Return all components of a type in the scene, in no particular order. Adding or removing components of the type invalidates the array contents.
+    const PODVector<Component*>& GetComponentsByType(StringHash type) const;
+    /// Return the first component of a type in a node of this scene without scanning the node's components, or null if none.
+    Component* GetNodeComponent(const Node* node, StringHash type) const;
+    /// Template version of returning all components of a type in the scene. The components are copied to the destination vector.
+    template <class T> void GetComponentsByType(PODVector<T*>& dest) const;
+    /// Template version of returning the first component of a type in a node of this scene.
+    template <class T> T* GetNodeComponent(const Node* node) const;
 
     /// Return whether updates are enabled.
     bool IsUpdateEnabled() const { return updateEnabled_; }
@@ -205,6 +244,11 @@ public:
     /// Return maximum milliseconds per frame to spend on async loading.
     int GetAsyncLoadingMs() const { return asyncLoadingMs_; }
 
+    /// Return whether node transform changes are batched.
+    bool IsTransformBatching() const { return transformBatching_; }
+    /// Return the batched transform update state.
+    const SceneTransformState& GetTransformState() const { return transformState_; }
+
     /// Return required package files.
     const Vector<SharedPtr<PackageFile> >& GetRequiredPackageFiles() const { return requiredPackageFiles_; }
 
@@ -219,6 +263,10 @@ public:
     void EndThreadedUpdate();
     /// Add a component to the delayed dirty notify queue. Is thread-safe.
     void DelayedMarkedDirty(Component* component);
+    /// Recalculate the world transforms of nodes queued by batched transform changes, then notify their listener components. Called during scene update and before octree update.
+    void UpdateTransforms();
+    /// Queue a node for the batched transform update, or record a further change if already queued. Called by Node.
+    void QueueTransformUpdate(Node* node);
 
     /// Return threaded update flag.
     bool IsThreadedUpdate() const { return threadedUpdate_; }
@@ -238,12 +286,16 @@ public:
     void ComponentAdded(Component* component);
     /// Component removed. Remove from ID map.
     void ComponentRemoved(Component* component);
+    /// Component moved within its node. Update the first component of its type for the node.
+    void ComponentReordered(Component* component);
     /// Set node user variable reverse mappings.
     void SetVarNamesAttr(const String& value);
     /// Return node user variable reverse mappings.
     String GetVarNamesAttr() const;
     /// Prepare network update by comparing attributes and marking replication states dirty as necessary.
     void PrepareNetworkUpdate();
+    /// Return the encoded attribute values shared by all connections during the current network update.
+    ReplicationSnapshot& GetReplicationSnapshot() { return replicationSnapshot_; }
     /// Clean up all references to a network connection that is about to be removed.
     void CleanupConnection(Connection* connection);
     /// Mark a node for attribute check on the next network update.
@@ -258,6 +310,16 @@ private:
     void HandleUpdate(StringHash eventType, VariantMap& eventData);
     /// Handle a background loaded resource completing.
     void HandleResourceBackgroundLoaded(StringHash eventType, VariantMap& eventData);
+    /// Start parsing an XML or JSON file for asynchronous loading in a worker thread. Return false if there are no worker threads.
+    bool StartAsyncParsing(File* file, Resource* resource, LoadMode mode);
+    /// Finish parsing in a worker thread and begin loading the parsed file.
+    void FinishAsyncParsing();
+    /// Begin asynchronous loading from a parsed XML file. Return true if successful.
+    bool BeginAsyncLoadingXML(File* file, XMLFile* xml, LoadMode mode);
+    /// Begin asynchronous loading from a parsed JSON file. Return true if successful.
+    bool BeginAsyncLoadingJSON(File* file, JSONFile* json, LoadMode mode);
+    /// Load one child node without its children from the innermost level of asynchronous loading. Return false if no child nodes are left on the level.
+    bool LoadAsyncChildNode(AsyncLoadLevel& level);
     /// Update asynchronous loading.
     void UpdateAsyncLoading();
     /// Finish asynchronous loading.
@@ -272,6 +334,8 @@ private:
     void PreloadResourcesXML(const XMLElement& element);
     /// Preload resources from a JSON scene or object prefab file.
     void PreloadResourcesJSON(const JSONValue& value);
+    /// Set the first registered component of a type in a node.
+    void UpdateNodeComponent(ComponentTypeIndex& index, Node* node, StringHash type);
 
     /// Replicated scene nodes by ID.
     HashMap<unsigned, Node*> replicatedNodes_;
@@ -281,6 +345,8 @@ private:
     HashMap<unsigned, Component*> replicatedComponents_;
     /// Local components by ID.
     HashMap<unsigned, Component*> localComponents_;
+    /// Components by type.
+    HashMap<StringHash, ComponentTypeIndex> componentIndices_;
     /// Asynchronous loading progress.
     AsyncProgress asyncProgress_;
     /// Node and component ID resolver for asynchronous loading.
@@ -295,10 +361,20 @@ private:
     HashSet<unsigned> networkUpdateNodes_;
     /// Components to check for attribute changes on the next network update.
     HashSet<unsigned> networkUpdateComponents_;
+    /// Encoded attribute values shared by all connections during a network update.
+    ReplicationSnapshot replicationSnapshot_;
     /// Delayed dirty notification queue for components.
     PODVector<Component*> delayedDirtyComponents_;
     /// Mutex for the delayed dirty notification queue.
     Mutex sceneMutex_;
+    /// Nodes queued for the batched transform update.
+    Vector<WeakPtr<Node> > queuedTransforms_;
+    /// Nodes being processed by the batched transform update.
+    Vector<WeakPtr<Node> > processedTransforms_;
+    /// Hierarchy levels of the batched transform update, starting from the roots of the queued subtrees.
+    Vector<PODVector<Node*> > transformLevels_;
+    /// Batched transform update state.
+    SceneTransformState transformState_;
     /// Preallocated event data map for smoothing update events.
     VariantMap smoothingData_;
     /// Next free non-local node ID.
@@ -327,8 +403,25 @@ private:
     bool asyncLoading_;
     /// Threaded update flag.
     bool threadedUpdate_;
+    /// Batched transform changes flag.
+    bool transformBatching_;
+    /// Batched transform update in progress flag.
+    bool updatingTransforms_;
 };
 
+template <class T> void Scene::GetComponentsByType(PODVector<T*>& dest) const
+{
+    const PODVector<Component*>& components = GetComponentsByType(T::GetTypeStatic());
+    dest.Resize(components.Size());
+    for (unsigned i = 0; i < components.Size(); ++i)
+        dest[i] = static_cast<T*>(components[i]);
+}
+
+template <class T> T* Scene::GetNodeComponent(const Node* node) const
+{
+    return static_cast<T*>(GetNodeComponent(node, T::GetTypeStatic()));
+}
+
 /// Register Scene library objects.
 void URHO3D_API RegisterSceneLibrary(Context* context);
 
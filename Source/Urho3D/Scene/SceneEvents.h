@@ -27,6 +27,8 @@
 namespace Urho3D
 {
 
+class Scene;
+
 /// Variable timestep scene update.
 URHO3D_EVENT(E_SCENEUPDATE, SceneUpdate)
 {
@@ -34,6 +36,17 @@ URHO3D_EVENT(E_SCENEUPDATE, SceneUpdate)
     URHO3D_PARAM(P_TIMESTEP, TimeStep);            // float
 }
 
+/// Typed payload of the scene update, attribute animation update, subsystem update and post-update events.
+struct SceneUpdatePayload
+{
+    URHO3D_EVENT_PAYLOAD(SceneUpdatePayload)
+
+    /// Scene.
+    Scene* scene_;
+    /// Timestep, scaled by the scene time scale.
+    float timeStep_;
+};
+
 /// Scene subsystem update.
 URHO3D_EVENT(E_SCENESUBSYSTEMUPDATE, SceneSubsystemUpdate)
 {
@@ -48,6 +61,17 @@ URHO3D_EVENT(E_UPDATESMOOTHING, UpdateSmoothing)
     URHO3D_PARAM(P_SQUAREDSNAPTHRESHOLD, SquaredSnapThreshold);  // float
 }
 
+/// Typed payload of the scene transform smoothing update.
+struct UpdateSmoothingPayload
+{
+    URHO3D_EVENT_PAYLOAD(UpdateSmoothingPayload)
+
+    /// Smoothing constant.
+    float constant_;
+    /// Squared snap threshold.
+    float squaredSnapThreshold_;
+};
+
 /// Scene drawable update finished. Custom animation (eg. IK) can be done at this point.
 URHO3D_EVENT(E_SCENEDRAWABLEUPDATEFINISHED, SceneDrawableUpdateFinished)
 {
@@ -296,6 +296,9 @@ bool Serializable::Load(Deserializer& source)
     if (!attributes)
         return true;
 
+    // Instance default values are stored as Variants, so they need the accessor path
+    const bool allowDirect = !setInstanceDefault_ && AllowDirectAttributeAccess();
+
     for (unsigned i = 0; i < attributes->Size(); ++i)
     {
         const AttributeInfo& attr = attributes->At(i);
@@ -308,8 +311,13 @@ bool Serializable::Load(Deserializer& source)
             return false;
         }
 
-        Variant varValue = source.ReadVariant(attr.type_);
-        OnSetAttribute(attr, varValue);
+        if (allowDirect && attr.accessor_ && attr.accessor_->IsDirect())
+            attr.accessor_->ReadDirect(this, source);
+        else
+        {
+            Variant varValue = source.ReadVariant(attr.type_);
+            OnSetAttribute(attr, varValue);
+        }
     }
 
     return true;
@@ -321,6 +329,7 @@ bool Serializable::Save(Serializer& dest) const
     if (!attributes)
         return true;
 
+    const bool allowDirect = AllowDirectAttributeAccess();
     Variant value;
 
     for (unsigned i = 0; i < attributes->Size(); ++i)
@@ -329,9 +338,16 @@ bool Serializable::Save(Serializer& dest) const
         if (!(attr.mode_ & AM_FILE) || (attr.mode_ & AM_FILEREADONLY) == AM_FILEREADONLY)
             continue;
 
-        OnGetAttribute(attr, value);
+        bool success;
+        if (allowDirect && attr.accessor_ && attr.accessor_->IsDirect())
+            success = attr.accessor_->WriteDirect(this, dest);
+        else
+        {
+            OnGetAttribute(attr, value);
+            success = dest.WriteVariantData(value);
+        }
 
-        if (!dest.WriteVariantData(value))
+        if (!success)
         {
             URHO3D_LOGERROR("Could not save " + GetTypeName() + ", writing to stream failed");
             return false;
@@ -734,7 +750,7 @@ void Serializable::AllocateNetworkState()
     }
 }
 
-void Serializable::WriteInitialDeltaUpdate(Serializer& dest, unsigned char timeStamp)
+void Serializable::WriteInitialDeltaUpdate(Serializer& dest, unsigned char timeStamp, ReplicationSnapshot* snapshot)
 {
     if (!networkState_)
     {
@@ -747,6 +763,15 @@ void Serializable::WriteInitialDeltaUpdate(Serializer& dest, unsigned char timeS
         return;
 
     unsigned numAttributes = attributes->Size();
+
+    if (snapshot)
+    {
+        const unsigned* range = GetSnapshotRange(*snapshot, numAttributes);
+        dest.WriteUByte(timeStamp);
+        dest.Write(snapshot->data_.GetData() + range[0], range[1] - range[0]);
+        return;
+    }
+
     DirtyBits attributeBits;
 
     // Compare against defaults
@@ -768,7 +793,8 @@ void Serializable::WriteInitialDeltaUpdate(Serializer& dest, unsigned char timeS
     }
 }
 
-void Serializable::WriteDeltaUpdate(Serializer& dest, const DirtyBits& attributeBits, unsigned char timeStamp)
+void Serializable::WriteDeltaUpdate(Serializer& dest, const DirtyBits& attributeBits, unsigned char timeStamp,
+    ReplicationSnapshot* snapshot)
 {
     if (!networkState_)
     {
@@ -790,11 +816,19 @@ void Serializable::WriteDeltaUpdate(Serializer& dest, const DirtyBits& attribute
     for (unsigned i = 0; i < numAttributes; ++i)
     {
         if (attributeBits.IsSet(i))
-            dest.WriteVariantData(networkState_->currentValues_[i]);
+        {
+            if (snapshot)
+            {
+                const unsigned* range = GetSnapshotRange(*snapshot, i);
+                dest.Write(snapshot->data_.GetData() + range[0], range[1] - range[0]);
+            }
+            else
+                dest.WriteVariantData(networkState_->currentValues_[i]);
+        }
     }
 }
 
-void Serializable::WriteLatestDataUpdate(Serializer& dest, unsigned char timeStamp)
+void Serializable::WriteLatestDataUpdate(Serializer& dest, unsigned char timeStamp, ReplicationSnapshot* snapshot)
 {
     if (!networkState_)
     {
@@ -810,6 +844,13 @@ void Serializable::WriteLatestDataUpdate(Serializer& dest, unsigned char timeSta
 
     dest.WriteUByte(timeStamp);
 
+    if (snapshot)
+    {
+        const unsigned* range = GetSnapshotRange(*snapshot, numAttributes + 1);
+        dest.Write(snapshot->data_.GetData() + range[0], range[1] - range[0]);
+        return;
+    }
+
     for (unsigned i = 0; i < numAttributes; ++i)
     {
         if (attributes->At(i).mode_ & AM_LATESTDATA)
@@ -817,6 +858,61 @@ void Serializable::WriteLatestDataUpdate(Serializer& dest, unsigned char timeSta
     }
 }
 
+const unsigned* Serializable::GetSnapshotRange(ReplicationSnapshot& snapshot, unsigned index)
+{
+    const Vector<AttributeInfo>* attributes = networkState_->attributes_;
+    unsigned numAttributes = attributes->Size();
+
+    // Reserve the object's ranges on first use during this network update
+    if (networkState_->snapshot_ != &snapshot || networkState_->snapshotFrame_ != snapshot.frameNumber_)
+    {
+        networkState_->snapshot_ = &snapshot;
+        networkState_->snapshotFrame_ = snapshot.frameNumber_;
+        networkState_->snapshotIndex_ = snapshot.ranges_.Size();
+        snapshot.ranges_.Resize(networkState_->snapshotIndex_ + (numAttributes + 2) * 2);
+        for (unsigned i = networkState_->snapshotIndex_; i < snapshot.ranges_.Size(); ++i)
+            snapshot.ranges_[i] = M_MAX_UNSIGNED;
+    }
+
+    unsigned* range = &snapshot.ranges_[networkState_->snapshotIndex_ + index * 2];
+    if (range[0] != M_MAX_UNSIGNED)
+        return range;
+
+    VectorBuffer& data = snapshot.data_;
+    range[0] = data.GetSize();
+
+    if (index < numAttributes)
+        data.WriteVariantData(networkState_->currentValues_[index]);
+    else if (index == numAttributes)
+    {
+        // Initial delta: bitfield of non-default attributes followed by their data
+        DirtyBits attributeBits;
+        for (unsigned i = 0; i < numAttributes; ++i)
+        {
+            if (networkState_->currentValues_[i] != attributes->At(i).defaultValue_)
+                attributeBits.Set(i);
+        }
+
+        data.Write(attributeBits.data_, (numAttributes + 7) >> 3u);
+        for (unsigned i = 0; i < numAttributes; ++i)
+        {
+            if (attributeBits.IsSet(i))
+                data.WriteVariantData(networkState_->currentValues_[i]);
+        }
+    }
+    else
+    {
+        for (unsigned i = 0; i < numAttributes; ++i)
+        {
+            if (attributes->At(i).mode_ & AM_LATESTDATA)
+                data.WriteVariantData(networkState_->currentValues_[i]);
+        }
+    }
+
+    range[1] = data.GetSize();
+    return range;
+}
+
 bool Serializable::ReadDeltaUpdate(Deserializer& source)
 {
     const Vector<AttributeInfo>* attributes = GetNetworkAttributes();
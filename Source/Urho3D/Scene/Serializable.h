@@ -24,6 +24,8 @@
 
 #include "../Core/Attribute.h"
 #include "../Core/Object.h"
+#include "../IO/Deserializer.h"
+#include "../IO/Serializer.h"
 
 #include <cstddef>
 
@@ -31,13 +33,12 @@ namespace Urho3D
 {
 
 class Connection;
-class Deserializer;
-class Serializer;
 class XMLElement;
 class JSONValue;
 
 struct DirtyBits;
 struct NetworkState;
+struct ReplicationSnapshot;
 struct ReplicationState;
 
 /// Base class for objects with automatic serialization through attributes.
@@ -78,6 +79,9 @@ public:
     /// Return whether should save default-valued attributes into XML. Default false.
     virtual bool SaveDefaultAttributes() const { return false; }
 
+    /// Return whether binary load and save may access typed attributes directly, bypassing OnSetAttribute() and OnGetAttribute(). Subclasses that intercept attribute access should return false.
+    virtual bool AllowDirectAttributeAccess() const { return true; }
+
     /// Mark for attribute check on the next network update.
     virtual void MarkNetworkUpdate() { }
 
@@ -97,12 +101,12 @@ public:
     void SetInterceptNetworkUpdate(const String& attributeName, bool enable);
     /// Allocate network attribute state.
     void AllocateNetworkState();
-    /// Write initial delta network update.
-    void WriteInitialDeltaUpdate(Serializer& dest, unsigned char timeStamp);
-    /// Write a delta network update according to dirty attribute bits.
-    void WriteDeltaUpdate(Serializer& dest, const DirtyBits& attributeBits, unsigned char timeStamp);
-    /// Write a latest data network update.
-    void WriteLatestDataUpdate(Serializer& dest, unsigned char timeStamp);
+    /// Write initial delta network update. When a snapshot is given, attribute values are encoded only once per network update and shared between connections.
+    void WriteInitialDeltaUpdate(Serializer& dest, unsigned char timeStamp, ReplicationSnapshot* snapshot = nullptr);
+    /// Write a delta network update according to dirty attribute bits. Optionally reuse encoded values from a snapshot.
+    void WriteDeltaUpdate(Serializer& dest, const DirtyBits& attributeBits, unsigned char timeStamp, ReplicationSnapshot* snapshot = nullptr);
+    /// Write a latest data network update. Optionally reuse encoded values from a snapshot.
+    void WriteLatestDataUpdate(Serializer& dest, unsigned char timeStamp, ReplicationSnapshot* snapshot = nullptr);
     /// Read and apply a network delta update. Return true if attributes were changed.
     bool ReadDeltaUpdate(Deserializer& source);
     /// Read and apply a network latest data update. Return true if attributes were changed.
@@ -139,6 +143,8 @@ private:
     void SetInstanceDefault(const String& name, const Variant& defaultValue);
     /// Get instance-level default value.
     Variant GetInstanceDefault(const String& name) const;
+    /// Return encoded value range of a network attribute, or of the initial delta / latest data when index is past the attributes. Encode into the snapshot if not done yet this network update.
+    const unsigned* GetSnapshotRange(ReplicationSnapshot& snapshot, unsigned index);
 
     /// Attribute default value at each instance level.
     UniquePtr<VariantMap> instanceDefaultValues_;
@@ -189,35 +195,140 @@ SharedPtr<AttributeAccessor> MakeVariantAttributeAccessor(TGetFunction getFuncti
     return SharedPtr<AttributeAccessor>(new VariantAttributeAccessorImpl<TClassType, TGetFunction, TSetFunction>(getFunction, setFunction));
 }
 
+/// Binary serialization of an attribute value type without conversion through Variant. The data layout matches Serializer::WriteVariantData(). Types that are not specialized always use the Variant path.
+template <class T> struct DirectAttributeTraits
+{
+    /// Whether the type can be serialized directly.
+    static const bool supported = false;
+    /// Read value. Never called for unsupported types.
+    static T Read(Deserializer& source) { return T(); }
+    /// Write value. Never called for unsupported types.
+    template <class U> static bool Write(Serializer& dest, const U& value) { return false; }
+};
+
+#define URHO3D_DIRECT_ATTRIBUTE_TRAITS(typeName, readFunction, writeFunction) template <> struct DirectAttributeTraits<typeName> \
+{ \
+    static const bool supported = true; \
+    static typeName Read(Deserializer& source) { return source.readFunction(); } \
+    static bool Write(Serializer& dest, const typeName& value) { return dest.writeFunction(value); } \
+}
+
+URHO3D_DIRECT_ATTRIBUTE_TRAITS(bool, ReadBool, WriteBool);
+URHO3D_DIRECT_ATTRIBUTE_TRAITS(int, ReadInt, WriteInt);
+URHO3D_DIRECT_ATTRIBUTE_TRAITS(unsigned, ReadUInt, WriteUInt);
+URHO3D_DIRECT_ATTRIBUTE_TRAITS(long long, ReadInt64, WriteInt64);
+URHO3D_DIRECT_ATTRIBUTE_TRAITS(unsigned long long, ReadUInt64, WriteUInt64);
+URHO3D_DIRECT_ATTRIBUTE_TRAITS(float, ReadFloat, WriteFloat);
+URHO3D_DIRECT_ATTRIBUTE_TRAITS(double, ReadDouble, WriteDouble);
+URHO3D_DIRECT_ATTRIBUTE_TRAITS(Vector2, ReadVector2, WriteVector2);
+URHO3D_DIRECT_ATTRIBUTE_TRAITS(Vector3, ReadVector3, WriteVector3);
+URHO3D_DIRECT_ATTRIBUTE_TRAITS(Vector4, ReadVector4, WriteVector4);
+URHO3D_DIRECT_ATTRIBUTE_TRAITS(IntVector2, ReadIntVector2, WriteIntVector2);
+URHO3D_DIRECT_ATTRIBUTE_TRAITS(IntVector3, ReadIntVector3, WriteIntVector3);
+URHO3D_DIRECT_ATTRIBUTE_TRAITS(IntRect, ReadIntRect, WriteIntRect);
+URHO3D_DIRECT_ATTRIBUTE_TRAITS(Quaternion, ReadQuaternion, WriteQuaternion);
+URHO3D_DIRECT_ATTRIBUTE_TRAITS(Color, ReadColor, WriteColor);
+URHO3D_DIRECT_ATTRIBUTE_TRAITS(Matrix3, ReadMatrix3, WriteMatrix3);
+URHO3D_DIRECT_ATTRIBUTE_TRAITS(Matrix3x4, ReadMatrix3x4, WriteMatrix3x4);
+URHO3D_DIRECT_ATTRIBUTE_TRAITS(Matrix4, ReadMatrix4, WriteMatrix4);
+URHO3D_DIRECT_ATTRIBUTE_TRAITS(String, ReadString, WriteString);
+
+#undef URHO3D_DIRECT_ATTRIBUTE_TRAITS
+
+/// Template implementation of a typed attribute accessor, which additionally supports direct binary serialization of the value.
+template <class TClassType, class TValueType, class TGetFunction, class TSetFunction, class TReadFunction, class TWriteFunction>
+class DirectAttributeAccessorImpl : public VariantAttributeAccessorImpl<TClassType, TGetFunction, TSetFunction>
+{
+public:
+    /// Construct.
+    DirectAttributeAccessorImpl(TGetFunction getFunction, TSetFunction setFunction, TReadFunction readFunction, TWriteFunction writeFunction) :
+        VariantAttributeAccessorImpl<TClassType, TGetFunction, TSetFunction>(getFunction, setFunction),
+        readFunction_(readFunction),
+        writeFunction_(writeFunction)
+    {
+    }
+
+    /// Return whether the value type supports direct serialization.
+    bool IsDirect() const override { return DirectAttributeTraits<TValueType>::supported; }
+
+    /// Invoke read function.
+    void ReadDirect(Serializable* ptr, Deserializer& source) override
+    {
+        assert(ptr);
+        auto classPtr = static_cast<TClassType*>(ptr);
+        readFunction_(*classPtr, source);
+    }
+
+    /// Invoke write function.
+    bool WriteDirect(const Serializable* ptr, Serializer& dest) const override
+    {
+        assert(ptr);
+        const auto classPtr = static_cast<const TClassType*>(ptr);
+        return writeFunction_(*classPtr, dest);
+    }
+
+private:
+    /// Read functor.
+    TReadFunction readFunction_;
+    /// Write functor.
+    TWriteFunction writeFunction_;
+};
+
+/// Make typed attribute accessor implementation.
+/// \tparam TClassType Serializable class type.
+/// \tparam TValueType Attribute value type, selects the DirectAttributeTraits used by the read and write functions.
+/// \tparam TGetFunction Functional object with call signature `void getFunction(const TClassType& self, Variant& value)`
+/// \tparam TSetFunction Functional object with call signature `void setFunction(TClassType& self, const Variant& value)`
+/// \tparam TReadFunction Functional object with call signature `void readFunction(TClassType& self, Deserializer& source)`
+/// \tparam TWriteFunction Functional object with call signature `bool writeFunction(const TClassType& self, Serializer& dest)`
+template <class TClassType, class TValueType, class TGetFunction, class TSetFunction, class TReadFunction, class TWriteFunction>
+SharedPtr<AttributeAccessor> MakeDirectAttributeAccessor(TGetFunction getFunction, TSetFunction setFunction, TReadFunction readFunction, TWriteFunction writeFunction)
+{
+    return SharedPtr<AttributeAccessor>(new DirectAttributeAccessorImpl<TClassType, TValueType, TGetFunction, TSetFunction, TReadFunction, TWriteFunction>(
+        getFunction, setFunction, readFunction, writeFunction));
+}
+
 /// Make member attribute accessor.
-#define URHO3D_MAKE_MEMBER_ATTRIBUTE_ACCESSOR(typeName, variable) Urho3D::MakeVariantAttributeAccessor<ClassName>( \
+#define URHO3D_MAKE_MEMBER_ATTRIBUTE_ACCESSOR(typeName, variable) Urho3D::MakeDirectAttributeAccessor<ClassName, typeName >( \
     [](const ClassName& self, Urho3D::Variant& value) { value = self.variable; }, \
-    [](ClassName& self, const Urho3D::Variant& value) { self.variable = value.Get<typeName>(); })
+    [](ClassName& self, const Urho3D::Variant& value) { self.variable = value.Get<typeName>(); }, \
+    [](ClassName& self, Urho3D::Deserializer& source) { self.variable = Urho3D::DirectAttributeTraits<typeName >::Read(source); }, \
+    [](const ClassName& self, Urho3D::Serializer& dest) { return Urho3D::DirectAttributeTraits<typeName >::Write(dest, self.variable); })
 
 /// Make member attribute accessor with custom post-set callback.
-#define URHO3D_MAKE_MEMBER_ATTRIBUTE_ACCESSOR_EX(typeName, variable, postSetCallback) Urho3D::MakeVariantAttributeAccessor<ClassName>( \
+#define URHO3D_MAKE_MEMBER_ATTRIBUTE_ACCESSOR_EX(typeName, variable, postSetCallback) Urho3D::MakeDirectAttributeAccessor<ClassName, typeName >( \
     [](const ClassName& self, Urho3D::Variant& value) { value = self.variable; }, \
-    [](ClassName& self, const Urho3D::Variant& value) { self.variable = value.Get<typeName>(); self.postSetCallback(); })
+    [](ClassName& self, const Urho3D::Variant& value) { self.variable = value.Get<typeName>(); self.postSetCallback(); }, \
+    [](ClassName& self, Urho3D::Deserializer& source) { self.variable = Urho3D::DirectAttributeTraits<typeName >::Read(source); self.postSetCallback(); }, \
+    [](const ClassName& self, Urho3D::Serializer& dest) { return Urho3D::DirectAttributeTraits<typeName >::Write(dest, self.variable); })
 
 /// Make get/set attribute accessor.
-#define URHO3D_MAKE_GET_SET_ATTRIBUTE_ACCESSOR(getFunction, setFunction, typeName) Urho3D::MakeVariantAttributeAccessor<ClassName>( \
+#define URHO3D_MAKE_GET_SET_ATTRIBUTE_ACCESSOR(getFunction, setFunction, typeName) Urho3D::MakeDirectAttributeAccessor<ClassName, typeName >( \
     [](const ClassName& self, Urho3D::Variant& value) { value = self.getFunction(); }, \
-    [](ClassName& self, const Urho3D::Variant& value) { self.setFunction(value.Get<typeName>()); })
+    [](ClassName& self, const Urho3D::Variant& value) { self.setFunction(value.Get<typeName>()); }, \
+    [](ClassName& self, Urho3D::Deserializer& source) { self.setFunction(Urho3D::DirectAttributeTraits<typeName >::Read(source)); }, \
+    [](const ClassName& self, Urho3D::Serializer& dest) { return Urho3D::DirectAttributeTraits<typeName >::Write(dest, self.getFunction()); })
 
 /// Make member enum attribute accessor
-#define URHO3D_MAKE_MEMBER_ENUM_ATTRIBUTE_ACCESSOR(variable) Urho3D::MakeVariantAttributeAccessor<ClassName>( \
+#define URHO3D_MAKE_MEMBER_ENUM_ATTRIBUTE_ACCESSOR(variable) Urho3D::MakeDirectAttributeAccessor<ClassName, int>( \
     [](const ClassName& self, Urho3D::Variant& value) { value = static_cast<int>(self.variable); }, \
-    [](ClassName& self, const Urho3D::Variant& value) { self.variable = static_cast<decltype(self.variable)>(value.Get<int>()); })
+    [](ClassName& self, const Urho3D::Variant& value) { self.variable = static_cast<decltype(self.variable)>(value.Get<int>()); }, \
+    [](ClassName& self, Urho3D::Deserializer& source) { self.variable = static_cast<decltype(self.variable)>(source.ReadInt()); }, \
+    [](const ClassName& self, Urho3D::Serializer& dest) { return dest.WriteInt(static_cast<int>(self.variable)); })
 
 /// Make member enum attribute accessor with custom post-set callback.
-#define URHO3D_MAKE_MEMBER_ENUM_ATTRIBUTE_ACCESSOR_EX(variable, postSetCallback) Urho3D::MakeVariantAttributeAccessor<ClassName>( \
+#define URHO3D_MAKE_MEMBER_ENUM_ATTRIBUTE_ACCESSOR_EX(variable, postSetCallback) Urho3D::MakeDirectAttributeAccessor<ClassName, int>( \
     [](const ClassName& self, Urho3D::Variant& value) { value = static_cast<int>(self.variable); }, \
-    [](ClassName& self, const Urho3D::Variant& value) { self.variable = static_cast<decltype(self.variable)>(value.Get<int>()); self.postSetCallback(); })
+    [](ClassName& self, const Urho3D::Variant& value) { self.variable = static_cast<decltype(self.variable)>(value.Get<int>()); self.postSetCallback(); }, \
+    [](ClassName& self, Urho3D::Deserializer& source) { self.variable = static_cast<decltype(self.variable)>(source.ReadInt()); self.postSetCallback(); }, \
+    [](const ClassName& self, Urho3D::Serializer& dest) { return dest.WriteInt(static_cast<int>(self.variable)); })
 
 /// Make get/set enum attribute accessor.
-#define URHO3D_MAKE_GET_SET_ENUM_ATTRIBUTE_ACCESSOR(getFunction, setFunction, typeName) Urho3D::MakeVariantAttributeAccessor<ClassName>( \
+#define URHO3D_MAKE_GET_SET_ENUM_ATTRIBUTE_ACCESSOR(getFunction, setFunction, typeName) Urho3D::MakeDirectAttributeAccessor<ClassName, int>( \
     [](const ClassName& self, Urho3D::Variant& value) { value = static_cast<int>(self.getFunction()); }, \
-    [](ClassName& self, const Urho3D::Variant& value) { self.setFunction(static_cast<typeName>(value.Get<int>())); })
+    [](ClassName& self, const Urho3D::Variant& value) { self.setFunction(static_cast<typeName>(value.Get<int>())); }, \
+    [](ClassName& self, Urho3D::Deserializer& source) { self.setFunction(static_cast<typeName>(source.ReadInt())); }, \
+    [](const ClassName& self, Urho3D::Serializer& dest) { return dest.WriteInt(static_cast<int>(self.getFunction())); })
 
 /// Attribute metadata.
 namespace AttributeMetadata
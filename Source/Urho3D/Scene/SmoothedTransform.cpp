@@ -171,6 +171,13 @@ void SmoothedTransform::HandleUpdateSmoothing(StringHash eventType, VariantMap&
 {
     using namespace UpdateSmoothing;
 
+    // Read the typed payload when sent by the scene, avoiding the event data map lookups per node
+    if (const UpdateSmoothingPayload* payload = GetEventPayload<UpdateSmoothingPayload>())
+    {
+        Update(payload->constant_, payload->squaredSnapThreshold_);
+        return;
+    }
+
     float constant = eventData[P_CONSTANT].GetFloat();
     float squaredSnapThreshold = eventData[P_SQUAREDSNAPTHRESHOLD].GetFloat();
     Update(constant, squaredSnapThreshold);
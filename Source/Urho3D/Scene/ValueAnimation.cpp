@@ -46,6 +46,20 @@ const char* interpMethodNames[] =
     nullptr
 };
 
+/// Append the event frames between a time range to a vector.
+template <class T> static void CollectEventFrames(const Vector<VAnimEventFrame>& frames, float beginTime, float endTime, T& eventFrames)
+{
+    for (unsigned i = 0; i < frames.Size(); ++i)
+    {
+        const VAnimEventFrame& eventFrame = frames[i];
+        if (eventFrame.time_ > endTime)
+            break;
+
+        if (eventFrame.time_ >= beginTime)
+            eventFrames.Push(&eventFrame);
+    }
+}
+
 ValueAnimation::ValueAnimation(Context* context) :
     Resource(context),
     owner_(nullptr),
@@ -360,15 +374,12 @@ Variant ValueAnimation::GetAnimationValue(float scaledTime) const
 
 void ValueAnimation::GetEventFrames(float beginTime, float endTime, PODVector<const VAnimEventFrame*>& eventFrames) const
 {
-    for (unsigned i = 0; i < eventFrames_.Size(); ++i)
-    {
-        const VAnimEventFrame& eventFrame = eventFrames_[i];
-        if (eventFrame.time_ > endTime)
-            break;
+    CollectEventFrames(eventFrames_, beginTime, endTime, eventFrames);
+}
 
-        if (eventFrame.time_ >= beginTime)
-            eventFrames.Push(&eventFrame);
-    }
+void ValueAnimation::GetEventFrames(float beginTime, float endTime, FramePODVector<const VAnimEventFrame*>& eventFrames) const
+{
+    CollectEventFrames(eventFrames_, beginTime, endTime, eventFrames);
 }
 
 Variant ValueAnimation::LinearInterpolation(unsigned index1, unsigned index2, float scaledTime) const
@@ -24,6 +24,7 @@
 
 #pragma once
 
+#include "../Core/FrameAllocator.h"
 #include "../Core/Variant.h"
 #include "../Resource/Resource.h"
 
@@ -136,6 +137,8 @@ public:
 
     /// Return all event frames between time.
     void GetEventFrames(float beginTime, float endTime, PODVector<const VAnimEventFrame*>& eventFrames) const;
+    /// Return all event frames between time range into a frame scratch vector.
+    void GetEventFrames(float beginTime, float endTime, FramePODVector<const VAnimEventFrame*>& eventFrames) const;
 
 protected:
     /// Linear interpolation.
@@ -34,6 +34,7 @@ class Object;
 class ValueAnimation;
 class Variant;
 struct VAnimEventFrame;
+template <class T> class FramePODVector;
 
 /// Base class for a value animation instance, which includes animation runtime information and updates the target object's value automatically.
 class URHO3D_API ValueAnimationInfo : public RefCounted
@@ -80,7 +81,7 @@ protected:
     /// Calculate scaled time.
     float CalculateScaledTime(float currentTime, bool& finished) const;
     /// Return event frames.
-    void GetEventFrames(float beginTime, float endTime, PODVector<const VAnimEventFrame*>& eventFrames);
+    void GetEventFrames(float beginTime, float endTime, FramePODVector<const VAnimEventFrame*>& eventFrames);
 
     /// Target object.
     WeakPtr<Object> target_;
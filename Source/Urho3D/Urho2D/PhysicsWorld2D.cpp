@@ -285,7 +285,7 @@ void PhysicsWorld2D::Update(float timeStep)
     VariantMap& eventData = GetEventDataMap();
     eventData[P_WORLD] = this;
     eventData[P_TIMESTEP] = timeStep;
-    SendEvent(E_PHYSICSPRESTEP, eventData);
+    SendTypedEvent(E_PHYSICSPRESTEP, PhysicsStepPayload{this, timeStep}, eventData);
 
     physicsStepping_ = true;
     world_->Step(timeStep, velocityIterations_, positionIterations_);
@@ -329,7 +329,7 @@ void PhysicsWorld2D::Update(float timeStep)
     SendEndContactEvents();
 
     using namespace PhysicsPostStep;
-    SendEvent(E_PHYSICSPOSTSTEP, eventData);
+    SendTypedEvent(E_PHYSICSPOSTSTEP, PhysicsStepPayload{this, timeStep}, eventData);
 }
 
 void PhysicsWorld2D::DrawDebugGeometry()
@@ -96,6 +96,7 @@ const StringHash JSON_TYPE_GENERIC("json");
 const StringHash BINARY_TYPE_SCENE("USCN");
 const StringHash BINARY_TYPE_PACKAGE("UPAK");
 const StringHash BINARY_TYPE_COMPRESSED_PACKAGE("ULZ4");
+const StringHash BINARY_TYPE_COMPRESSED_PACKAGE2("ULZI");
 const StringHash BINARY_TYPE_ANGELSCRIPT("ASBC");
 const StringHash BINARY_TYPE_MODEL("UMDL");
 const StringHash BINARY_TYPE_MODEL2("UMD2");
@@ -1309,7 +1310,7 @@ bool GetBinaryType(String path, StringHash &out fileType, bool useCache = false)
         fileType = BINARY_TYPE_SCENE;
     else if (type == BINARY_TYPE_PACKAGE)
         fileType = BINARY_TYPE_PACKAGE;
-    else if (type == BINARY_TYPE_COMPRESSED_PACKAGE)
+    else if (type == BINARY_TYPE_COMPRESSED_PACKAGE || type == BINARY_TYPE_COMPRESSED_PACKAGE2)
         fileType = BINARY_TYPE_COMPRESSED_PACKAGE;
     else if (type == BINARY_TYPE_ANGELSCRIPT)
         fileType = BINARY_TYPE_ANGELSCRIPT;